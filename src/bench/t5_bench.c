@@ -0,0 +1,1303 @@
+/* t5_bench.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Offline benchmark for the plugins. Loads the given .so files, gets all
+   of their descriptors via ladspa_descriptor() and drives every plugin
+   through instantiate/connect_port/activate/run like a host would, for a
+   matrix of block sizes, sample rates, parameter change rates and input
+   signals. Results are written as CSV to stdout, one line per case:
+
+     library,label,id,samplerate,blocksize,changes_per_s,signal,samples,
+     ns_per_sample,cycles_per_sample,changes,recompute_ns,recompute_cycles,
+     latency
+
+   ns_per_sample and cycles_per_sample cover the whole run. Cycles are TSC
+   cycles (nan where no cycle counter is available). A parameter change
+   moves all frequency controls of a plugin by 5 percent, so all their
+   coefficients have to be recalculated. recompute_ns/_cycles is measured
+   separately after the timed run (for cases with changes only): the
+   median time of a run() of 0 samples right after a change minus the
+   median time of one without a change. The "impulse" signal is one
+   impulse followed by silence, any cost growing over time there points
+   to denormals. latency is the value of an output control port named
+   "latency" in samples, 0 for plugins without one.
+
+   With -d every plugin gets that impulse after some noise, with all
+   sections set up as for -a, and then DENORMAL_SECONDS of silence. Every
+   block is timed on its own. The cost of a window of DENORMAL_WINDOW
+   blocks is the median of its blocks, a plugin fails if any later window
+   costs more than DENORMAL_MAX_RATIO times the first one after the
+   impulse. This runs twice per sample rate, with the FTZ/DAZ flags of the
+   host thread set and cleared (x86 only, elsewhere once with the mode
+   the bench starts with). The plugins set these flags in run()
+   themselves, build them with DEFINES=-DDISABLE_DENORMALS=0 to check
+   that the flushing of filter state alone keeps them out of denormals.
+   One CSV line per plugin, sample rate and mode:
+
+     library,label,id,samplerate,ftz_daz,early_ns_per_sample,
+     late_ns_per_sample,ratio
+
+   The exit status is 1 if any plugin failed.
+
+   With -a the plugins are checked against the double precision reference
+   models in reference.h instead. Every plugin with a model runs one
+   second of an impulse, a sine sweep and noise at every sample rate, with
+   all gains, frequencies, Qs and delays in samples set away from their
+   defaults. One CSV line
+   per output:
+
+     library,label,id,samplerate,output,impulse_max_error,sweep_max_error,
+     noise_max_error,noise_error_db,magnitude_error_db,phase_error_deg
+
+   The errors are absolute differences to the reference output for inputs
+   of peak 0.5, noise_error_db is the error energy relative to the output
+   energy. Magnitude and phase errors compare the DFT of the impulse
+   response with the reference transfer function at log spaced
+   frequencies, wherever the reference is above -60dB or the threshold of
+   its model. Every output has to stay within the limits of its model in
+   reference.h, for the max errors of all signals, the magnitude and the
+   phase error. Outputs that don't are reported on stderr and the exit
+   status is 1, so a changed kernel is rejected automatically. -e
+   replaces the max error limit of all models.
+
+   Without options the matrix is small, block sizes 64 and 1024 at 48kHz
+   and 192kHz, without and with 100 changes per second, noise only. -f
+   runs the full sweep: block sizes 1 to 8192, sample rates 44.1kHz to
+   384kHz, 0 to 1000 changes per second, noise and impulse. Lists given
+   with -b, -r, -c and -s replace the ones of either matrix.
+
+   With -m the control segment is checked, for plugin libraries built with
+   DEFINES=-DMMAP_CONTROL_SEGMENT=1 or run with T5_MMAP_CONTROL_SEGMENT=1
+   in the environment. For every plugin a process sets up
+   SEGMENT_INSTANCES instances with MMAPFNAME set, then a second process
+   sets up as many. The second one has to find its instances through the
+   index in slots apart from those of the first one. It stages a scene
+   for every other instance and publishes it: the staged instances have
+   to apply one parameter set in the same period, the others have to skip
+   the scene at once. After cleanup() their slots have to be free and out
+   of the index. The slots of the first process have to stay locked while
+   it runs and be free once it has ended without cleanup(). This uses
+   MMAPFNAME from SEGMENT_FIRST_ID on, at the first sample rate. One CSV
+   line per plugin:
+
+     library,label,id,samplerate,locked_while_running,free_after_exit,
+     switch_period,result
+
+   Usage: t5_bench [-f] [-b blocksizes] [-r samplerates] [-c changes_per_s]
+                   [-s signals] [-t seconds] plugin.so ...
+          t5_bench -a [-e max_error] [-r samplerates] plugin.so ...
+          t5_bench -d [-r samplerates] plugin.so ...
+          t5_bench -m [-r samplerates] plugin.so ...
+
+   Lists are comma separated, signals are noise and impulse. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "reference.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+#else
+#define HAVE_CYCLES 0
+#endif
+#if defined(__SSE__)
+#define HAVE_FTZ_DAZ 1
+#else
+#define HAVE_FTZ_DAZ 0
+#endif
+
+/*****************************************************************************/
+
+#define BENCH_MAX_LIST      16
+#define BENCH_MAX_PORTS     128
+// audio run through the plugin before timing starts
+#define BENCH_WARMUP_S      0.1
+// relative change of all frequency controls per parameter change
+#define BENCH_CHANGE_FACTOR 1.05
+// number of timed run() calls with and without change for recompute cost
+#define BENCH_RECOMPUTE_ROUNDS 101
+
+#define SIGNAL_NOISE   0
+#define SIGNAL_IMPULSE 1
+#define SIGNAL_SWEEP   2
+
+// accuracy mode: block size and number of checked frequencies
+#define ACCURACY_BLOCKSIZE   256
+#define ACCURACY_FREQUENCIES 120
+// phase and magnitude are only compared above this reference magnitude,
+// unless the model has a limit of its own
+#define ACCURACY_MIN_MAGNITUDE 1e-3
+
+// denormal mode: block size, length of the silence after the impulse,
+// blocks per window and the largest cost of a later window relative to
+// the first one
+#define DENORMAL_BLOCKSIZE 64
+#define DENORMAL_SECONDS   2.0
+#define DENORMAL_WINDOW    32
+#define DENORMAL_MAX_RATIO 2.0
+// the whole run is repeated, each block counts with its fastest time, so
+// interrupts and other noise don't add up to a failure
+#define DENORMAL_REPEATS   3
+
+// control segment mode: instances per process, their block size, the
+// MMAPFNAME of the first one and the periods a scene may take to switch
+#define SEGMENT_INSTANCES   8
+#define SEGMENT_BLOCKSIZE   256
+#define SEGMENT_FIRST_ID    30000
+#define SEGMENT_MAX_PERIODS 16
+
+/* result of one benchmark case */
+typedef struct {
+
+    unsigned long samples;
+    double nsPerSample;
+    double cyclesPerSample;
+    unsigned long changes;
+    double recomputeNs;
+    double recomputeCycles;
+    // of the output control port "latency", 0 without one
+    unsigned long latency;
+
+} BenchResult;
+
+/* Helpers... ****************************************************************/
+
+static double nowNs(void) {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec * 1e9 + spec.tv_nsec;
+}
+
+static unsigned long long nowCycles(void) {
+#if HAVE_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Parse a comma separated list of numbers, returns the number of entries. */
+static int parseList(const char * pcList, double * pfValues) {
+    int iCount = 0;
+    char * pcEnd;
+    while (*pcList && iCount < BENCH_MAX_LIST) {
+        pfValues[iCount++] = strtod(pcList, &pcEnd);
+        pcList = *pcEnd == ',' ? pcEnd + 1 : pcEnd;
+        if (pcEnd == pcList && *pcEnd) {
+            break;
+        }
+    }
+    return iCount;
+}
+
+/* Default value of a control port according to its range hint. */
+static LADSPA_Data defaultControlValue(const LADSPA_PortRangeHint * psHint,
+                                       unsigned long SampleRate) {
+    LADSPA_PortRangeHintDescriptor iHint = psHint->HintDescriptor;
+    float fLower = psHint->LowerBound;
+    float fUpper = psHint->UpperBound;
+    float fWeight = -1;
+    if (LADSPA_IS_HINT_SAMPLE_RATE(iHint)) {
+        fLower *= SampleRate;
+        fUpper *= SampleRate;
+    }
+    switch (iHint & LADSPA_HINT_DEFAULT_MASK) {
+    case LADSPA_HINT_DEFAULT_MINIMUM:
+        return fLower;
+    case LADSPA_HINT_DEFAULT_LOW:
+        fWeight = 0.75;
+        break;
+    case LADSPA_HINT_DEFAULT_MIDDLE:
+        fWeight = 0.5;
+        break;
+    case LADSPA_HINT_DEFAULT_HIGH:
+        fWeight = 0.25;
+        break;
+    case LADSPA_HINT_DEFAULT_MAXIMUM:
+        return fUpper;
+    case LADSPA_HINT_DEFAULT_0:
+        return 0;
+    case LADSPA_HINT_DEFAULT_1:
+        return 1;
+    case LADSPA_HINT_DEFAULT_100:
+        return 100;
+    case LADSPA_HINT_DEFAULT_440:
+        return 440;
+    default:
+        return LADSPA_IS_HINT_BOUNDED_BELOW(iHint) ? fLower : 0;
+    }
+    if (LADSPA_IS_HINT_LOGARITHMIC(iHint) && fLower > 0) {
+        return exp(log(fLower) * fWeight + log(fUpper) * (1 - fWeight));
+    }
+    return fLower * fWeight + fUpper * (1 - fWeight);
+}
+
+/* 1 if the control port is a frequency, those are moved on a change. */
+static int isFrequencyPort(const LADSPA_Descriptor * psDescriptor, unsigned long lPort) {
+    return strstr(psDescriptor->PortNames[lPort], "Frequency") != NULL;
+}
+
+/* Move all frequency controls to their default (Toggle == 0) or slightly
+   above it (Toggle == 1). */
+static void setFrequencies(const LADSPA_Descriptor * psDescriptor,
+                           LADSPA_Data * pfControls,
+                           const LADSPA_Data * pfDefaults,
+                           int Toggle) {
+    unsigned long lPort;
+    for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+        if (LADSPA_IS_PORT_CONTROL(psDescriptor->PortDescriptors[lPort]) &&
+            isFrequencyPort(psDescriptor, lPort)) {
+            pfControls[lPort] = pfDefaults[lPort] * (Toggle ? BENCH_CHANGE_FACTOR : 1.0);
+        }
+    }
+}
+
+/* Set (On == 1) or clear the FTZ and DAZ flags of the calling thread. */
+static void setHostFtzDaz(int On) {
+#if HAVE_FTZ_DAZ
+    // FTZ (bit 15) and DAZ (bit 6)
+    _mm_setcsr(On ? _mm_getcsr() | 0x8040 : _mm_getcsr() & ~0x8040);
+#else
+    (void)On;
+#endif
+}
+
+static int compareDoubles(const void * pvA, const void * pvB) {
+    double a = *(const double *)pvA;
+    double b = *(const double *)pvB;
+    return a < b ? -1 : a > b;
+}
+
+static int compareCycles(const void * pvA, const void * pvB) {
+    unsigned long long a = *(const unsigned long long *)pvA;
+    unsigned long long b = *(const unsigned long long *)pvB;
+    return a < b ? -1 : a > b;
+}
+
+/* Median cycles of a run() of 0 samples with (Change == 1) or without a
+   change of the frequency controls right before it. */
+static double measureRunCycles(const LADSPA_Descriptor * psDescriptor,
+                               LADSPA_Handle hInstance,
+                               LADSPA_Data * pfControls,
+                               const LADSPA_Data * pfDefaults,
+                               int Change) {
+    unsigned long long aiCycles[BENCH_RECOMPUTE_ROUNDS];
+    unsigned long long iStart;
+    int i, iToggle = 0;
+    for (i = 0; i < BENCH_RECOMPUTE_ROUNDS; i++) {
+        if (Change) {
+            iToggle = !iToggle;
+            setFrequencies(psDescriptor, pfControls, pfDefaults, iToggle);
+        }
+        iStart = nowCycles();
+        psDescriptor->run(hInstance, 0);
+        aiCycles[i] = nowCycles() - iStart;
+    }
+    qsort(aiCycles, BENCH_RECOMPUTE_ROUNDS, sizeof(aiCycles[0]), compareCycles);
+    return aiCycles[BENCH_RECOMPUTE_ROUNDS / 2];
+}
+
+/*****************************************************************************/
+
+/* Run one case and measure it. */
+static BenchResult runCase(const LADSPA_Descriptor * psDescriptor,
+                           unsigned long SampleRate,
+                           unsigned long BlockSize,
+                           double ChangesPerSecond,
+                           int Signal,
+                           double Seconds) {
+    BenchResult result;
+    LADSPA_Handle hInstance;
+    LADSPA_Data afControls[BENCH_MAX_PORTS];
+    LADSPA_Data afDefaults[BENCH_MAX_PORTS];
+    LADSPA_Data * pfNoise, * pfImpulse, * pfSilence, * pfOutputs;
+    unsigned long lPort, lBlock, lBlocks, lWarmupBlocks, lSample;
+    unsigned long lOutputs = 0;
+    double fChangeInterval, fNextChange, fTime;
+    double fStartNs, fEndNs;
+    unsigned long long iStartCycles, iEndCycles;
+    int iToggle = 0;
+
+    memset(&result, 0, sizeof(result));
+    hInstance = psDescriptor->instantiate(psDescriptor, SampleRate);
+    if (hInstance == NULL) {
+        return result;
+    }
+    pfNoise = (LADSPA_Data *)calloc(BlockSize, sizeof(LADSPA_Data));
+    pfImpulse = (LADSPA_Data *)calloc(BlockSize, sizeof(LADSPA_Data));
+    pfSilence = (LADSPA_Data *)calloc(BlockSize, sizeof(LADSPA_Data));
+    pfOutputs = (LADSPA_Data *)calloc(BlockSize * psDescriptor->PortCount, sizeof(LADSPA_Data));
+    srand(1);
+    for (lSample = 0; lSample < BlockSize; lSample++) {
+        pfNoise[lSample] = (rand() / (float)RAND_MAX - 0.5) * sin(lSample * 0.01 + 1);
+    }
+    pfImpulse[0] = 1;
+    // connect all ports, controls start at their defaults
+    for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+        LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+        if (LADSPA_IS_PORT_AUDIO(iPort)) {
+            if (LADSPA_IS_PORT_INPUT(iPort)) {
+                psDescriptor->connect_port(hInstance, lPort, pfNoise);
+            } else {
+                psDescriptor->connect_port(hInstance, lPort, pfOutputs + BlockSize * lOutputs++);
+            }
+        } else {
+            afDefaults[lPort] = defaultControlValue(&psDescriptor->PortRangeHints[lPort], SampleRate);
+            afControls[lPort] = afDefaults[lPort];
+            psDescriptor->connect_port(hInstance, lPort, &afControls[lPort]);
+        }
+    }
+    if (psDescriptor->activate) {
+        psDescriptor->activate(hInstance);
+    }
+    // warm up with noise
+    lWarmupBlocks = (unsigned long)(BENCH_WARMUP_S * SampleRate / BlockSize) + 1;
+    for (lBlock = 0; lBlock < lWarmupBlocks; lBlock++) {
+        psDescriptor->run(hInstance, BlockSize);
+    }
+    if (Signal == SIGNAL_IMPULSE) {
+        for (lPort = 0; lPort < psDescriptor->PortCount; lPort++) {
+            LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+            if (LADSPA_IS_PORT_AUDIO(iPort) && LADSPA_IS_PORT_INPUT(iPort)) {
+                psDescriptor->connect_port(hInstance, lPort, pfImpulse);
+            }
+        }
+    }
+    // timed run
+    lBlocks = (unsigned long)(Seconds * SampleRate / BlockSize) + 1;
+    fChangeInterval = ChangesPerSecond > 0 ? 1.0 / ChangesPerSecond : -1;
+    fNextChange = fChangeInterval;
+    fStartNs = nowNs();
+    iStartCycles = nowCycles();
+    for (lBlock = 0; lBlock < lBlocks; lBlock++) {
+        fTime = (double)lBlock * BlockSize / SampleRate;
+        if (fChangeInterval > 0 && fTime >= fNextChange) {
+            iToggle = !iToggle;
+            setFrequencies(psDescriptor, afControls, afDefaults, iToggle);
+            while (fNextChange <= fTime) {
+                fNextChange += fChangeInterval;
+            }
+            result.changes++;
+        }
+        psDescriptor->run(hInstance, BlockSize);
+        if (Signal == SIGNAL_IMPULSE && lBlock == 0) {
+            for (lPort = 0; lPort < psDescriptor->PortCount; lPort++) {
+                LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+                if (LADSPA_IS_PORT_AUDIO(iPort) && LADSPA_IS_PORT_INPUT(iPort)) {
+                    psDescriptor->connect_port(hInstance, lPort, pfSilence);
+                }
+            }
+        }
+    }
+    iEndCycles = nowCycles();
+    fEndNs = nowNs();
+
+    result.samples = lBlocks * BlockSize;
+    result.nsPerSample = (fEndNs - fStartNs) / result.samples;
+    result.cyclesPerSample = HAVE_CYCLES ? (double)(iEndCycles - iStartCycles) / result.samples : NAN;
+    result.recomputeCycles = NAN;
+    result.recomputeNs = NAN;
+    if (ChangesPerSecond > 0 && HAVE_CYCLES) {
+        result.recomputeCycles
+            = measureRunCycles(psDescriptor, hInstance, afControls, afDefaults, 1)
+            - measureRunCycles(psDescriptor, hInstance, afControls, afDefaults, 0);
+        result.recomputeNs = result.recomputeCycles
+                             * (fEndNs - fStartNs) / (double)(iEndCycles - iStartCycles);
+    }
+    for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+        LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+        if (LADSPA_IS_PORT_CONTROL(iPort) && LADSPA_IS_PORT_OUTPUT(iPort) &&
+            strcmp(psDescriptor->PortNames[lPort], "latency") == 0) {
+            result.latency = (unsigned long)afControls[lPort];
+        }
+    }
+    psDescriptor->cleanup(hInstance);
+
+    free(pfNoise);
+    free(pfImpulse);
+    free(pfSilence);
+    free(pfOutputs);
+    return result;
+}
+
+/* Denormals... *************************************************************/
+
+static void setAccuracyControls(const LADSPA_Descriptor * psDescriptor,
+                                LADSPA_Data * pfControls,
+                                unsigned long SampleRate);
+
+/* Time every block of silence after an impulse, see the top of this file.
+   FtzDaz is the mode of the host thread: 1 set, 0 cleared, -1 left alone.
+   Returns 1 if the plugin failed. */
+static int runDenormals(const char * pcLibrary,
+                        const LADSPA_Descriptor * psDescriptor,
+                        unsigned long SampleRate,
+                        int FtzDaz) {
+    LADSPA_Handle hInstance;
+    LADSPA_Data afControls[BENCH_MAX_PORTS];
+    LADSPA_Data * pfNoise, * pfImpulse, * pfSilence, * pfOutputs, * pfInput;
+    unsigned long lPort, lBlock, lBlocks, lWarmupBlocks, lSample, lOutputs = 0;
+    unsigned long lWindows, lWindow;
+    double * pfBlockNs, afWindow[DENORMAL_WINDOW];
+    double fStartNs, fNs, fEarly = 0, fLate = 0, fMedian;
+    int iFailed, iRepeat;
+
+    hInstance = psDescriptor->instantiate(psDescriptor, SampleRate);
+    if (hInstance == NULL) {
+        return 0;
+    }
+    lBlocks = (unsigned long)(DENORMAL_SECONDS * SampleRate / DENORMAL_BLOCKSIZE) + 1;
+    pfBlockNs = (double *)calloc(lBlocks, sizeof(double));
+    pfNoise = (LADSPA_Data *)calloc(DENORMAL_BLOCKSIZE, sizeof(LADSPA_Data));
+    pfImpulse = (LADSPA_Data *)calloc(DENORMAL_BLOCKSIZE, sizeof(LADSPA_Data));
+    pfSilence = (LADSPA_Data *)calloc(DENORMAL_BLOCKSIZE, sizeof(LADSPA_Data));
+    pfOutputs = (LADSPA_Data *)calloc(DENORMAL_BLOCKSIZE * psDescriptor->PortCount, sizeof(LADSPA_Data));
+    srand(1);
+    for (lSample = 0; lSample < DENORMAL_BLOCKSIZE; lSample++) {
+        pfNoise[lSample] = rand() / (float)RAND_MAX - 0.5;
+    }
+    pfImpulse[0] = 1;
+    setAccuracyControls(psDescriptor, afControls, SampleRate);
+    for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+        LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+        if (LADSPA_IS_PORT_CONTROL(iPort)) {
+            psDescriptor->connect_port(hInstance, lPort, &afControls[lPort]);
+        } else if (LADSPA_IS_PORT_OUTPUT(iPort)) {
+            psDescriptor->connect_port(hInstance, lPort, pfOutputs + DENORMAL_BLOCKSIZE * lOutputs++);
+        }
+    }
+    if (FtzDaz >= 0) {
+        setHostFtzDaz(FtzDaz);
+    }
+    // noise, the impulse and then silence
+    lWarmupBlocks = (unsigned long)(BENCH_WARMUP_S * SampleRate / DENORMAL_BLOCKSIZE) + 1;
+    for (iRepeat = 0; iRepeat < DENORMAL_REPEATS; iRepeat++) {
+        if (psDescriptor->activate) {
+            psDescriptor->activate(hInstance);
+        }
+        for (lBlock = 0; lBlock < lWarmupBlocks + lBlocks; lBlock++) {
+            pfInput = lBlock < lWarmupBlocks ? pfNoise : lBlock == lWarmupBlocks ? pfImpulse : pfSilence;
+            for (lPort = 0; lPort < psDescriptor->PortCount; lPort++) {
+                LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+                if (LADSPA_IS_PORT_AUDIO(iPort) && LADSPA_IS_PORT_INPUT(iPort)) {
+                    psDescriptor->connect_port(hInstance, lPort, pfInput);
+                }
+            }
+            fStartNs = nowNs();
+            psDescriptor->run(hInstance, DENORMAL_BLOCKSIZE);
+            fNs = nowNs() - fStartNs;
+            if (lBlock >= lWarmupBlocks &&
+                (iRepeat == 0 || fNs < pfBlockNs[lBlock - lWarmupBlocks])) {
+                pfBlockNs[lBlock - lWarmupBlocks] = fNs;
+            }
+        }
+        if (psDescriptor->deactivate) {
+            psDescriptor->deactivate(hInstance);
+        }
+    }
+    psDescriptor->cleanup(hInstance);
+    if (FtzDaz >= 0) {
+        setHostFtzDaz(0);
+    }
+    // windows of silence, the block with the impulse doesn't count
+    lWindows = (lBlocks - 1) / DENORMAL_WINDOW;
+    for (lWindow = 0; lWindow < lWindows; lWindow++) {
+        memcpy(afWindow, pfBlockNs + 1 + lWindow * DENORMAL_WINDOW, sizeof(afWindow));
+        qsort(afWindow, DENORMAL_WINDOW, sizeof(double), compareDoubles);
+        fMedian = afWindow[DENORMAL_WINDOW / 2] / DENORMAL_BLOCKSIZE;
+        if (lWindow == 0) {
+            fEarly = fMedian;
+        } else if (fMedian > fLate) {
+            fLate = fMedian;
+        }
+    }
+    iFailed = fLate > fEarly * DENORMAL_MAX_RATIO;
+    printf("%s,%s,%lu,%lu,%s,%.3f,%.3f,%.2f\n",
+           pcLibrary,
+           psDescriptor->Label,
+           psDescriptor->UniqueID,
+           SampleRate,
+           FtzDaz < 0 ? "-" : FtzDaz ? "on" : "off",
+           fEarly,
+           fLate,
+           fLate / fEarly);
+    fflush(stdout);
+    free(pfBlockNs);
+    free(pfNoise);
+    free(pfImpulse);
+    free(pfSilence);
+    free(pfOutputs);
+    return iFailed;
+}
+
+/* Accuracy... **************************************************************/
+
+/* Upper bound of a control port in Hz or its unit, INFINITY if it has
+   none. */
+static double controlUpperBound(const LADSPA_PortRangeHint * psHint,
+                                unsigned long SampleRate) {
+    if (!LADSPA_IS_HINT_BOUNDED_ABOVE(psHint->HintDescriptor)) {
+        return INFINITY;
+    }
+    if (LADSPA_IS_HINT_SAMPLE_RATE(psHint->HintDescriptor)) {
+        return psHint->UpperBound * (double)SampleRate;
+    }
+    return psHint->UpperBound;
+}
+
+/* Set the controls to values that make every section of a plugin do
+   something: frequencies spread logarithmically in port order (so
+   crossovers are ascending) from 40Hz to 12kHz, or to the highest upper
+   bound of the frequency ports if that is lower, each within its own
+   bound, gains alternating between boosts and cuts, different Qs.
+   Channels are not linked. */
+static void setAccuracyControls(const LADSPA_Descriptor * psDescriptor,
+                                LADSPA_Data * pfControls,
+                                unsigned long SampleRate) {
+    const float afGains[4] = { 6, -4, 3, -2 };
+    unsigned long lPort;
+    int iFrequencies = 0, iFrequency = 0, iGain = 0, iQ = 0;
+    double fMax = SampleRate * 0.3 < 12000 ? SampleRate * 0.3 : 12000;
+    double fBound = 0;
+    for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+        if (LADSPA_IS_PORT_CONTROL(psDescriptor->PortDescriptors[lPort]) &&
+            isFrequencyPort(psDescriptor, lPort)) {
+            iFrequencies++;
+            fBound = fmax(fBound, controlUpperBound(&psDescriptor->PortRangeHints[lPort], SampleRate));
+        }
+    }
+    if (iFrequencies > 0 && fBound < fMax) {
+        fMax = fBound;
+    }
+    for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+        const char * pcName = psDescriptor->PortNames[lPort];
+        if (!LADSPA_IS_PORT_CONTROL(psDescriptor->PortDescriptors[lPort])) {
+            continue;
+        }
+        pfControls[lPort] = defaultControlValue(&psDescriptor->PortRangeHints[lPort], SampleRate);
+        if (isFrequencyPort(psDescriptor, lPort)) {
+            pfControls[lPort] = iFrequencies == 1
+                ? 200
+                : 40 * pow(fMax / 40, (double)iFrequency++ / (iFrequencies - 1));
+            pfControls[lPort] = fmin(pfControls[lPort],
+                                     controlUpperBound(&psDescriptor->PortRangeHints[lPort], SampleRate));
+        } else if (strstr(pcName, "Gain")) {
+            pfControls[lPort] = afGains[iGain++ % 4];
+        } else if (strstr(pcName, " Q")) {
+            pfControls[lPort] = 0.5 + 0.4 * (iQ++ % 4);
+        } else if (strstr(pcName, "Link")) {
+            pfControls[lPort] = 0;
+        } else if (strstr(pcName, "Delay [samples]")) {
+            pfControls[lPort] = 37;
+        } else if (strstr(pcName, "MMAP") || strstr(pcName, "Smoothing")) {
+            pfControls[lPort] = 0;
+        }
+    }
+}
+
+/* Fill pfSignal with Length samples of the given test signal. */
+static void makeAccuracySignal(int Signal, float * pfSignal, unsigned long Length, double SampleRate) {
+    double f0 = 20, f1 = SampleRate * 0.45, fT = Length / SampleRate;
+    double k = log(f1 / f0);
+    unsigned long i;
+    srand(2);
+    for (i = 0; i < Length; i++) {
+        switch (Signal) {
+        case SIGNAL_IMPULSE:
+            pfSignal[i] = i == 0 ? 0.5 : 0;
+            break;
+        case SIGNAL_SWEEP:
+            pfSignal[i] = 0.5 * sin(2 * M_PI * f0 * fT / k * (exp(i / SampleRate / fT * k) - 1));
+            break;
+        default:
+            pfSignal[i] = rand() / (float)RAND_MAX - 0.5;
+            break;
+        }
+    }
+}
+
+/* Run Length samples of pfSignal through a freshly activated instance,
+   all audio inputs get the same signal. Output o goes to
+   pfOutputs + o * Length. */
+static void runAccuracySignal(const LADSPA_Descriptor * psDescriptor,
+                              LADSPA_Handle hInstance,
+                              float * pfSignal,
+                              float * pfOutputs,
+                              unsigned long Length) {
+    unsigned long lPort, lOffset, lBlockSize;
+    int iOutput;
+    if (psDescriptor->activate) {
+        psDescriptor->activate(hInstance);
+    }
+    for (lOffset = 0; lOffset < Length; lOffset += lBlockSize) {
+        lBlockSize = Length - lOffset < ACCURACY_BLOCKSIZE ? Length - lOffset : ACCURACY_BLOCKSIZE;
+        iOutput = 0;
+        for (lPort = 0; lPort < psDescriptor->PortCount; lPort++) {
+            LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+            if (LADSPA_IS_PORT_AUDIO(iPort)) {
+                if (LADSPA_IS_PORT_INPUT(iPort)) {
+                    psDescriptor->connect_port(hInstance, lPort, pfSignal + lOffset);
+                } else {
+                    psDescriptor->connect_port(hInstance, lPort, pfOutputs + iOutput++ * Length + lOffset);
+                }
+            }
+        }
+        psDescriptor->run(hInstance, lBlockSize);
+    }
+    if (psDescriptor->deactivate) {
+        psDescriptor->deactivate(hInstance);
+    }
+}
+
+/* Compare all outputs of one plugin with its reference model at one
+   sample rate. fMaxError replaces the max error limit of the model if it
+   isn't negative. Returns 1 if an output exceeds the limits, 0 if none
+   does, or -1 if there is no model for the plugin. */
+static int runAccuracy(const char * pcLibrary,
+                       const LADSPA_Descriptor * psDescriptor,
+                       unsigned long SampleRate,
+                       double fMaxError) {
+    const int aiSignals[3] = { SIGNAL_IMPULSE, SIGNAL_SWEEP, SIGNAL_NOISE };
+    LADSPA_Data afControls[BENCH_MAX_PORTS];
+    LADSPA_Handle hInstance;
+    RefChain chain;
+    unsigned long lLength = SampleRate;
+    unsigned long lPort, i;
+    int iOutputs = 0, iOutput, s, k;
+    float * pfSignal, * pfOutputs[3];
+    double * pfIn, * pfRef;
+    double fWorst;
+    int iFailed = 0;
+
+    hInstance = psDescriptor->instantiate(psDescriptor, SampleRate);
+    if (hInstance == NULL) {
+        return -1;
+    }
+    setAccuracyControls(psDescriptor, afControls, SampleRate);
+    for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+        LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+        if (LADSPA_IS_PORT_CONTROL(iPort)) {
+            psDescriptor->connect_port(hInstance, lPort, &afControls[lPort]);
+        } else if (LADSPA_IS_PORT_OUTPUT(iPort)) {
+            iOutputs++;
+        }
+    }
+    if (!buildReferenceChain(psDescriptor, afControls, SampleRate, 0, &chain)) {
+        psDescriptor->cleanup(hInstance);
+        return -1;
+    }
+    pfSignal = (float *)malloc(lLength * sizeof(float));
+    pfIn = (double *)malloc(lLength * sizeof(double));
+    pfRef = (double *)malloc(lLength * sizeof(double));
+    for (s = 0; s < 3; s++) {
+        pfOutputs[s] = (float *)calloc(lLength * iOutputs, sizeof(float));
+        makeAccuracySignal(aiSignals[s], pfSignal, lLength, SampleRate);
+        runAccuracySignal(psDescriptor, hInstance, pfSignal, pfOutputs[s], lLength);
+    }
+    for (iOutput = 0; iOutput < iOutputs; iOutput++) {
+        double afMaxError[3] = { 0, 0, 0 };
+        double fErrorEnergy = 0, fEnergy = 0;
+        double fMagError = 0, fPhaseError = 0, fMinMagnitude;
+        buildReferenceChain(psDescriptor, afControls, SampleRate, iOutput, &chain);
+        if (fMaxError >= 0) {
+            chain.limits.maxError = fMaxError;
+        }
+        fMinMagnitude = chain.limits.minMagnitude > 0 ? chain.limits.minMagnitude
+                                                      : ACCURACY_MIN_MAGNITUDE;
+        fWorst = 0;
+        // time domain
+        for (s = 0; s < 3; s++) {
+            const float * pfOut = pfOutputs[s] + iOutput * lLength;
+            makeAccuracySignal(aiSignals[s], pfSignal, lLength, SampleRate);
+            for (i = 0; i < lLength; i++) {
+                pfIn[i] = pfSignal[i];
+            }
+            refFilter(&chain, pfIn, pfRef, lLength);
+            for (i = 0; i < lLength; i++) {
+                double e = fabs(pfOut[i] - pfRef[i]);
+                if (e > afMaxError[s]) {
+                    afMaxError[s] = e;
+                }
+                if (aiSignals[s] == SIGNAL_NOISE) {
+                    fErrorEnergy += e * e;
+                    fEnergy += pfRef[i] * pfRef[i];
+                }
+            }
+            if (afMaxError[s] > fWorst) {
+                fWorst = afMaxError[s];
+            }
+        }
+        // frequency domain, from the impulse response
+        for (k = 0; k < ACCURACY_FREQUENCIES; k++) {
+            double f = 20 * pow(SampleRate * 0.45 / 20, (double)k / (ACCURACY_FREQUENCIES - 1));
+            double w = 2 * M_PI * f / SampleRate;
+            double re = 0, im = 0, rr, ri, cr = 1, ci = 0, dr = cos(w), di = -sin(w), t;
+            const float * pfOut = pfOutputs[0] + iOutput * lLength;
+            for (i = 0; i < lLength; i++) {
+                re += pfOut[i] * cr;
+                im += pfOut[i] * ci;
+                t = cr * dr - ci * di;
+                ci = cr * di + ci * dr;
+                cr = t;
+            }
+            // the impulse has an amplitude of 0.5
+            re *= 2;
+            im *= 2;
+            refResponse(&chain, w, &rr, &ri);
+            if (hypot(rr, ri) > fMinMagnitude) {
+                double m = fabs(20 * log10(hypot(re, im) / hypot(rr, ri)));
+                double p = fabs(remainder(atan2(im, re) - atan2(ri, rr), 2 * M_PI)) * 180 / M_PI;
+                fMagError = m > fMagError ? m : fMagError;
+                fPhaseError = p > fPhaseError ? p : fPhaseError;
+            }
+        }
+        printf("%s,%s,%lu,%lu,%d,%.3g,%.3g,%.3g,%.1f,%.3g,%.3g\n",
+               pcLibrary,
+               psDescriptor->Label,
+               psDescriptor->UniqueID,
+               SampleRate,
+               iOutput + 1,
+               afMaxError[0],
+               afMaxError[1],
+               afMaxError[2],
+               10 * log10(fErrorEnergy / fEnergy),
+               fMagError,
+               fPhaseError);
+        fflush(stdout);
+        if (!(fWorst <= chain.limits.maxError) ||
+            !(fMagError <= chain.limits.magnitudeDb) ||
+            !(fPhaseError <= chain.limits.phaseDeg)) {
+            fprintf(stderr, "FAILED: %s at %lu Hz, output %d: max error %g (limit %g), "
+                    "magnitude error %g dB (limit %g), phase error %g deg (limit %g)\n",
+                    psDescriptor->Label, SampleRate, iOutput + 1,
+                    fWorst, chain.limits.maxError,
+                    fMagError, chain.limits.magnitudeDb,
+                    fPhaseError, chain.limits.phaseDeg);
+            iFailed = 1;
+        }
+    }
+    psDescriptor->cleanup(hInstance);
+    for (s = 0; s < 3; s++) {
+        free(pfOutputs[s]);
+    }
+    free(pfSignal);
+    free(pfIn);
+    free(pfRef);
+    return iFailed;
+}
+
+/* Control segment... *******************************************************/
+
+/* Instances of one plugin set up by a process of its own for -m, with
+   MMAPFNAME FirstId, FirstId + 1, ... */
+typedef struct {
+
+    LADSPA_Handle ahInstances[SEGMENT_INSTANCES];
+    LADSPA_Data aafControls[SEGMENT_INSTANCES][BENCH_MAX_PORTS];
+    MmapSlot * apsSlots[SEGMENT_INSTANCES];
+    LADSPA_Data * pfInput;
+    LADSPA_Data * pfOutputs;
+
+} SegmentInstances;
+
+/* Run every instance for one block. */
+static void runSegmentInstances(const LADSPA_Descriptor * psDescriptor,
+                                SegmentInstances * psInstances) {
+    int i;
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        psDescriptor->run(psInstances->ahInstances[i], SEGMENT_BLOCKSIZE);
+    }
+}
+
+/* Instantiate the instances and run them for a block, which sets up
+   their mmap areas, then look up their slots: the slot this process owns
+   with the id of an instance has to be the one the index returns for its
+   plugin name and id. Returns the number of instances without a slot. */
+static int startSegmentInstances(const LADSPA_Descriptor * psDescriptor,
+                                 MmapControlSegment * psSegment,
+                                 unsigned long SampleRate,
+                                 uint32_t FirstId,
+                                 SegmentInstances * psInstances) {
+    LADSPA_Data * pfControls;
+    unsigned long lPort, lOutputs = 0;
+    int i, j, iMissing = 0;
+    pid_t pid = getpid();
+    psInstances->pfInput = (LADSPA_Data *)calloc(SEGMENT_BLOCKSIZE, sizeof(LADSPA_Data));
+    psInstances->pfOutputs = (LADSPA_Data *)calloc(SEGMENT_BLOCKSIZE * SEGMENT_INSTANCES *
+                                                   psDescriptor->PortCount,
+                                                   sizeof(LADSPA_Data));
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        psInstances->ahInstances[i] = psDescriptor->instantiate(psDescriptor, SampleRate);
+        pfControls = psInstances->aafControls[i];
+        setAccuracyControls(psDescriptor, pfControls, SampleRate);
+        for (lPort = 0; lPort < psDescriptor->PortCount && lPort < BENCH_MAX_PORTS; lPort++) {
+            LADSPA_PortDescriptor iPort = psDescriptor->PortDescriptors[lPort];
+            if (LADSPA_IS_PORT_CONTROL(iPort)) {
+                if (strstr(psDescriptor->PortNames[lPort], "MMAP")) {
+                    pfControls[lPort] = FirstId + i;
+                }
+                psDescriptor->connect_port(psInstances->ahInstances[i], lPort, &pfControls[lPort]);
+            } else if (LADSPA_IS_PORT_INPUT(iPort)) {
+                psDescriptor->connect_port(psInstances->ahInstances[i], lPort, psInstances->pfInput);
+            } else {
+                psDescriptor->connect_port(psInstances->ahInstances[i], lPort,
+                                           psInstances->pfOutputs + SEGMENT_BLOCKSIZE * lOutputs++);
+            }
+        }
+        if (psDescriptor->activate) {
+            psDescriptor->activate(psInstances->ahInstances[i]);
+        }
+    }
+    runSegmentInstances(psDescriptor, psInstances);
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        psInstances->apsSlots[i] = NULL;
+        for (j = 0; j < MMAP_CONTROL_SLOTS; j++) {
+            MmapSlot * psSlot = &psSegment->slots[j];
+            if (psSlot->owner == pid && psSlot->id == FirstId + i) {
+                psInstances->apsSlots[i] = psSlot;
+                break;
+            }
+        }
+        if (psInstances->apsSlots[i] == NULL ||
+            findMmapSlot(psSegment, psInstances->apsSlots[i]->pluginname, FirstId + i) !=
+            psInstances->apsSlots[i]) {
+            iMissing++;
+        }
+    }
+    return iMissing;
+}
+
+/* Clean the instances up. */
+static void stopSegmentInstances(const LADSPA_Descriptor * psDescriptor,
+                                 SegmentInstances * psInstances) {
+    int i;
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        if (psDescriptor->deactivate) {
+            psDescriptor->deactivate(psInstances->ahInstances[i]);
+        }
+        psDescriptor->cleanup(psInstances->ahInstances[i]);
+    }
+    free(psInstances->pfInput);
+    free(psInstances->pfOutputs);
+}
+
+/* Check the instances of the process running the scene, see the top of
+   this file. OtherPid is the process holding the instances with ids from
+   FirstId + SEGMENT_INSTANCES on. Returns 1 if the plugin failed, the
+   period the scene switched in is stored in *piPeriod. */
+static int runSegmentScene(const LADSPA_Descriptor * psDescriptor,
+                           MmapControlSegment * psSegment,
+                           unsigned long SampleRate,
+                           uint32_t FirstId,
+                           pid_t OtherPid,
+                           int * piPeriod) {
+    SegmentInstances sInstances;
+    LADSPA_Data afParams[MMAP_MAX_PARAMS];
+    MmapSlot * psSlot, * psOther;
+    uint64_t aiChanges[SEGMENT_INSTANCES];
+    uint32_t generation;
+    unsigned long lPort;
+    int aiSwitched[SEGMENT_INSTANCES];
+    int i, j, n, iPeriod, iFailed = 0;
+    struct timespec sBlock;
+    sBlock.tv_sec = 0;
+    sBlock.tv_nsec = (long)(SEGMENT_BLOCKSIZE * 1e9 / SampleRate);
+    *piPeriod = -1;
+    if (startSegmentInstances(psDescriptor, psSegment, SampleRate, FirstId, &sInstances) != 0) {
+        fprintf(stderr, "FAILED: %s, instances without a slot in the control segment\n",
+                psDescriptor->Label);
+        stopSegmentInstances(psDescriptor, &sInstances);
+        return 1;
+    }
+    // the slots of the other process are where the index says and apart
+    // from ours
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        psOther = findMmapSlot(psSegment, sInstances.apsSlots[0]->pluginname,
+                               FirstId + SEGMENT_INSTANCES + i);
+        for (j = 0; j < SEGMENT_INSTANCES && psOther != sInstances.apsSlots[j]; j++) {
+        }
+        if (psOther == NULL || psOther->owner != OtherPid || j < SEGMENT_INSTANCES) {
+            fprintf(stderr, "FAILED: %s, slot of another process not found or shared\n",
+                    psDescriptor->Label);
+            iFailed = 1;
+        }
+    }
+    // stage the control values in port order for every other instance
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        psSlot = sInstances.apsSlots[i];
+        aiChanges[i] = psSlot->telemetry.mmapChanges;
+        aiSwitched[i] = -1;
+        if (i % 2 != 0) {
+            continue;
+        }
+        memset(afParams, 0, sizeof(afParams));
+        n = 0;
+        for (lPort = 0; lPort < psDescriptor->PortCount && n < MMAP_MAX_PARAMS; lPort++) {
+            const char * pcName = psDescriptor->PortNames[lPort];
+            if (LADSPA_IS_PORT_CONTROL(psDescriptor->PortDescriptors[lPort]) &&
+                LADSPA_IS_PORT_INPUT(psDescriptor->PortDescriptors[lPort]) &&
+                !strstr(pcName, "MMAP") && !strstr(pcName, "Smoothing")) {
+                afParams[n++] = sInstances.aafControls[i][lPort];
+            }
+        }
+        stageMmapScene(psSegment, psSlot, afParams, psSlot->paramCount);
+    }
+    generation = publishMmapScene(psSegment);
+    for (iPeriod = 0; iPeriod < SEGMENT_MAX_PERIODS; iPeriod++) {
+        runSegmentInstances(psDescriptor, &sInstances);
+        n = 0;
+        for (i = 0; i < SEGMENT_INSTANCES; i++) {
+            if (aiSwitched[i] < 0 && sInstances.apsSlots[i]->sceneApplied == generation) {
+                aiSwitched[i] = iPeriod;
+            }
+            n += aiSwitched[i] >= 0;
+        }
+        if (n == SEGMENT_INSTANCES) {
+            break;
+        }
+        nanosleep(&sBlock, NULL);
+    }
+    // staged instances switch together, the others skip the scene at once
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        psSlot = sInstances.apsSlots[i];
+        if (i % 2 == 0 && (aiSwitched[i] < 0 || aiSwitched[i] != aiSwitched[0])) {
+            fprintf(stderr, "FAILED: %s, instance %d switched in period %d instead of %d\n",
+                    psDescriptor->Label, i, aiSwitched[i], aiSwitched[0]);
+            iFailed = 1;
+        }
+        if (i % 2 != 0 && aiSwitched[i] != 0) {
+            fprintf(stderr, "FAILED: %s, instance %d not part of the scene skipped it in period %d\n",
+                    psDescriptor->Label, i, aiSwitched[i]);
+            iFailed = 1;
+        }
+        if (psSlot->telemetry.magic == MMAP_TELEMETRY_MAGIC &&
+            psSlot->telemetry.mmapChanges != aiChanges[i] + (i % 2 == 0)) {
+            fprintf(stderr, "FAILED: %s, instance %d applied %lu parameter sets with the scene\n",
+                    psDescriptor->Label, i,
+                    (unsigned long)(psSlot->telemetry.mmapChanges - aiChanges[i]));
+            iFailed = 1;
+        }
+    }
+    *piPeriod = aiSwitched[0];
+    // cleanup() frees the slots and removes them from the index
+    stopSegmentInstances(psDescriptor, &sInstances);
+    for (i = 0; i < SEGMENT_INSTANCES; i++) {
+        psSlot = sInstances.apsSlots[i];
+        if (psSlot->owner != 0 || findMmapSlot(psSegment, psSlot->pluginname, FirstId + i) != NULL) {
+            fprintf(stderr, "FAILED: %s, slot of instance %d not freed in cleanup()\n",
+                    psDescriptor->Label, i);
+            iFailed = 1;
+        }
+    }
+    return iFailed;
+}
+
+/* Check the control segment with the instances of two processes, see the
+   top of this file. Returns 1 if the plugin failed. */
+static int runSegment(const char * pcLibrary,
+                      const LADSPA_Descriptor * psDescriptor,
+                      MmapControlSegment * psSegment,
+                      unsigned long SampleRate) {
+    MmapControlState * psState = mmapControlState();
+    SegmentInstances sInstances;
+    int aiReady[2], aiGo[2], aiOther[SEGMENT_INSTANCES];
+    int i, n = 0, iStatus, iPeriod = -1, iFailed = 0;
+    int iLockedAlive = 0, iLockedAfterExit = 0;
+    char cReady = 'f';
+    pid_t pidOther, pidScene;
+    if (pipe(aiReady) != 0 || pipe(aiGo) != 0) {
+        return 1;
+    }
+    fflush(stdout);
+    // the other process sets up its instances and ends without cleanup()
+    // once told to
+    pidOther = fork();
+    if (pidOther == 0) {
+        close(aiReady[0]);
+        close(aiGo[1]);
+        if (startSegmentInstances(psDescriptor, psSegment, SampleRate,
+                                  SEGMENT_FIRST_ID + SEGMENT_INSTANCES, &sInstances) == 0) {
+            cReady = 'r';
+        } else {
+            // remove the mmap files of instances without a slot
+            stopSegmentInstances(psDescriptor, &sInstances);
+        }
+        if (write(aiReady[1], &cReady, 1) != 1 || read(aiGo[0], &cReady, 1) < 0) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(aiReady[1]);
+    close(aiGo[0]);
+    if (pidOther < 0 || read(aiReady[0], &cReady, 1) != 1 || cReady != 'r') {
+        fprintf(stderr, "FAILED: %s, instances without a slot in the control segment\n",
+                psDescriptor->Label);
+        iFailed = 1;
+    } else {
+        pidScene = fork();
+        if (pidScene == 0) {
+            iFailed = runSegmentScene(psDescriptor, psSegment, SampleRate,
+                                      SEGMENT_FIRST_ID, pidOther, &iPeriod);
+            _exit(iFailed | (iPeriod + 1) << 1);
+        }
+        if (pidScene < 0 || waitpid(pidScene, &iStatus, 0) != pidScene || !WIFEXITED(iStatus)) {
+            iStatus = 1;
+        } else {
+            iStatus = WEXITSTATUS(iStatus);
+        }
+        iFailed = iStatus & 1;
+        iPeriod = (iStatus >> 1) - 1;
+        // the locks of the other process hold while it runs
+        for (i = 0; i < MMAP_CONTROL_SLOTS && n < SEGMENT_INSTANCES; i++) {
+            if (psSegment->slots[i].owner == pidOther) {
+                aiOther[n++] = i;
+                iLockedAlive += !lockMmapSlot(psState, i, F_WRLCK);
+            }
+        }
+    }
+    close(aiGo[1]);
+    waitpid(pidOther, &iStatus, 0);
+    close(aiReady[0]);
+    // and are gone once it has ended, even without cleanup()
+    for (i = 0; i < n; i++) {
+        if (lockMmapSlot(psState, aiOther[i], F_WRLCK)) {
+            lockMmapSlot(psState, aiOther[i], F_UNLCK);
+            iLockedAfterExit++;
+        }
+    }
+    if (cReady == 'r' && (n != SEGMENT_INSTANCES || iLockedAlive != n || iLockedAfterExit != n)) {
+        fprintf(stderr, "FAILED: %s, %d of %d slots locked while their process ran, "
+                "%d free after it ended\n",
+                psDescriptor->Label, iLockedAlive, SEGMENT_INSTANCES, iLockedAfterExit);
+        iFailed = 1;
+    }
+    printf("%s,%s,%lu,%lu,%d,%d,%d,%s\n",
+           pcLibrary,
+           psDescriptor->Label,
+           psDescriptor->UniqueID,
+           SampleRate,
+           iLockedAlive,
+           iLockedAfterExit,
+           iPeriod,
+           iFailed ? "failed" : "ok");
+    fflush(stdout);
+    return iFailed;
+}
+
+/*****************************************************************************/
+
+int main(int argc, char ** argv) {
+    // the full sweep, also the sample rates of accuracy and denormal mode
+    double afBlockSizes[BENCH_MAX_LIST] = { 1, 16, 64, 256, 1024, 8192 };
+    double afSampleRates[BENCH_MAX_LIST] = { 44100, 48000, 96000, 192000, 384000 };
+    double afChanges[BENCH_MAX_LIST] = { 0, 10, 100, 1000 };
+    int aiSignals[2] = { SIGNAL_NOISE, SIGNAL_IMPULSE };
+    const char * apcSignalNames[2] = { "noise", "impulse" };
+    int iBlockSizes = 6, iSampleRates = 5, iChanges = 4, iSignals = 2;
+    // the default benchmark matrix
+    const double afQuickBlockSizes[2] = { 64, 1024 };
+    const double afQuickSampleRates[2] = { 48000, 192000 };
+    const double afQuickChanges[2] = { 0, 100 };
+    int iFull = 0, iListedBlockSizes = 0, iListedSampleRates = 0, iListedChanges = 0, iListedSignals = 0;
+    double fSeconds = 1.0;
+    int iAccuracy = 0;
+    int iDenormals = 0, iFtzDaz;
+    int iSegment = 0;
+    MmapControlSegment * psSegment = NULL;
+    double fMaxError = -1;
+    int iFailed = 0, iResult;
+    int iOpt, iLib, b, r, c, s, m;
+    unsigned long lIndex;
+
+    while ((iOpt = getopt(argc, argv, "adfme:b:r:c:s:t:")) != -1) {
+        switch (iOpt) {
+        case 'a':
+            iAccuracy = 1;
+            break;
+        case 'd':
+            iDenormals = 1;
+            break;
+        case 'm':
+            iSegment = 1;
+            break;
+        case 'e':
+            fMaxError = atof(optarg);
+            break;
+        case 'f':
+            iFull = 1;
+            break;
+        case 'b':
+            iBlockSizes = parseList(optarg, afBlockSizes);
+            iListedBlockSizes = 1;
+            break;
+        case 'r':
+            iSampleRates = parseList(optarg, afSampleRates);
+            iListedSampleRates = 1;
+            break;
+        case 'c':
+            iChanges = parseList(optarg, afChanges);
+            iListedChanges = 1;
+            break;
+        case 's':
+            iListedSignals = 1;
+            iSignals = 0;
+            if (strstr(optarg, "noise")) {
+                aiSignals[iSignals++] = SIGNAL_NOISE;
+            }
+            if (strstr(optarg, "impulse")) {
+                aiSignals[iSignals++] = SIGNAL_IMPULSE;
+            }
+            break;
+        case 't':
+            fSeconds = atof(optarg);
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [-f] [-b blocksizes] [-r samplerates] [-c changes_per_s]\n"
+                    "       [-s noise,impulse] [-t seconds] plugin.so ...\n"
+                    "       %s -a [-e max_error] [-r samplerates] plugin.so ...\n"
+                    "       %s -d [-r samplerates] plugin.so ...\n"
+                    "       %s -m [-r samplerates] plugin.so ...\n",
+                    argv[0], argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "%s: no plugin libraries given\n", argv[0]);
+        return 1;
+    }
+    if (!iAccuracy && !iDenormals && !iFull) {
+        if (!iListedBlockSizes) {
+            iBlockSizes = 2;
+            memcpy(afBlockSizes, afQuickBlockSizes, sizeof(afQuickBlockSizes));
+        }
+        if (!iListedSampleRates) {
+            iSampleRates = 2;
+            memcpy(afSampleRates, afQuickSampleRates, sizeof(afQuickSampleRates));
+        }
+        if (!iListedChanges) {
+            iChanges = 2;
+            memcpy(afChanges, afQuickChanges, sizeof(afQuickChanges));
+        }
+        if (!iListedSignals) {
+            iSignals = 1;
+        }
+    }
+
+    if (iSegment) {
+        psSegment = attachMmapControlSegment();
+        if (psSegment == NULL) {
+            fprintf(stderr, "%s: can't use the control segment %s\n", argv[0], MMAP_CONTROL_NAME);
+            return 1;
+        }
+        printf("library,label,id,samplerate,locked_while_running,free_after_exit,"
+               "switch_period,result\n");
+    } else if (iDenormals) {
+        printf("library,label,id,samplerate,ftz_daz,early_ns_per_sample,late_ns_per_sample,ratio\n");
+    } else if (iAccuracy) {
+        printf("library,label,id,samplerate,output,impulse_max_error,sweep_max_error,"
+               "noise_max_error,noise_error_db,magnitude_error_db,phase_error_deg\n");
+    } else {
+        printf("library,label,id,samplerate,blocksize,changes_per_s,signal,samples,"
+               "ns_per_sample,cycles_per_sample,changes,recompute_ns,recompute_cycles,latency\n");
+    }
+    for (iLib = optind; iLib < argc; iLib++) {
+        void * pvLib = dlopen(argv[iLib], RTLD_NOW | RTLD_LOCAL);
+        LADSPA_Descriptor_Function pfDescriptor;
+        const LADSPA_Descriptor * psDescriptor;
+        if (pvLib == NULL) {
+            fprintf(stderr, "ERROR: %s\n", dlerror());
+            continue;
+        }
+        pfDescriptor = (LADSPA_Descriptor_Function)dlsym(pvLib, "ladspa_descriptor");
+        if (pfDescriptor == NULL) {
+            fprintf(stderr, "ERROR: %s has no ladspa_descriptor\n", argv[iLib]);
+            dlclose(pvLib);
+            continue;
+        }
+        for (lIndex = 0; (psDescriptor = pfDescriptor(lIndex)) != NULL; lIndex++) {
+            if (iSegment) {
+                iFailed |= runSegment(argv[iLib], psDescriptor, psSegment,
+                                      (unsigned long)afSampleRates[0]);
+                continue;
+            }
+            if (iDenormals) {
+                for (r = 0; r < iSampleRates; r++) {
+                    for (m = 0; m < (HAVE_FTZ_DAZ ? 2 : 1); m++) {
+                        iFtzDaz = HAVE_FTZ_DAZ ? m : -1;
+                        if (runDenormals(argv[iLib], psDescriptor, (unsigned long)afSampleRates[r], iFtzDaz)) {
+                            fprintf(stderr, "FAILED: %s at %lu Hz, silence after an impulse gets slower\n",
+                                    psDescriptor->Label, (unsigned long)afSampleRates[r]);
+                            iFailed = 1;
+                        }
+                    }
+                }
+                continue;
+            }
+            if (iAccuracy) {
+                for (r = 0; r < iSampleRates; r++) {
+                    iResult = runAccuracy(argv[iLib], psDescriptor,
+                                          (unsigned long)afSampleRates[r], fMaxError);
+                    if (iResult < 0) {
+                        fprintf(stderr, "WARNING: no reference model for %s\n", psDescriptor->Label);
+                        break;
+                    }
+                    iFailed |= iResult;
+                }
+                continue;
+            }
+            for (r = 0; r < iSampleRates; r++) {
+                for (b = 0; b < iBlockSizes; b++) {
+                    for (c = 0; c < iChanges; c++) {
+                        for (s = 0; s < iSignals; s++) {
+                            BenchResult result = runCase(psDescriptor,
+                                                         (unsigned long)afSampleRates[r],
+                                                         (unsigned long)afBlockSizes[b],
+                                                         afChanges[c],
+                                                         aiSignals[s],
+                                                         fSeconds);
+                            printf("%s,%s,%lu,%lu,%lu,%g,%s,%lu,%.3f,%.2f,%lu,%.1f,%.0f,%lu\n",
+                                   argv[iLib],
+                                   psDescriptor->Label,
+                                   psDescriptor->UniqueID,
+                                   (unsigned long)afSampleRates[r],
+                                   (unsigned long)afBlockSizes[b],
+                                   afChanges[c],
+                                   apcSignalNames[aiSignals[s]],
+                                   result.samples,
+                                   result.nsPerSample,
+                                   result.cyclesPerSample,
+                                   result.changes,
+                                   result.recomputeNs,
+                                   result.recomputeCycles,
+                                   result.latency);
+                            fflush(stdout);
+                        }
+                    }
+                }
+            }
+        }
+        dlclose(pvLib);
+    }
+    return iFailed;
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,732 @@
+/* cascade.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Shared biquad cascade engine. All sections of a filter chain keep their
+   state in one contiguous array and every sample is pushed through the
+   whole chain in one pass, so the audio buffer is read and written only
+   once per run() no matter how many sections there are.
+
+   New coefficients can either be applied at once or approached with a
+   linear ramp. A ramp moves the coefficients in steps of
+   CASCADE_RAMP_BLOCKSIZE samples, so its cost per sample is bounded and
+   known in advance. Linear interpolation between two stable biquads stays
+   inside the (convex) stability triangle of a1/a2, so a ramp never passes
+   through an unstable filter. Without a running ramp run() costs exactly
+   the same as the unsmoothed kernel.
+
+   Sections are computed in transposed direct form II. Each section keeps
+   its state in float or in double, chosen from the peak gain of its
+   recursive part 1 / A(z): the rounding noise of the state reaches the
+   output amplified by up to this gain. It is large for poles close to
+   the unit circle, but also for any section whose poles are low in
+   frequency relative to the sample rate, whatever their Q, where it
+   grows like 1 / w0^2. Lowpass, highpass and allpass sections of a
+   crossover at 1kHz and 192kHz are such sections. Only sections that
+   amplify the noise of a float state above about -130dB pay for double
+   precision. Define CASCADE_PRECISION as CASCADE_PRECISION_FLOAT or
+   CASCADE_PRECISION_DOUBLE to force one precision for all sections, e.g.
+   for testing.
+
+   Stored state below CASCADE_FLUSH_THRESHOLD is set to zero at the end of
+   every block. Together with disableDenormals() in run() this keeps a
+   silent stream from decaying into denormals, also on CPUs or in
+   precisions where the FPU mode doesn't cover it.
+
+   Every kernel also has a run_adding flavour, which adds its result
+   times the run_adding gain to the output buffer instead of replacing it.
+   The run_adding gain is folded into the gain factor of the last section,
+   so summing costs one add per sample in the same pass and no extra
+   buffer.
+
+   A cascade with a meter accumulator sums up peak, energy and clipped
+   samples of its input and output in the same loop, from the samples
+   that are in registers anyway. The output is metered before the
+   run_adding gain, like all other engines do. Cascades without one run a
+   kernel without any metering code.
+
+   A cascade whose gain factor is folded into the coefficients of its
+   last section (see plan.h) runs a kernel without the multiply by the
+   gain factor.
+
+*/
+
+//#include "helpers.h"
+
+/*****************************************************************************/
+
+#define CASCADE_MAX_SECTIONS 24
+// kernels that take their section count and flavour as compile time
+// constants, always inlined: a generic copy would test them per sample
+#define CASCADE_KERNEL static inline __attribute__((always_inline))
+// number of samples between two coefficient updates of a running ramp
+#define CASCADE_RAMP_BLOCKSIZE 32
+
+#define CASCADE_PRECISION_AUTO 0
+#define CASCADE_PRECISION_FLOAT 1
+#define CASCADE_PRECISION_DOUBLE 2
+#ifndef CASCADE_PRECISION
+#define CASCADE_PRECISION CASCADE_PRECISION_AUTO
+#endif
+// sections whose recursive part has a higher peak gain than this use
+// double precision state, which keeps the rounding noise of the
+// crossovers and EQs below -130dB like the one of the LR-4 filters
+#ifndef CASCADE_DOUBLE_NOISE_GAIN
+#define CASCADE_DOUBLE_NOISE_GAIN 4.0
+#endif
+// state below this (about -600dB) is flushed to zero after each block
+#define CASCADE_FLUSH_THRESHOLD 1e-30
+
+/* state of one transposed direct form II biquad section, kept in double
+   so a section can switch precision between two blocks */
+typedef struct {
+
+  double s1;
+  double s2;
+
+} BiquadState;
+
+/* coefficients of a float precision section, converted for each block */
+typedef struct {
+
+  float a1;
+  float a2;
+  float b0;
+  float b1;
+  float b2;
+
+} BiquadFloatCoeffs;
+
+/* coefficients and state of a chain of biquad sections */
+typedef struct {
+
+  // coefficients currently in use
+  BiquadCoeffs coeffs[CASCADE_MAX_SECTIONS];
+  BiquadState state[CASCADE_MAX_SECTIONS];
+  float gainFactor;
+  // coefficients set by the plugin, reached at the end of a ramp
+  BiquadCoeffs target[CASCADE_MAX_SECTIONS];
+  float targetGainFactor;
+  // per step increments of a running ramp
+  BiquadCoeffs delta[CASCADE_MAX_SECTIONS];
+  float deltaGainFactor;
+  // steps left in the running ramp and samples left in the current step
+  unsigned long rampSteps;
+  unsigned long rampCountdown;
+  // 0 until the first coefficients were applied after reset
+  int hasCoeffs;
+  // 1 for sections computed in double precision
+  int useDouble[CASCADE_MAX_SECTIONS];
+  // levels of input and output are summed up here, null for no metering
+  MeterAccumulator * meter;
+
+} BiquadCascade;
+
+/*****************************************************************************/
+
+/* Prepare a new cascade, called once when a plugin is instantiated. */
+static inline void initBiquadCascade(BiquadCascade * psCascade) {
+  psCascade->meter = NULL;
+}
+
+/* Reset the state of the first SectionCount sections. The first
+   coefficients set after a reset are always applied without a ramp. */
+static inline void resetBiquadCascade(BiquadCascade * psCascade, int SectionCount) {
+  memset(psCascade->state, 0, SectionCount * sizeof(BiquadState));
+  psCascade->rampSteps = 0;
+  psCascade->rampCountdown = 0;
+  psCascade->hasCoeffs = 0;
+}
+
+/* v, or 0 if it is too small to matter. */
+static inline double flushBiquadState(double v) {
+  return fabs(v) < CASCADE_FLUSH_THRESHOLD ? 0.0 : v;
+}
+
+/* Peak gain of the recursive part 1 / A(z) of a biquad section over all
+   frequencies, or HUGE_VAL for poles on or outside the unit circle.
+   |A|^2 is a quadratic in c = cos(w), minimized at its vertex or at one
+   of the ends c = +-1. */
+static inline double biquadNoiseGain(const BiquadCoeffs * psCoeffs) {
+  double a1 = psCoeffs->a1;
+  double a2 = psCoeffs->a2;
+  double c, m, mc;
+  if (fabs(a2) >= 1.0 || fabs(a1) >= 1.0 + a2) {
+    return HUGE_VAL;
+  }
+  // |A(e^jw)|^2 = 4 a2 c^2 + 2 a1 (1 + a2) c + (1 - a2)^2 + a1^2
+  m = (1.0 + a1 + a2) * (1.0 + a1 + a2);
+  mc = (1.0 - a1 + a2) * (1.0 - a1 + a2);
+  m = mc < m ? mc : m;
+  if (a2 > 0) {
+    c = -a1 * (1.0 + a2) / (4.0 * a2);
+    if (c > -1.0 && c < 1.0) {
+      mc = 4.0 * a2 * c * c + 2.0 * a1 * (1.0 + a2) * c
+           + (1.0 - a2) * (1.0 - a2) + a1 * a1;
+      m = mc < m ? mc : m;
+    }
+  }
+  return m > 0 ? 1.0 / sqrt(m) : HUGE_VAL;
+}
+
+/* Returns 1 if a section with these coefficients needs double state. */
+static inline int biquadNeedsDouble(const BiquadCoeffs * psCoeffs) {
+#if CASCADE_PRECISION == CASCADE_PRECISION_AUTO
+  return biquadNoiseGain(psCoeffs) > CASCADE_DOUBLE_NOISE_GAIN;
+#else
+  return CASCADE_PRECISION == CASCADE_PRECISION_DOUBLE;
+#endif
+}
+
+/* Choose the precision of the first SectionCount sections from their
+   current and target coefficients, so it holds for a whole ramp. */
+static inline void selectBiquadCascadePrecision(BiquadCascade * psCascade,
+                                                int SectionCount) {
+  int iSection;
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    psCascade->useDouble[iSection] = biquadNeedsDouble(&psCascade->coeffs[iSection]) ||
+                                     biquadNeedsDouble(&psCascade->target[iSection]);
+  }
+}
+
+/* Start moving all SectionCount sections and the gain factor from their
+   current values to the targets set in psCascade->target and
+   psCascade->targetGainFactor within about RampSamples samples. With
+   RampSamples == 0 (or no coefficients applied yet) the targets are
+   applied at once. */
+static inline void startBiquadCascadeRamp(BiquadCascade * psCascade,
+                                          int SectionCount,
+                                          unsigned long RampSamples) {
+  unsigned long lSteps;
+  float fStep;
+  int iSection;
+  BiquadCoeffs * c;
+  BiquadCoeffs * t;
+  if (RampSamples == 0 || !psCascade->hasCoeffs) {
+    memcpy(psCascade->coeffs, psCascade->target, SectionCount * sizeof(BiquadCoeffs));
+    psCascade->gainFactor = psCascade->targetGainFactor;
+    psCascade->rampSteps = 0;
+    psCascade->hasCoeffs = 1;
+    selectBiquadCascadePrecision(psCascade, SectionCount);
+    return;
+  }
+  selectBiquadCascadePrecision(psCascade, SectionCount);
+  lSteps = (RampSamples + CASCADE_RAMP_BLOCKSIZE - 1) / CASCADE_RAMP_BLOCKSIZE;
+  fStep = 1.0 / lSteps;
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    c = &psCascade->coeffs[iSection];
+    t = &psCascade->target[iSection];
+    psCascade->delta[iSection].a1 = (t->a1 - c->a1) * fStep;
+    psCascade->delta[iSection].a2 = (t->a2 - c->a2) * fStep;
+    psCascade->delta[iSection].b0 = (t->b0 - c->b0) * fStep;
+    psCascade->delta[iSection].b1 = (t->b1 - c->b1) * fStep;
+    psCascade->delta[iSection].b2 = (t->b2 - c->b2) * fStep;
+  }
+  psCascade->deltaGainFactor = (psCascade->targetGainFactor - psCascade->gainFactor)
+                               * fStep;
+  psCascade->rampSteps = lSteps;
+}
+
+/* Move the coefficients of a running ramp one step towards the targets. */
+static inline void stepBiquadCascadeRamp(BiquadCascade * psCascade,
+                                         const int SectionCount) {
+  int iSection;
+  BiquadCoeffs * c;
+  BiquadCoeffs * d;
+  psCascade->rampSteps--;
+  if (psCascade->rampSteps == 0) {
+    // land exactly on the targets
+    memcpy(psCascade->coeffs, psCascade->target, SectionCount * sizeof(BiquadCoeffs));
+    psCascade->gainFactor = psCascade->targetGainFactor;
+    return;
+  }
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    c = &psCascade->coeffs[iSection];
+    d = &psCascade->delta[iSection];
+    c->a1 += d->a1;
+    c->a2 += d->a2;
+    c->b0 += d->b0;
+    c->b1 += d->b1;
+    c->b2 += d->b2;
+  }
+  psCascade->gainFactor += psCascade->deltaGainFactor;
+}
+
+/* Run SampleCount samples through SectionCount sections in a single pass
+   with fixed coefficients. SectionCount is meant to be a compile time
+   constant at every call site: after inlining the section loop is fully
+   unrolled and the section state lives in registers for the whole block.
+   The precision test per section is the same for every sample, so it is
+   predicted perfectly. pfInput and pfOutput may point to the same buffer.
+   The gain factor is applied to the output of the last section. With
+   Adding (a compile time constant, too) the output is added to pfOutput
+   after scaling it by fRunAddingGain as well. With Metering (a compile
+   time constant as well) input and output levels are added to
+   psCascade->meter, the output before the run_adding gain. With Unity (a
+   compile time constant, too) the gain factor is taken to be 1 and not
+   applied at all. */
+CASCADE_KERNEL void runBiquadCascadeBlock(BiquadCascade * psCascade,
+                                         const int SectionCount,
+                                         const LADSPA_Data * pfInput,
+                                         LADSPA_Data * pfOutput,
+                                         unsigned long SampleCount,
+                                         const int Adding,
+                                         float fRunAddingGain,
+                                         const int Metering,
+                                         const int Unity) {
+  BiquadCoeffs c[CASCADE_MAX_SECTIONS];
+  BiquadFloatCoeffs fc[CASCADE_MAX_SECTIONS];
+  float fs1[CASCADE_MAX_SECTIONS], fs2[CASCADE_MAX_SECTIONS];
+  double ds1[CASCADE_MAX_SECTIONS], ds2[CASCADE_MAX_SECTIONS];
+  int useDouble[CASCADE_MAX_SECTIONS];
+  unsigned long lSampleIndex;
+  int iSection;
+  float fGainFactor = Unity ? 1.0 : psCascade->gainFactor;
+  // gain factor of the metered output, without the run_adding gain
+  float fMeterGainFactor = fGainFactor;
+  float xn, yn; // xn/yn holds currently processed input/output samples.
+  // the same in double, passed on between double sections, so a sample
+  // is only converted where the precision changes along the chain
+  double dxn = 0, dyn;
+  float ym, fAbs, fInPeak = 0, fOutPeak = 0, fInSquares = 0, fOutSquares = 0;
+  unsigned long lInClips = 0, lOutClips = 0;
+  if (Adding) {
+    fGainFactor *= fRunAddingGain;
+  }
+  // get coefficients and state
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    c[iSection] = psCascade->coeffs[iSection];
+    fc[iSection].a1 = c[iSection].a1;
+    fc[iSection].a2 = c[iSection].a2;
+    fc[iSection].b0 = c[iSection].b0;
+    fc[iSection].b1 = c[iSection].b1;
+    fc[iSection].b2 = c[iSection].b2;
+    useDouble[iSection] = CASCADE_PRECISION == CASCADE_PRECISION_AUTO
+                          ? psCascade->useDouble[iSection]
+                          : CASCADE_PRECISION == CASCADE_PRECISION_DOUBLE;
+    ds1[iSection] = psCascade->state[iSection].s1;
+    ds2[iSection] = psCascade->state[iSection].s2;
+    fs1[iSection] = ds1[iSection];
+    fs2[iSection] = ds2[iSection];
+  }
+  // FILTER PROCESSING, all sections in one pass ///////////////////////////////
+  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+    xn = pfInput[lSampleIndex];
+    if (Metering) {
+      fAbs = fabsf(xn);
+      fInPeak = fAbs > fInPeak ? fAbs : fInPeak;
+      fInSquares += xn * xn;
+      lInClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    for (iSection = 0; iSection < SectionCount; iSection++) {
+      // output of the previous section is input of this one
+      if (useDouble[iSection]) {
+        if (iSection == 0 || !useDouble[iSection - 1]) {
+          dxn = xn;
+        }
+        dyn = c[iSection].b0 * dxn + ds1[iSection];
+        ds1[iSection] = c[iSection].b1 * dxn - c[iSection].a1 * dyn + ds2[iSection];
+        ds2[iSection] = c[iSection].b2 * dxn - c[iSection].a2 * dyn;
+        dxn = dyn;
+      } else {
+        if (iSection > 0 && useDouble[iSection - 1]) {
+          xn = dxn;
+        }
+        yn = fc[iSection].b0 * xn + fs1[iSection];
+        fs1[iSection] = fc[iSection].b1 * xn - fc[iSection].a1 * yn + fs2[iSection];
+        fs2[iSection] = fc[iSection].b2 * xn - fc[iSection].a2 * yn;
+        xn = yn;
+      }
+    }
+    if (SectionCount > 0 && useDouble[SectionCount - 1]) {
+      xn = dxn;
+    }
+    yn = Unity && !Adding ? xn : xn * fGainFactor;
+    if (Metering) {
+      ym = !Adding ? yn : Unity ? xn : xn * fMeterGainFactor;
+      fAbs = fabsf(ym);
+      fOutPeak = fAbs > fOutPeak ? fAbs : fOutPeak;
+      fOutSquares += ym * ym;
+      lOutClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    if (Adding) {
+      pfOutput[lSampleIndex] += yn;
+    } else {
+      pfOutput[lSampleIndex] = yn;
+    }
+  }
+  if (Metering) {
+    MeterAccumulator * m = psCascade->meter;
+    m->inPeak = fInPeak > m->inPeak ? fInPeak : m->inPeak;
+    m->outPeak = fOutPeak > m->outPeak ? fOutPeak : m->outPeak;
+    m->inSquares += fInSquares;
+    m->outSquares += fOutSquares;
+    m->samples += SampleCount;
+    m->inClips += lInClips;
+    m->outClips += lOutClips;
+  }
+  // store state in cascade for later
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    if (useDouble[iSection]) {
+      psCascade->state[iSection].s1 = flushBiquadState(ds1[iSection]);
+      psCascade->state[iSection].s2 = flushBiquadState(ds2[iSection]);
+    } else {
+      psCascade->state[iSection].s1 = flushBiquadState(fs1[iSection]);
+      psCascade->state[iSection].s2 = flushBiquadState(fs2[iSection]);
+    }
+  }
+}
+
+/* Run SampleCount samples through SectionCount sections, advancing a
+   running coefficient ramp every CASCADE_RAMP_BLOCKSIZE samples. Adding,
+   Metering and Unity select the kernel flavour, see
+   runBiquadCascadeBlock(). */
+CASCADE_KERNEL void runBiquadCascadeRamp(BiquadCascade * psCascade,
+                                        const int SectionCount,
+                                        const LADSPA_Data * pfInput,
+                                        LADSPA_Data * pfOutput,
+                                        unsigned long SampleCount,
+                                        const int Adding,
+                                        float fRunAddingGain,
+                                        const int Metering,
+                                        const int Unity) {
+  unsigned long lBlockSize;
+  while (SampleCount > 0) {
+    if (psCascade->rampCountdown == 0) {
+      if (psCascade->rampSteps == 0) {
+        // no ramp running, process the rest in one go
+        runBiquadCascadeBlock(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                              Adding, fRunAddingGain, Metering, Unity);
+        return;
+      }
+      stepBiquadCascadeRamp(psCascade, SectionCount);
+      psCascade->rampCountdown = CASCADE_RAMP_BLOCKSIZE;
+    }
+    lBlockSize = SampleCount < psCascade->rampCountdown ? SampleCount
+                                                        : psCascade->rampCountdown;
+    runBiquadCascadeBlock(psCascade, SectionCount, pfInput, pfOutput, lBlockSize,
+                          Adding, fRunAddingGain, Metering, Unity);
+    psCascade->rampCountdown -= lBlockSize;
+    SampleCount -= lBlockSize;
+    pfInput += lBlockSize;
+    pfOutput += lBlockSize;
+  }
+}
+
+/* Run SampleCount samples through SectionCount sections, with or without
+   metering depending on psCascade->meter. Adding selects the kernel
+   flavour, see runBiquadCascadeBlock(). */
+CASCADE_KERNEL void runBiquadCascadeMode(BiquadCascade * psCascade,
+                                        const int SectionCount,
+                                        const LADSPA_Data * pfInput,
+                                        LADSPA_Data * pfOutput,
+                                        unsigned long SampleCount,
+                                        const int Adding,
+                                        float fRunAddingGain) {
+#if MMAP_METERING
+  if (psCascade->meter != NULL) {
+    runBiquadCascadeRamp(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                         Adding, fRunAddingGain, 1, 0);
+    return;
+  }
+#endif
+  runBiquadCascadeRamp(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                       Adding, fRunAddingGain, 0, 0);
+}
+
+/* Run SampleCount samples through SectionCount sections whose gain factor
+   is folded into the coefficients, like runBiquadCascadeMode() but
+   without applying the gain factor. */
+CASCADE_KERNEL void runUnityBiquadCascadeMode(BiquadCascade * psCascade,
+                                             const int SectionCount,
+                                             const LADSPA_Data * pfInput,
+                                             LADSPA_Data * pfOutput,
+                                             unsigned long SampleCount,
+                                             const int Adding,
+                                             float fRunAddingGain) {
+#if MMAP_METERING
+  if (psCascade->meter != NULL) {
+    runBiquadCascadeRamp(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                         Adding, fRunAddingGain, 1, 1);
+    return;
+  }
+#endif
+  runBiquadCascadeRamp(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                       Adding, fRunAddingGain, 0, 1);
+}
+
+/* Run SampleCount samples through SectionCount sections and write the
+   result to pfOutput. */
+static inline void runBiquadCascade(BiquadCascade * psCascade,
+                                    const int SectionCount,
+                                    const LADSPA_Data * pfInput,
+                                    LADSPA_Data * pfOutput,
+                                    unsigned long SampleCount) {
+  runBiquadCascadeMode(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                       0, 1.0);
+}
+
+/* Run SampleCount samples through SectionCount sections and add the
+   result times fRunAddingGain to pfOutput. */
+static inline void runAddingBiquadCascade(BiquadCascade * psCascade,
+                                          const int SectionCount,
+                                          const LADSPA_Data * pfInput,
+                                          LADSPA_Data * pfOutput,
+                                          unsigned long SampleCount,
+                                          float fRunAddingGain) {
+  runBiquadCascadeMode(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                       1, fRunAddingGain);
+}
+
+/* Multichannel cascade *****************************************************/
+
+/* Up to CASCADE_MAX_LANES channels run through the same chain of sections,
+   one channel per SIMD lane. Coefficients and state are kept as structure
+   of arrays of vectors of 4 lanes, so every step of the biquad recursion
+   is one vector operation for 4 channels. 8 channels use two independent
+   vectors per section, which keeps two recursions in flight on
+   out-of-order cores. Channels can share coefficients or have their own.
+
+   Sections are computed in transposed direct form II like the single
+   channel cascade, and follow the same precision rule: coefficients and
+   state are kept in double, a section runs in double precision if any of
+   its lanes needs it (see biquadNeedsDouble()), in float otherwise. */
+
+#define CASCADE_MAX_LANES 8
+#define CASCADE_VECTOR_LANES 4
+#define CASCADE_MAX_VECTORS (CASCADE_MAX_LANES / CASCADE_VECTOR_LANES)
+
+typedef float LaneVector
+  __attribute__((vector_size(CASCADE_VECTOR_LANES * sizeof(float))));
+typedef double LaneDoubleVector
+  __attribute__((vector_size(CASCADE_VECTOR_LANES * sizeof(double))));
+
+/* coefficients of one section for every lane */
+typedef struct {
+
+  LaneDoubleVector a1[CASCADE_MAX_VECTORS];
+  LaneDoubleVector a2[CASCADE_MAX_VECTORS];
+  LaneDoubleVector b0[CASCADE_MAX_VECTORS];
+  LaneDoubleVector b1[CASCADE_MAX_VECTORS];
+  LaneDoubleVector b2[CASCADE_MAX_VECTORS];
+
+} BiquadLaneCoeffs;
+
+/* coefficients of one float precision section for every lane, converted
+   for each block */
+typedef struct {
+
+  LaneVector a1[CASCADE_MAX_VECTORS];
+  LaneVector a2[CASCADE_MAX_VECTORS];
+  LaneVector b0[CASCADE_MAX_VECTORS];
+  LaneVector b1[CASCADE_MAX_VECTORS];
+  LaneVector b2[CASCADE_MAX_VECTORS];
+
+} BiquadLaneFloatCoeffs;
+
+/* state of one section for every lane, kept in double so a section can
+   switch precision between two blocks */
+typedef struct {
+
+  LaneDoubleVector s1[CASCADE_MAX_VECTORS];
+  LaneDoubleVector s2[CASCADE_MAX_VECTORS];
+
+} BiquadLaneState;
+
+/* coefficients and state of a chain of biquad sections for several lanes */
+typedef struct {
+
+  BiquadLaneCoeffs coeffs[CASCADE_MAX_SECTIONS];
+  BiquadLaneState state[CASCADE_MAX_SECTIONS];
+  LaneVector gainFactor[CASCADE_MAX_VECTORS];
+  // bit i is set if lane i of a section needs double precision
+  unsigned int doubleLanes[CASCADE_MAX_SECTIONS];
+
+} BiquadLaneCascade;
+
+typedef long long LaneDoubleMask
+  __attribute__((vector_size(CASCADE_VECTOR_LANES * sizeof(long long))));
+
+/* Store v in *pv with every lane below CASCADE_FLUSH_THRESHOLD set to
+   zero. */
+static inline void flushBiquadLaneState(LaneDoubleVector * pv, LaneDoubleVector v) {
+  const LaneDoubleVector t = (LaneDoubleVector){ 0, 0, 0, 0 } + CASCADE_FLUSH_THRESHOLD;
+  LaneDoubleMask keep = (v > t) | (v < -t);
+  *pv = (LaneDoubleVector)((LaneDoubleMask)v & keep);
+}
+
+/* Reset coefficients, gain and state of all lanes. Unused lanes then
+   compute silence. */
+static inline void resetBiquadLaneCascade(BiquadLaneCascade * psCascade) {
+  memset(psCascade, 0, sizeof(BiquadLaneCascade));
+}
+
+/* Set the coefficients of section iSection of lane iLane. */
+static inline void setBiquadLaneCoeffs(BiquadLaneCascade * psCascade,
+                                       int iSection,
+                                       int iLane,
+                                       BiquadCoeffs coeffs) {
+  BiquadLaneCoeffs * c = &psCascade->coeffs[iSection];
+  int v = iLane / CASCADE_VECTOR_LANES;
+  int l = iLane % CASCADE_VECTOR_LANES;
+  c->a1[v][l] = coeffs.a1;
+  c->a2[v][l] = coeffs.a2;
+  c->b0[v][l] = coeffs.b0;
+  c->b1[v][l] = coeffs.b1;
+  c->b2[v][l] = coeffs.b2;
+  if (biquadNeedsDouble(&coeffs)) {
+    psCascade->doubleLanes[iSection] |= 1u << iLane;
+  } else {
+    psCascade->doubleLanes[iSection] &= ~(1u << iLane);
+  }
+}
+
+/* Set the gain factor of lane iLane. */
+static inline void setBiquadLaneGainFactor(BiquadLaneCascade * psCascade,
+                                           int iLane,
+                                           float fGainFactor) {
+  int v = iLane / CASCADE_VECTOR_LANES;
+  int l = iLane % CASCADE_VECTOR_LANES;
+  psCascade->gainFactor[v][l] = fGainFactor;
+}
+
+/* Run SampleCount samples of Lanes channels through SectionCount sections
+   in a single pass. Both counts are meant to be compile time constants at
+   every call site. The precision test per section is the same for every
+   sample, so it is predicted perfectly. ppfInput[i] and ppfOutput[i] may
+   point to the same buffer. With Adding (a compile time constant, too)
+   the output is scaled by fRunAddingGain and added to ppfOutput[i]. */
+static inline void runBiquadLaneCascadeMode(BiquadLaneCascade * psCascade,
+                                            const int SectionCount,
+                                            const int Lanes,
+                                            LADSPA_Data * const * ppfInput,
+                                            LADSPA_Data * const * ppfOutput,
+                                            unsigned long SampleCount,
+                                            const int Adding,
+                                            float fRunAddingGain) {
+  const int Vectors = (Lanes + CASCADE_VECTOR_LANES - 1) / CASCADE_VECTOR_LANES;
+  BiquadLaneCoeffs c[CASCADE_MAX_SECTIONS];
+  BiquadLaneFloatCoeffs fc[CASCADE_MAX_SECTIONS];
+  LaneVector fs1[CASCADE_MAX_SECTIONS][CASCADE_MAX_VECTORS];
+  LaneVector fs2[CASCADE_MAX_SECTIONS][CASCADE_MAX_VECTORS];
+  LaneDoubleVector ds1[CASCADE_MAX_SECTIONS][CASCADE_MAX_VECTORS];
+  LaneDoubleVector ds2[CASCADE_MAX_SECTIONS][CASCADE_MAX_VECTORS];
+  int useDouble[CASCADE_MAX_SECTIONS];
+  LaneVector g[CASCADE_MAX_VECTORS];
+  LaneVector xn[CASCADE_MAX_VECTORS], yn;
+  // the same in double, only converted where the precision changes
+  LaneDoubleVector dxn[CASCADE_MAX_VECTORS], dyn;
+  unsigned long lSampleIndex;
+  int iSection, iLane, v;
+  // get coefficients and state
+  memcpy(c, psCascade->coeffs, SectionCount * sizeof(BiquadLaneCoeffs));
+  memcpy(g, psCascade->gainFactor, sizeof(g));
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    useDouble[iSection] = CASCADE_PRECISION == CASCADE_PRECISION_AUTO
+                          ? psCascade->doubleLanes[iSection] != 0
+                          : CASCADE_PRECISION == CASCADE_PRECISION_DOUBLE;
+    for (v = 0; v < Vectors; v++) {
+      fc[iSection].a1[v] = __builtin_convertvector(c[iSection].a1[v], LaneVector);
+      fc[iSection].a2[v] = __builtin_convertvector(c[iSection].a2[v], LaneVector);
+      fc[iSection].b0[v] = __builtin_convertvector(c[iSection].b0[v], LaneVector);
+      fc[iSection].b1[v] = __builtin_convertvector(c[iSection].b1[v], LaneVector);
+      fc[iSection].b2[v] = __builtin_convertvector(c[iSection].b2[v], LaneVector);
+      ds1[iSection][v] = psCascade->state[iSection].s1[v];
+      ds2[iSection][v] = psCascade->state[iSection].s2[v];
+      fs1[iSection][v] = __builtin_convertvector(ds1[iSection][v], LaneVector);
+      fs2[iSection][v] = __builtin_convertvector(ds2[iSection][v], LaneVector);
+    }
+  }
+  if (Adding) {
+    for (v = 0; v < Vectors; v++) {
+      g[v] *= fRunAddingGain;
+    }
+  }
+  memset(xn, 0, sizeof(xn));
+  memset(dxn, 0, sizeof(dxn));
+  // FILTER PROCESSING, all sections and lanes in one pass ////////////////////
+  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+    for (iLane = 0; iLane < Lanes; iLane++) {
+      xn[iLane / CASCADE_VECTOR_LANES][iLane % CASCADE_VECTOR_LANES] =
+        ppfInput[iLane][lSampleIndex];
+    }
+    for (iSection = 0; iSection < SectionCount; iSection++) {
+      for (v = 0; v < Vectors; v++) {
+        // output of the previous section is input of this one
+        if (useDouble[iSection]) {
+          if (iSection == 0 || !useDouble[iSection - 1]) {
+            dxn[v] = __builtin_convertvector(xn[v], LaneDoubleVector);
+          }
+          dyn = c[iSection].b0[v] * dxn[v] + ds1[iSection][v];
+          ds1[iSection][v] = c[iSection].b1[v] * dxn[v] - c[iSection].a1[v] * dyn
+                             + ds2[iSection][v];
+          ds2[iSection][v] = c[iSection].b2[v] * dxn[v] - c[iSection].a2[v] * dyn;
+          dxn[v] = dyn;
+        } else {
+          if (iSection > 0 && useDouble[iSection - 1]) {
+            xn[v] = __builtin_convertvector(dxn[v], LaneVector);
+          }
+          yn = fc[iSection].b0[v] * xn[v] + fs1[iSection][v];
+          fs1[iSection][v] = fc[iSection].b1[v] * xn[v] - fc[iSection].a1[v] * yn
+                             + fs2[iSection][v];
+          fs2[iSection][v] = fc[iSection].b2[v] * xn[v] - fc[iSection].a2[v] * yn;
+          xn[v] = yn;
+        }
+      }
+    }
+    for (v = 0; v < Vectors; v++) {
+      if (SectionCount > 0 && useDouble[SectionCount - 1]) {
+        xn[v] = __builtin_convertvector(dxn[v], LaneVector);
+      }
+      yn = xn[v] * g[v];
+      for (iLane = v * CASCADE_VECTOR_LANES;
+           iLane < Lanes && iLane < (v + 1) * CASCADE_VECTOR_LANES;
+           iLane++) {
+        if (Adding) {
+          ppfOutput[iLane][lSampleIndex] += yn[iLane % CASCADE_VECTOR_LANES];
+        } else {
+          ppfOutput[iLane][lSampleIndex] = yn[iLane % CASCADE_VECTOR_LANES];
+        }
+      }
+    }
+  }
+  // store state in cascade for later
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    for (v = 0; v < Vectors; v++) {
+      if (!useDouble[iSection]) {
+        ds1[iSection][v] = __builtin_convertvector(fs1[iSection][v], LaneDoubleVector);
+        ds2[iSection][v] = __builtin_convertvector(fs2[iSection][v], LaneDoubleVector);
+      }
+      flushBiquadLaneState(&psCascade->state[iSection].s1[v], ds1[iSection][v]);
+      flushBiquadLaneState(&psCascade->state[iSection].s2[v], ds2[iSection][v]);
+    }
+  }
+}
+
+/* Run SampleCount samples of Lanes channels through SectionCount sections
+   and write the results to ppfOutput. */
+static inline void runBiquadLaneCascade(BiquadLaneCascade * psCascade,
+                                        const int SectionCount,
+                                        const int Lanes,
+                                        LADSPA_Data * const * ppfInput,
+                                        LADSPA_Data * const * ppfOutput,
+                                        unsigned long SampleCount) {
+  runBiquadLaneCascadeMode(psCascade, SectionCount, Lanes, ppfInput, ppfOutput,
+                           SampleCount, 0, 1.0);
+}
+
+/* Run SampleCount samples of Lanes channels through SectionCount sections
+   and add the results times fRunAddingGain to ppfOutput. */
+static inline void runAddingBiquadLaneCascade(BiquadLaneCascade * psCascade,
+                                              const int SectionCount,
+                                              const int Lanes,
+                                              LADSPA_Data * const * ppfInput,
+                                              LADSPA_Data * const * ppfOutput,
+                                              unsigned long SampleCount,
+                                              float fRunAddingGain) {
+  runBiquadLaneCascadeMode(psCascade, SectionCount, Lanes, ppfInput, ppfOutput,
+                           SampleCount, 1, fRunAddingGain);
+}
+
+/* EOF */
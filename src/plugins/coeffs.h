@@ -0,0 +1,107 @@
+/* coeffs.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Biquad coefficient calculations (RBJ audio EQ cookbook) with libm. The
+   plugins design their sections with design.h, these are the reference
+   its formulas and error bounds are checked against.
+
+*/
+
+//#include "helpers.h"
+
+/*****************************************************************************/
+
+static inline BiquadCoeffs calcCoeffsLowShelf(float f, float g, float q, float samplerate) {
+    BiquadCoeffs coeffs;
+    double w0 = 2.0 * M_PI * f / samplerate;
+    double alpha = sin(w0) / (2.0 * q);
+    double A = pow(10, g / 40.0);
+    double cs = cos(w0);
+    double norm = 1 / ((A+1.0) + (A-1.0)*cs + 2.0*sqrt(A)*alpha);
+    coeffs.b0 = norm * (    A*( (A+1.0) - (A-1.0)*cs + 2.0*sqrt(A)*alpha ));
+    coeffs.b1 = norm * (2.0*A*( (A-1.0) - (A+1.0)*cs                     ));
+    coeffs.b2 = norm * (    A*( (A+1.0) - (A-1.0)*cs - 2.0*sqrt(A)*alpha ));
+    coeffs.a1 = norm * ( -2.0*( (A-1.0) + (A+1.0)*cs                     ));
+    coeffs.a2 = norm * (        (A+1.0) + (A-1.0)*cs - 2.0*sqrt(A)*alpha);
+    return coeffs;
+}
+
+static inline BiquadCoeffs calcCoeffsPeaking(float f, float g, float q, float samplerate) {
+    BiquadCoeffs coeffs;
+    double w0 = 2.0 * M_PI * f / samplerate;
+    double alpha = sin(w0) / (2.0 * q);
+    double A = pow(10, g / 40.0);
+    double cs = cos(w0);
+    double norm = 1 / (1.0 + alpha / A);
+    coeffs.b0 = norm * (1.0 + alpha * A);
+    coeffs.b1 = norm * (-2.0 * cs);
+    coeffs.b2 = norm * (1.0 - alpha * A);
+    coeffs.a1 = norm * (-2.0 * cs);
+    coeffs.a2 = norm * (1.0 - alpha / A);
+    return coeffs;
+}
+
+static inline BiquadCoeffs calcCoeffsHighShelf(float f, float g, float q, float samplerate) {
+    BiquadCoeffs coeffs;
+    double w0 = 2.0 * M_PI * f / samplerate;
+    double alpha = sin(w0) / (2.0 * q);
+    double A = pow(10, g / 40.0);
+    double cs = cos(w0);
+    double norm = 1 / ((A+1.0) - (A-1.0)*cs + 2.0*sqrt(A)*alpha);
+    coeffs.b0 = norm * (     A*( (A+1.0) + (A-1.0)*cs + 2.0*sqrt(A)*alpha ));
+    coeffs.b1 = norm * (-2.0*A*( (A-1.0) + (A+1.0)*cs                     ));
+    coeffs.b2 = norm * (     A*( (A+1.0) + (A-1.0)*cs - 2.0*sqrt(A)*alpha ));
+    coeffs.a1 = norm * (   2.0*( (A-1.0) - (A+1.0)*cs                     ));
+    coeffs.a2 = norm * (         (A+1.0) - (A-1.0)*cs - 2.0*sqrt(A)*alpha);
+    return coeffs;
+}
+
+/* Calculates the coefficients of one butterworth pass of a LR-4 filter. */
+static inline BiquadCoeffs calcCoeffsLr4Lowpass(float f, float samplerate) {
+    BiquadCoeffs coeffs;
+    double w0 = 2 * M_PI * f / samplerate;
+    double alpha = sin(w0) / 2 / 0.7071067811865476; // Butterworth characteristic, Q = 0.707...
+    double cs = cos(w0);
+    double norm = 1 / (1 + alpha);
+    coeffs.b0 = (1 - cs) / 2 * norm;
+    coeffs.b1 = (1 - cs) * norm;
+    coeffs.b2 = coeffs.b0;
+    coeffs.a1 = -2 * cs * norm;
+    coeffs.a2 = (1 - alpha) * norm;
+    return coeffs;
+}
+
+static inline BiquadCoeffs calcCoeffsLr4Highpass(float f, float samplerate) {
+    BiquadCoeffs coeffs;
+    double w0 = 2 * M_PI * f / samplerate;
+    double alpha = sin(w0) / 2 / 0.7071067811865476; // Butterworth characteristic, Q = 0.707...
+    double cs = cos(w0);
+    double norm = 1 / (1 + alpha);
+    coeffs.b0 = (1 + cs) / 2 * norm;
+    coeffs.b1 = -1.0 * (1 + cs) * norm;
+    coeffs.b2 = coeffs.b0;
+    coeffs.a1 = -2 * cs * norm;
+    coeffs.a2 = (1 - alpha) * norm;
+    return coeffs;
+}
+
+/* Calculates the coefficients of the allpass a LR-4 low- and highpass pair
+   at the same frequency sums up to. Used to keep the phase of bands that
+   don't contain a crossover aligned with the ones that do. */
+static inline BiquadCoeffs calcCoeffsLr4Allpass(float f, float samplerate) {
+    BiquadCoeffs coeffs;
+    double w0 = 2 * M_PI * f / samplerate;
+    double alpha = sin(w0) / 2 / 0.7071067811865476; // Butterworth characteristic, Q = 0.707...
+    double cs = cos(w0);
+    double norm = 1 / (1 + alpha);
+    coeffs.b0 = (1 - alpha) * norm;
+    coeffs.b1 = -2 * cs * norm;
+    coeffs.b2 = 1;
+    coeffs.a1 = -2 * cs * norm;
+    coeffs.a2 = (1 - alpha) * norm;
+    return coeffs;
+}
+
+/* EOF */
@@ -0,0 +1,284 @@
+/* delay.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Delay line for the time alignment of drivers. The ring buffer is
+   allocated once for the longest delay, its length is a power of 2, so
+   positions wrap with a mask and a block crosses the end of the buffer at
+   most once. A delay of a whole number of samples is two memcpy()s in and
+   at most two out, without touching the samples.
+
+   A fixed fractional delay is a first order Thiran allpass behind the
+   integer part, with its fraction d kept between 0.5 and 1.5:
+
+     a = (1 - d) / (1 + d)
+     y[n] = a * (x[n - N] - y[n - 1]) + x[n - N - 1]
+
+   It has a flat magnitude response, the group delay is exact at DC and
+   drifts towards the top octave. A third order Lagrange interpolator would
+   lose almost 9dB at 20kHz at a sample rate of 48kHz.
+
+   Delay changes glide linearly in delay time, the output moves with the
+   pitch shift this means instead of jumping. During a glide the allpass
+   would ring whenever its coefficient changes, so the delay is read with
+   the Farrow structure of the cubic Lagrange interpolator there, which has
+   no state and takes a new fraction at every sample. When the glide ends
+   the allpass takes over, its state is seeded with the last interpolated
+   output.
+
+   Delays closer than DELAY_INTEGER_EPSILON to a whole number of samples
+   are rounded to it, e.g. ones given in ms for a latency in samples. */
+
+//#include "helpers.h"
+
+/*****************************************************************************/
+
+// longest delay
+#define DELAY_MAX_MS          100
+// samples processed per call of runDelayLine(), the ring buffer holds
+// this many on top of the longest delay
+#define DELAY_BLOCKSIZE       1024
+// fractions of a sample below this are rounded away
+#define DELAY_INTEGER_EPSILON 1e-3
+// shortest glide, a jump of the delay always clicks
+#define DELAY_MIN_GLIDE_MS    5
+
+/* ring buffer, delay and interpolation state of one channel */
+typedef struct {
+
+  // ring buffer of mask + 1 samples, null if it couldn't be allocated
+  float * buffer;
+  unsigned long mask;
+  // where the next input sample goes
+  unsigned long writePos;
+  // longest delay in samples
+  double maxDelay;
+  // current delay in samples, the one reached at the end of a glide and the
+  // change per sample during the glide
+  double delay;
+  double target;
+  double step;
+  unsigned long rampSamples;
+  // integer part, and allpass coefficient and state of a fractional delay
+  unsigned long integer;
+  int fractional;
+  float allpass;
+  float allpassState;
+  // levels of input and output are summed up here, null for no metering
+  MeterAccumulator * meter;
+
+} DelayLine;
+
+/*****************************************************************************/
+
+/* Allocate the ring buffer for delays up to MaxDelay samples. Returns 0 if
+   malloc() failed. */
+static inline int initDelayLine(DelayLine * psLine, double MaxDelay) {
+  unsigned long lLength = 1;
+  // the Lagrange interpolator reads up to 2 samples behind the delay
+  while (lLength < (unsigned long)MaxDelay + 3 + DELAY_BLOCKSIZE) {
+    lLength <<= 1;
+  }
+  psLine->buffer = (float *)malloc(lLength * sizeof(float));
+  psLine->mask = lLength - 1;
+  psLine->maxDelay = MaxDelay;
+  psLine->meter = NULL;
+  return psLine->buffer != NULL;
+}
+
+/* Free the ring buffer. */
+static inline void freeDelayLine(DelayLine * psLine) {
+  free(psLine->buffer);
+  psLine->buffer = NULL;
+}
+
+/* Silence the ring buffer, the next delay set is applied at once. */
+static inline void resetDelayLine(DelayLine * psLine) {
+  memset(psLine->buffer, 0, (psLine->mask + 1) * sizeof(float));
+  psLine->writePos = 0;
+  psLine->rampSamples = 0;
+  psLine->allpassState = 0;
+  psLine->delay = -1;
+  psLine->target = -1;
+}
+
+/* Split the fixed delay psLine->delay into the integer part and the
+   allpass, or only the integer part if it is close enough to one. */
+static inline void setDelayLineFraction(DelayLine * psLine) {
+  double fDelay = psLine->delay, d;
+  if (fabs(fDelay - floor(fDelay + 0.5)) < DELAY_INTEGER_EPSILON) {
+    psLine->integer = (unsigned long)floor(fDelay + 0.5);
+    psLine->fractional = 0;
+    return;
+  }
+  // d between 0.5 and 1.5, or below if the delay is shorter than that
+  psLine->integer = fDelay < 1.5 ? 0 : (unsigned long)floor(fDelay - 0.5);
+  d = fDelay - psLine->integer;
+  psLine->allpass = (1 - d) / (1 + d);
+  psLine->fractional = 1;
+}
+
+/* Move to a delay of Delay samples within RampSamples samples, but at
+   least DELAY_MIN_GLIDE_MS. The first delay after a reset is applied at
+   once. Returns 1 if the delay changed. */
+static inline int setDelayLineTarget(DelayLine * psLine,
+                                      double Delay,
+                                      unsigned long RampSamples,
+                                      float samplerate) {
+  unsigned long lMinSamples = msToSamples(DELAY_MIN_GLIDE_MS, samplerate);
+  Delay = Delay > 0 ? Delay : 0;
+  Delay = Delay < psLine->maxDelay ? Delay : psLine->maxDelay;
+  if (Delay == psLine->target) {
+    return 0;
+  }
+  psLine->target = Delay;
+  if (psLine->delay < 0) {
+    psLine->delay = Delay;
+    setDelayLineFraction(psLine);
+    return 1;
+  }
+  RampSamples = RampSamples > lMinSamples ? RampSamples : lMinSamples;
+  psLine->step = (Delay - psLine->delay) / RampSamples;
+  psLine->rampSamples = RampSamples;
+  return 1;
+}
+
+/* Copy SampleCount samples from the ring buffer, starting at lReadPos. */
+static inline void readDelayLine(DelayLine * psLine,
+                                 unsigned long lReadPos,
+                                 LADSPA_Data * pfOutput,
+                                 unsigned long SampleCount,
+                                 const int Adding,
+                                 float fRunAddingGain) {
+  unsigned long lSampleIndex, lFirst;
+  lReadPos &= psLine->mask;
+  lFirst = psLine->mask + 1 - lReadPos;
+  lFirst = SampleCount < lFirst ? SampleCount : lFirst;
+  if (!Adding) {
+    memcpy(pfOutput, psLine->buffer + lReadPos, lFirst * sizeof(float));
+    memcpy(pfOutput + lFirst, psLine->buffer, (SampleCount - lFirst) * sizeof(float));
+  } else {
+    for (lSampleIndex = 0; lSampleIndex < lFirst; lSampleIndex++) {
+      pfOutput[lSampleIndex] += psLine->buffer[lReadPos + lSampleIndex] * fRunAddingGain;
+    }
+    for (; lSampleIndex < SampleCount; lSampleIndex++) {
+      pfOutput[lSampleIndex] += psLine->buffer[lSampleIndex - lFirst] * fRunAddingGain;
+    }
+  }
+  if (psLine->meter != NULL) {
+    meterSamples(psLine->meter, psLine->buffer + lReadPos, lFirst, 1);
+    meterSamples(psLine->meter, psLine->buffer, SampleCount - lFirst, 1);
+  }
+}
+
+/* Fixed fractional delay through the allpass, or a glide through the
+   Lagrange interpolator with Gliding. Sample i of the block is at
+   lStartPos + i in the ring buffer. Returns the number of samples done,
+   a glide stops at its end. */
+static inline unsigned long interpolateDelayLine(DelayLine * psLine,
+                                                 unsigned long lStartPos,
+                                                 LADSPA_Data * pfOutput,
+                                                 unsigned long SampleCount,
+                                                 const int Gliding,
+                                                 const int Adding,
+                                                 float fRunAddingGain) {
+  const float * x = psLine->buffer;
+  const unsigned long mask = psLine->mask;
+  const float a = psLine->allpass;
+  float y = psLine->allpassState, f, c0, c1, c2, c3, xm1, x0, x1, x2;
+  float fAbs, fPeak = 0, fSquares = 0;
+  unsigned long lSampleIndex, lPos, lClips = 0, N;
+  double fDelay = psLine->delay;
+  if (Gliding && SampleCount > psLine->rampSamples) {
+    SampleCount = psLine->rampSamples;
+  }
+  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+    lPos = lStartPos + lSampleIndex;
+    if (Gliding) {
+      fDelay += psLine->step;
+      // N >= 1, the sample after x[n - N] has to be there already
+      N = fDelay < 1 ? 1 : (unsigned long)fDelay;
+      f = fDelay - N;
+      xm1 = x[(lPos - N + 1) & mask];
+      x0 = x[(lPos - N) & mask];
+      x1 = x[(lPos - N - 1) & mask];
+      x2 = x[(lPos - N - 2) & mask];
+      // Farrow form of the cubic Lagrange interpolator
+      c0 = x0;
+      c1 = x1 - xm1 / 3 - x0 / 2 - x2 / 6;
+      c2 = (xm1 + x1) / 2 - x0;
+      c3 = (x2 - xm1) / 6 + (x0 - x1) / 2;
+      y = ((c3 * f + c2) * f + c1) * f + c0;
+    } else {
+      y = a * (x[(lPos - psLine->integer) & mask] - y) + x[(lPos - psLine->integer - 1) & mask];
+    }
+    if (psLine->meter != NULL) {
+      fAbs = fabsf(y);
+      fPeak = fAbs > fPeak ? fAbs : fPeak;
+      fSquares += y * y;
+      lClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    if (Adding) {
+      pfOutput[lSampleIndex] += y * fRunAddingGain;
+    } else {
+      pfOutput[lSampleIndex] = y;
+    }
+  }
+  if (psLine->meter != NULL) {
+    psLine->meter->outPeak = fPeak > psLine->meter->outPeak ? fPeak : psLine->meter->outPeak;
+    psLine->meter->outSquares += fSquares;
+    psLine->meter->outClips += lClips;
+  }
+  psLine->allpassState = y;
+  if (Gliding) {
+    psLine->delay = fDelay;
+    psLine->rampSamples -= SampleCount;
+    if (psLine->rampSamples == 0) {
+      // land exactly on the target, without the rounding of the steps
+      psLine->delay = psLine->target;
+      setDelayLineFraction(psLine);
+    }
+  }
+  return SampleCount;
+}
+
+/* Delay SampleCount (at most DELAY_BLOCKSIZE) samples. With Adding the
+   result times fRunAddingGain is added to pfOutput, otherwise it is
+   stored. pfInput and pfOutput may point to the same buffer. */
+static inline void runDelayLine(DelayLine * psLine,
+                                const LADSPA_Data * pfInput,
+                                LADSPA_Data * pfOutput,
+                                unsigned long SampleCount,
+                                const int Adding,
+                                float fRunAddingGain) {
+  unsigned long lStartPos = psLine->writePos, lFirst, lDone = 0;
+  if (psLine->meter != NULL) {
+    meterSamples(psLine->meter, pfInput, SampleCount, 0);
+  }
+  // the whole block goes into the ring buffer first, a delay of 0 reads
+  // it back right away
+  lFirst = psLine->mask + 1 - lStartPos;
+  lFirst = SampleCount < lFirst ? SampleCount : lFirst;
+  memcpy(psLine->buffer + lStartPos, pfInput, lFirst * sizeof(float));
+  memcpy(psLine->buffer, pfInput + lFirst, (SampleCount - lFirst) * sizeof(float));
+  psLine->writePos = (lStartPos + SampleCount) & psLine->mask;
+  if (psLine->rampSamples > 0) {
+    lDone = interpolateDelayLine(psLine, lStartPos, pfOutput, SampleCount, 1,
+                                 Adding, fRunAddingGain);
+  }
+  if (lDone == SampleCount) {
+    return;
+  }
+  if (psLine->fractional) {
+    interpolateDelayLine(psLine, lStartPos + lDone, pfOutput + lDone, SampleCount - lDone, 0,
+                         Adding, fRunAddingGain);
+  } else {
+    readDelayLine(psLine, lStartPos + lDone - psLine->integer, pfOutput + lDone,
+                  SampleCount - lDone, Adding, fRunAddingGain);
+  }
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,64 @@
+/* descriptors.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Building blocks for the LADSPA descriptors of the plugins. Descriptors,
+   port descriptors, port names and range hints are all constant data, so
+   loading a plugin library runs no code and allocates nothing, and all
+   plugins can be linked into the single bundle library t5_bundle.so.
+
+*/
+
+/*****************************************************************************/
+
+#define T5_MAKER           "Juergen Herrmann (t-5@t-5.eu)"
+#define T5_COPYRIGHT       "3-clause BSD licence"
+
+#define PORT_AUDIO_INPUT   (LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO)
+#define PORT_AUDIO_OUTPUT  (LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO)
+#define PORT_CONTROL_INPUT (LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL)
+#define PORT_CONTROL_OUTPUT (LADSPA_PORT_OUTPUT | LADSPA_PORT_CONTROL)
+
+// range hints of the controls used by several plugins
+#define HINT_F          { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                          | LADSPA_HINT_SAMPLE_RATE | LADSPA_HINT_LOGARITHMIC \
+                          | LADSPA_HINT_DEFAULT_440, 0, 0.5 }
+#define HINT_G          { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                          | LADSPA_HINT_DEFAULT_0, -12, 12 }
+#define HINT_Q          { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                          | LADSPA_HINT_DEFAULT_1, 0.1, 10 }
+#define HINT_LINK       { LADSPA_HINT_TOGGLED | LADSPA_HINT_DEFAULT_1, 0, 0 }
+#define HINT_MMAPFNAME  { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                          | LADSPA_HINT_DEFAULT_0, 0, 10000000000 }
+#define HINT_SMOOTHING  { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                          | LADSPA_HINT_DEFAULT_0, 0, 1000 }
+
+/* SEQ_n(m) expands to m(1), m(2), ... m(n). Used to spell out numbered
+   port names and repeated range hints of the multichannel and multiband
+   variants, e.g. SEQ_2(INPUT_NAME) gives "Input 1", "Input 2". */
+#define SEQ_1(m)   m(1)
+#define SEQ_2(m)   SEQ_1(m), m(2)
+#define SEQ_3(m)   SEQ_2(m), m(3)
+#define SEQ_4(m)   SEQ_3(m), m(4)
+#define SEQ_5(m)   SEQ_4(m), m(5)
+#define SEQ_6(m)   SEQ_5(m), m(6)
+#define SEQ_7(m)   SEQ_6(m), m(7)
+#define SEQ_8(m)   SEQ_7(m), m(8)
+#define SEQ_9(m)   SEQ_8(m), m(9)
+#define SEQ_10(m)  SEQ_9(m), m(10)
+#define SEQ_11(m)  SEQ_10(m), m(11)
+#define SEQ_12(m)  SEQ_11(m), m(12)
+#define SEQ_13(m)  SEQ_12(m), m(13)
+#define SEQ_14(m)  SEQ_13(m), m(14)
+#define SEQ_15(m)  SEQ_14(m), m(15)
+#define SEQ_16(m)  SEQ_15(m), m(16)
+#define SEQ_17(m)  SEQ_16(m), m(17)
+#define SEQ_18(m)  SEQ_17(m), m(18)
+#define SEQ_19(m)  SEQ_18(m), m(19)
+#define SEQ_20(m)  SEQ_19(m), m(20)
+
+#define INPUT_NAME(i)   "Input " #i
+#define OUTPUT_NAME(i)  "Output " #i
+
+/* EOF */
@@ -8,35 +8,876 @@
 /*****************************************************************************/
 
 #include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
 #include <ladspa.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
-/* biquad coefficients */
+/* The mmap file of an instance starts with the legacy parameter area used
+   by existing PaXoverRack controllers: one float "changed" flag followed by
+   the parameters in port order. Set MMAP_LEGACY_PROTOCOL to 0 to ignore it
+   and only use the versioned parameter block below. */
+#ifndef MMAP_LEGACY_PROTOCOL
+#define MMAP_LEGACY_PROTOCOL 1
+#endif
+
+/* Set MMAP_TELEMETRY to 0 to leave out the telemetry block and the cycle
+   counter reads in run(). */
+#ifndef MMAP_TELEMETRY
+#define MMAP_TELEMETRY 1
+#endif
+
+/* Set MMAP_METERING to 0 to leave out the level meters. */
+#ifndef MMAP_METERING
+#define MMAP_METERING 1
+#endif
+
+/* Set DISABLE_DENORMALS to 0 to leave the FTZ/DAZ mode of the host as it
+   is in run(), e.g. to check with t5_bench -d that flushing the filter
+   state alone keeps silence out of denormals. */
+#ifndef DISABLE_DENORMALS
+#define DISABLE_DENORMALS 1
+#endif
+
+/* Instances with MMAPFNAME set get a slot in one control segment shared
+   by all processes, /dev/shm/t5_control, instead of an mmap file each,
+   if the environment variable T5_MMAP_CONTROL_SEGMENT of the host is 1.
+   Scenes only reach instances in the segment. Controllers that look for
+   the mmap files in /dev/shm don't find these instances, so without the
+   variable the segment is only used if MMAP_CONTROL_SEGMENT is set to 1
+   at build time. When the segment can't be used or has no free slot an
+   mmap file is created like without it. */
+#ifndef MMAP_CONTROL_SEGMENT
+#define MMAP_CONTROL_SEGMENT 0
+#endif
+#define MMAP_CONTROL_SEGMENT_ENV "T5_MMAP_CONTROL_SEGMENT"
+
+/* Slots are owned through a write lock on their first byte in the control
+   segment file. Open file description locks belong to the library copy
+   that opened the file and are dropped by the kernel when its process
+   ends, however it ends, and in whatever pid namespace it runs. Where
+   they are missing, process locks are used and instances of other plugin
+   libraries of the same process tell their slots apart by pid. */
+#if !defined(F_OFD_SETLK) && defined(__linux__)
+#define F_OFD_SETLK 37
+#endif
+#ifdef F_OFD_SETLK
+#define MMAP_CONTROL_SETLK F_OFD_SETLK
+#else
+#define MMAP_CONTROL_SETLK F_SETLK
+#endif
+
+#define CACHELINE_SIZE 64
+#define MMAP_MAX_PARAMS 96
+#define MMAP_PARAMBLOCK_MAGIC 0x31503554 // "T5P1"
+#define MMAP_TELEMETRY_MAGIC 0x31543554 // "T5T1"
+// histogram bucket k counts runs of 2^k .. 2^(k+1)-1 cycles
+#define MMAP_TELEMETRY_BUCKETS 32
+#define MMAP_METER_MAGIC 0x314d3554 // "T5M1"
+// length of the window a published peak and RMS value covers
+#define MMAP_METER_WINDOW_MS 50
+// samples at or above this magnitude count as clipped
+#define MMAP_METER_CLIP_LEVEL 1.0
+#define MMAP_CONTROL_NAME "/dev/shm/t5_control"
+#define MMAP_CONTROL_MAGIC 0x31433554 // "T5C1"
+#define MMAP_CONTROL_VERSION 3
+#define MMAP_CONTROL_SLOTS 256
+// number of index entries, a power of 2 of at least twice the slot count
+#define MMAP_CONTROL_INDEX_SIZE 512
+#define MMAP_CONTROL_NAME_SIZE 48
+// index entries: bits 0-15 slot number + 1, 16-31 name hash, 32-63 id
+#define MMAP_INDEX_EMPTY 0
+#define MMAP_INDEX_DELETED 0xffff
+
+/* biquad coefficients, kept in double so poles close to the unit circle
+   are not moved by rounding; float sections convert them once per block */
 typedef struct {
 
-  float a1;
-  float a2;
-  float b0;
-  float b1;
-  float b2;
+  double a1;
+  double a2;
+  double b0;
+  double b1;
+  double b2;
 
 } BiquadCoeffs;
 
+/* parameters the coefficients of a biquad were last calculated for */
+typedef struct {
+
+  float f;
+  float g;
+  float q;
+  float samplerate;
+
+} BiquadParams;
+
+/* Versioned parameter block, placed in the mmap file on the first cache
+   line after the legacy area. A controller publishes a new parameter set
+   like a seqlock writer:
+
+     1. increment sequence (it is odd now)
+     2. write params[0 .. paramCount-1] in port order
+     3. increment sequence again (it is even now), with release semantics
+
+   The audio thread only writes presetStatus of this block. A set is
+   applied only if sequence was even and unchanged before and after
+   copying it, so a half-written set is never seen. Unchanged blocks cost
+   a single load.
+
+   preset selects a preset of the instance's preset bank (see presets.h),
+   preset i is recalled by writing i + 1, 0 selects none. It's applied
+   whenever the value changes, presetStatus tells how that went. */
+typedef struct {
+
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t paramCount;
+    uint32_t preset;
+    uint32_t presetStatus;
+    LADSPA_Data params[MMAP_MAX_PARAMS] __attribute__((aligned(CACHELINE_SIZE)));
+
+} __attribute__((aligned(CACHELINE_SIZE))) MmapParamBlock;
+
+/* Telemetry block, placed in the mmap file right behind the parameter
+   block. The audio thread is its only writer and updates it at the end of
+   every run() without locks: each counter is a naturally aligned 64 bit
+   word stored with a single (relaxed atomic) store, so a controller
+   reading it never sees a torn value. Counters from one run() may be seen
+   partly updated, which is irrelevant for statistics. Cycles are TSC
+   cycles on x86, virtual counter ticks on aarch64 and nanoseconds
+   elsewhere. */
+typedef struct {
+
+    uint32_t magic;
+    uint32_t buckets;
+    // number of run() calls and samples processed by them
+    uint64_t runCalls;
+    uint64_t samples;
+    // cycles spent in run(), summed up and the slowest single call
+    uint64_t cyclesTotal;
+    uint64_t cyclesMax;
+    // run() calls that recalculated coefficients or gains
+    uint64_t recomputes;
+    // parameter sets applied from the mmap area
+    uint64_t mmapChanges;
+    // run() durations, bucket k counts calls of 2^k .. 2^(k+1)-1 cycles
+    uint64_t histogram[MMAP_TELEMETRY_BUCKETS] __attribute__((aligned(CACHELINE_SIZE)));
+
+} __attribute__((aligned(CACHELINE_SIZE))) MmapTelemetryBlock;
+
+/* Level meter block, placed in the mmap file behind the telemetry block
+   (behind the parameter block without telemetry).
+   Every MMAP_METER_WINDOW_MS the audio thread publishes peak and RMS of
+   input and output over the last window like a seqlock writer (sequence
+   is odd while it writes), so a controller copies a consistent set by
+   reading sequence before and after. Output levels are those of the
+   plugin's output before the run_adding gain, in every plugin and for
+   run() and run_adding() alike. The clip counters are totals since the
+   mmap file was created. */
+typedef struct {
+
+    uint32_t magic;
+    uint32_t sequence;
+    // number of windows published so far
+    uint64_t windows;
+    float inPeak;
+    float inRms;
+    float outPeak;
+    float outRms;
+    uint64_t inClips;
+    uint64_t outClips;
+
+} __attribute__((aligned(CACHELINE_SIZE))) MmapMeterBlock;
+
+/* Levels summed up by the filter kernel since the last published window. */
+typedef struct {
+
+    float inPeak;
+    float outPeak;
+    double inSquares;
+    double outSquares;
+    unsigned long samples;
+    unsigned long inClips;
+    unsigned long outClips;
+
+} MeterAccumulator;
+
+/* Parameters of an instance staged for a scene, in its slot. generation
+   is the scene generation they belong to and is written after them. */
+typedef struct {
+
+    uint32_t generation;
+    LADSPA_Data params[MMAP_MAX_PARAMS] __attribute__((aligned(CACHELINE_SIZE)));
+
+} __attribute__((aligned(CACHELINE_SIZE))) MmapSceneBlock;
+
+/* Scene state in the control segment header. A controller switches the
+   parameters of any set of instances at once:
+
+     1. write each instance's new parameters into the scene block of its
+        slot and set the block's generation to generation + 1
+        (stageMmapScene())
+     2. set switchNs to 0 and increment generation, with release
+        semantics (publishMmapScene())
+
+   Every run() compares generation with the last one its instance has
+   seen, a single load of a line that only changes with a scene. The
+   first instance of the scene that sees the new generation sets switchNs
+   to half a block after the start of its run(). All instances apply their
+   staged parameters in the first run() starting at or after switchNs.
+   Instances running in the same period of a host start their run() within
+   a fraction of a block of each other, so they all switch in the same
+   period. A controller publishes the next scene only after switchNs has
+   passed by more than a period; the instances have applied it when
+   sceneApplied in all their slots equals generation. */
+typedef struct {
+
+    uint32_t generation;
+    uint32_t reserved;
+    // CLOCK_MONOTONIC time in ns, 0 until an instance has seen the scene
+    int64_t switchNs;
+
+} __attribute__((aligned(CACHELINE_SIZE))) MmapSceneHeader;
+
+/* Slot of one instance in the control segment. It holds the same areas
+   as the mmap file of an instance, each on its own cache lines. */
+typedef struct {
+
+    // pid of the process that owns the slot, 0 if the slot is free. Only
+    // informational, the owner holds a write lock on this field's byte in
+    // the segment file.
+    int32_t owner;
+    // MMAPFNAME and number of parameters the instance registered with
+    uint32_t id;
+    uint32_t paramCount;
+    // scene generation the instance has applied or skipped last
+    uint32_t sceneApplied;
+    // creation time, the s/ns part of the name of an mmap file
+    int64_t created_s;
+    int64_t created_ns;
+    char pluginname[MMAP_CONTROL_NAME_SIZE];
+    LADSPA_Data legacy[MMAP_MAX_PARAMS + 1] __attribute__((aligned(CACHELINE_SIZE)));
+    MmapParamBlock params;
+    MmapTelemetryBlock telemetry;
+    MmapMeterBlock meter;
+    MmapSceneBlock scene;
+
+} __attribute__((aligned(CACHELINE_SIZE))) MmapSlot;
+
+/* Control segment shared by all instances of all processes. The index is
+   an open addressing hash table with linear probing over plugin name and
+   MMAPFNAME id, so a controller finds an instance with findMmapSlot()
+   instead of scanning /dev/shm. Entries are single 64 bit words, inserted
+   and deleted with compare and swap. The header tells controllers in
+   other languages where index and slots are. */
+typedef struct {
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize;
+    uint32_t slotOffset;
+    uint32_t indexSize;
+    uint32_t indexOffset;
+    uint32_t sceneOffset;
+    MmapSceneHeader scene;
+    uint64_t index[MMAP_CONTROL_INDEX_SIZE] __attribute__((aligned(CACHELINE_SIZE)));
+    MmapSlot slots[MMAP_CONTROL_SLOTS];
+
+} MmapControlSegment;
+
+/* Control segment as seen by one plugin library: its mapping, the file
+   descriptor the slot locks are held on and the slots owned by its
+   instances, bit i of owned[i / 64] for slot i. Locks held on the same
+   file descriptor don't keep instances of the same library apart. */
+typedef struct {
+    MmapControlSegment * segment;
+    int fd;
+    uint64_t owned[MMAP_CONTROL_SLOTS / 64];
+} MmapControlState;
+
 /* s/ns return value */
 typedef struct {
     long s;
     long ns;
     LADSPA_Data * mmap;
+    MmapParamBlock * params;
+    MmapTelemetryBlock * telemetry;
+    MmapMeterBlock * meter;
 } TimeMmapStruct;
 
 /* Helpers... ****************************************************************/
 
-float dbToGainFactor(float db) {
+static inline float dbToGainFactor(float db) {
   return pow(10, db/20.0);
 }
 
-void cleanupMmapFile(char pluginname[], float mmapfname, long s, long ns);
-void cleanupMmapFile(char pluginname[], float mmapfname, long s, long ns) {
+/* Make the FPU treat denormal inputs and results as zero, so decaying
+   filter feedback on silent input doesn't fall into the slow denormal
+   paths of the CPU. Returns the previous mode, which has to be handed to
+   restoreDenormals() before returning to the host. On x86 this sets
+   FTZ/DAZ in MXCSR, on aarch64 FZ in FPCR, elsewhere it does nothing. */
+static inline unsigned long disableDenormals(void) {
+#if !DISABLE_DENORMALS
+    return 0;
+#elif defined(__SSE__)
+    unsigned long mode = _mm_getcsr();
+    // FTZ (bit 15) and DAZ (bit 6)
+    _mm_setcsr(mode | 0x8040);
+    return mode;
+#elif defined(__aarch64__)
+    unsigned long mode;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode));
+    // FZ (bit 24)
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(mode | (1UL << 24)));
+    return mode;
+#else
+    return 0;
+#endif
+}
+
+/* Restore the FPU mode returned by disableDenormals(). */
+static inline void restoreDenormals(unsigned long mode) {
+#if !DISABLE_DENORMALS
+    (void)mode;
+#elif defined(__SSE__)
+    _mm_setcsr(mode);
+#elif defined(__aarch64__)
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(mode));
+#else
+    (void)mode;
+#endif
+}
+
+/* Current value of the cheapest monotonic cycle counter of the CPU. */
+static inline uint64_t readCycleCounter(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (uint64_t)spec.tv_sec * 1000000000 + spec.tv_nsec;
+#endif
+}
+
+/* Start time of a run() for updateMmapTelemetry(), 0 without telemetry. */
+static inline uint64_t startMmapTelemetry(MmapTelemetryBlock * psTelemetry) {
+#if MMAP_TELEMETRY
+    if (psTelemetry != NULL) {
+        return readCycleCounter();
+    }
+#endif
+    return 0;
+}
+
+/* Add a run() over SampleCount samples, started at StartCycles, to the
+   telemetry block. Recomputed and MmapChanged tell whether the run
+   recalculated coefficients and applied a parameter set from the mmap
+   area. Does nothing if psTelemetry is null or StartCycles is 0, which is
+   the case in the run() that set up the mmap file. */
+static inline void updateMmapTelemetry(MmapTelemetryBlock * psTelemetry,
+                                       uint64_t StartCycles,
+                                       unsigned long SampleCount,
+                                       int Recomputed,
+                                       int MmapChanged) {
+#if MMAP_TELEMETRY
+    uint64_t cycles;
+    int bucket;
+    if (psTelemetry == NULL || StartCycles == 0) {
+        return;
+    }
+    cycles = readCycleCounter() - StartCycles;
+    bucket = 63 - __builtin_clzll(cycles | 1);
+    if (bucket >= MMAP_TELEMETRY_BUCKETS) {
+        bucket = MMAP_TELEMETRY_BUCKETS - 1;
+    }
+    __atomic_store_n(&psTelemetry->runCalls, psTelemetry->runCalls + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&psTelemetry->samples, psTelemetry->samples + SampleCount, __ATOMIC_RELAXED);
+    __atomic_store_n(&psTelemetry->cyclesTotal, psTelemetry->cyclesTotal + cycles, __ATOMIC_RELAXED);
+    if (cycles > psTelemetry->cyclesMax) {
+        __atomic_store_n(&psTelemetry->cyclesMax, cycles, __ATOMIC_RELAXED);
+    }
+    if (Recomputed) {
+        __atomic_store_n(&psTelemetry->recomputes, psTelemetry->recomputes + 1, __ATOMIC_RELAXED);
+    }
+    if (MmapChanged) {
+        __atomic_store_n(&psTelemetry->mmapChanges, psTelemetry->mmapChanges + 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&psTelemetry->histogram[bucket],
+                     psTelemetry->histogram[bucket] + 1,
+                     __ATOMIC_RELAXED);
+#else
+    (void)psTelemetry;
+    (void)StartCycles;
+    (void)SampleCount;
+    (void)Recomputed;
+    (void)MmapChanged;
+#endif
+}
+
+/* Convert a time in ms into a number of samples, negative times give 0. */
+static inline unsigned long msToSamples(float ms, float samplerate) {
+    if (!(ms > 0)) {
+        return 0;
+    }
+    return (unsigned long)(ms * samplerate / 1000.0 + 0.5);
+}
+
+/* Ramp length in samples for the smoothing time port pfSmoothing. The
+   descriptors published before that port existed don't have it, it is
+   null then and coefficients switch at once. */
+static inline unsigned long smoothingToSamples(const LADSPA_Data * pfSmoothing, float samplerate) {
+    if (pfSmoothing == NULL) {
+        return 0;
+    }
+    return msToSamples(*pfSmoothing, samplerate);
+}
+
+/* Start a new metering window. */
+static inline void resetMeterAccumulator(MeterAccumulator * psMeter) {
+    memset(psMeter, 0, sizeof(MeterAccumulator));
+}
+
+/* Sum up the levels of SampleCount samples as input (Output == 0) or
+   output levels, for kernels that don't meter in their filter loop. */
+static inline void meterSamples(MeterAccumulator * psMeter,
+                                const float * pfSamples,
+                                unsigned long SampleCount,
+                                const int Output) {
+    float fAbs, fPeak = 0, fSquares = 0;
+    unsigned long lSampleIndex, lClips = 0;
+    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+        fAbs = fabsf(pfSamples[lSampleIndex]);
+        fPeak = fAbs > fPeak ? fAbs : fPeak;
+        fSquares += pfSamples[lSampleIndex] * pfSamples[lSampleIndex];
+        lClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    if (Output) {
+        psMeter->outPeak = fPeak > psMeter->outPeak ? fPeak : psMeter->outPeak;
+        psMeter->outSquares += fSquares;
+        psMeter->outClips += lClips;
+    } else {
+        psMeter->inPeak = fPeak > psMeter->inPeak ? fPeak : psMeter->inPeak;
+        psMeter->inSquares += fSquares;
+        psMeter->inClips += lClips;
+        psMeter->samples += SampleCount;
+    }
+}
+
+/* Publish the levels of psMeter into psBlock once they cover at least
+   WindowSamples samples, then start a new window. Meant to be called once
+   per run(), after the filter kernel summed up the levels of the block.
+   Does nothing if psBlock is null. */
+static inline void publishMmapMeter(MmapMeterBlock * psBlock,
+                                    MeterAccumulator * psMeter,
+                                    unsigned long WindowSamples) {
+    uint32_t sequence;
+    if (psBlock == NULL || psMeter->samples < WindowSamples || psMeter->samples == 0) {
+        return;
+    }
+    sequence = psBlock->sequence;
+    __atomic_store_n(&psBlock->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    psBlock->windows++;
+    psBlock->inPeak = psMeter->inPeak;
+    psBlock->inRms = sqrt(psMeter->inSquares / psMeter->samples);
+    psBlock->outPeak = psMeter->outPeak;
+    psBlock->outRms = sqrt(psMeter->outSquares / psMeter->samples);
+    psBlock->inClips += psMeter->inClips;
+    psBlock->outClips += psMeter->outClips;
+    __atomic_store_n(&psBlock->sequence, sequence + 2, __ATOMIC_RELEASE);
+    resetMeterAccumulator(psMeter);
+}
+
+/* Forget cached parameters, the next update will always report a change. */
+static inline void invalidateBiquadParams(BiquadParams * psParams) {
+    psParams->f = NAN;
+    psParams->g = NAN;
+    psParams->q = NAN;
+    psParams->samplerate = NAN;
+}
+
+/* Store f, g, q and samplerate in the cache. Returns 1 if any of them
+   differs from the cached value (coefficients need to be recalculated),
+   0 otherwise. */
+static inline int updateBiquadParams(BiquadParams * psParams, float f, float g, float q, float samplerate) {
+    if (psParams->f == f && psParams->g == g &&
+        psParams->q == q && psParams->samplerate == samplerate) {
+        return 0;
+    }
+    psParams->f = f;
+    psParams->g = g;
+    psParams->q = q;
+    psParams->samplerate = samplerate;
+    return 1;
+}
+
+/* MMAPFNAME as it appears in mmap file names and index entries. */
+static inline uint32_t mmapControlId(float mmapfname) {
+    return (uint32_t)(int)round(mmapfname);
+}
+
+/* 16 bit FNV-1a hash of a plugin name for the index. */
+static inline uint32_t hashMmapPluginName(const char pluginname[]) {
+    uint32_t hash = 2166136261u;
+    while (*pluginname) {
+        hash = (hash ^ (unsigned char)*pluginname++) * 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & 0xffff;
+}
+
+/* Index entry of the instance in psSlot. */
+static inline uint64_t mmapIndexEntry(MmapControlSegment * psSegment, MmapSlot * psSlot) {
+    return (uint64_t)psSlot->id << 32 |
+           hashMmapPluginName(psSlot->pluginname) << 16 |
+           (uint64_t)(psSlot - psSegment->slots + 1);
+}
+
+/* First index position probed for an entry. */
+static inline uint32_t mmapIndexBucket(uint64_t entry) {
+    return (uint32_t)((entry >> 32) * 2654435761u ^ (entry >> 16 & 0xffff) * 40503u)
+           & (MMAP_CONTROL_INDEX_SIZE - 1);
+}
+
+/* Add the instance in psSlot to the index. Only compare and swap on the
+   index entries, so it may be called from run(). Instances registered
+   with the same plugin name and id get one entry each, lookups find the
+   first one. */
+static inline void registerMmapSlot(MmapControlSegment * psSegment, MmapSlot * psSlot) {
+    uint64_t entry, current;
+    uint32_t bucket, probe;
+    entry = mmapIndexEntry(psSegment, psSlot);
+    bucket = mmapIndexBucket(entry);
+    for (probe = 0; probe < MMAP_CONTROL_INDEX_SIZE; probe++) {
+        current = __atomic_load_n(&psSegment->index[bucket], __ATOMIC_ACQUIRE);
+        while (current == MMAP_INDEX_EMPTY || current == MMAP_INDEX_DELETED) {
+            if (__atomic_compare_exchange_n(&psSegment->index[bucket], &current, entry, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+                return;
+            }
+        }
+        bucket = (bucket + 1) & (MMAP_CONTROL_INDEX_SIZE - 1);
+    }
+}
+
+/* Remove the index entry of the instance in psSlot, if it has one. The
+   entry becomes a deleted marker so the probe sequences of other entries
+   stay intact. */
+static inline void unregisterMmapSlot(MmapControlSegment * psSegment, MmapSlot * psSlot) {
+    uint64_t entry, current;
+    uint32_t bucket, probe;
+    entry = mmapIndexEntry(psSegment, psSlot);
+    bucket = mmapIndexBucket(entry);
+    for (probe = 0; probe < MMAP_CONTROL_INDEX_SIZE; probe++) {
+        current = __atomic_load_n(&psSegment->index[bucket], __ATOMIC_ACQUIRE);
+        if (current == MMAP_INDEX_EMPTY) {
+            return;
+        }
+        if (current == entry) {
+            __atomic_compare_exchange_n(&psSegment->index[bucket], &current,
+                                        (uint64_t)MMAP_INDEX_DELETED, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            return;
+        }
+        bucket = (bucket + 1) & (MMAP_CONTROL_INDEX_SIZE - 1);
+    }
+}
+
+/* Find the slot of the instance registered with pluginname and MMAPFNAME
+   id, for controllers. Returns null if there is none. Usually the first
+   index entry probed is the one. */
+static inline MmapSlot * findMmapSlot(MmapControlSegment * psSegment,
+                                      const char pluginname[],
+                                      uint32_t id) {
+    MmapSlot * psSlot;
+    uint64_t key, current;
+    uint32_t bucket, probe, slot;
+    key = (uint64_t)id << 32 | hashMmapPluginName(pluginname) << 16;
+    bucket = mmapIndexBucket(key);
+    for (probe = 0; probe < MMAP_CONTROL_INDEX_SIZE; probe++) {
+        current = __atomic_load_n(&psSegment->index[bucket], __ATOMIC_ACQUIRE);
+        if (current == MMAP_INDEX_EMPTY) {
+            return NULL;
+        }
+        slot = current & 0xffff;
+        if (slot != MMAP_INDEX_DELETED && (current & ~(uint64_t)0xffff) == key &&
+            slot <= MMAP_CONTROL_SLOTS) {
+            psSlot = &psSegment->slots[slot - 1];
+            // another name with the same hash
+            if (strncmp(psSlot->pluginname, pluginname, MMAP_CONTROL_NAME_SIZE) == 0) {
+                return psSlot;
+            }
+        }
+        bucket = (bucket + 1) & (MMAP_CONTROL_INDEX_SIZE - 1);
+    }
+    return NULL;
+}
+
+/* State of the control segment for this plugin library. */
+static inline MmapControlState * mmapControlState(void) {
+    static MmapControlState sState = { NULL, -1, { 0 } };
+    return &sState;
+}
+
+/* Returns 1 if instances of this plugin library use the control segment:
+   T5_MMAP_CONTROL_SEGMENT=1 or 0 in the environment, MMAP_CONTROL_SEGMENT
+   if it isn't set. The environment is read once per plugin library. */
+static inline int useMmapControlSegment(void) {
+    static int sUse = -1;
+    const char * pcValue;
+    int use;
+    use = __atomic_load_n(&sUse, __ATOMIC_RELAXED);
+    if (use < 0) {
+        pcValue = getenv(MMAP_CONTROL_SEGMENT_ENV);
+        if (pcValue != NULL && *pcValue != '\0') {
+            use = atoi(pcValue) != 0;
+        } else {
+            use = MMAP_CONTROL_SEGMENT != 0;
+        }
+        __atomic_store_n(&sUse, use, __ATOMIC_RELAXED);
+    }
+    return use;
+}
+
+/* Map the control segment, create it if it doesn't exist yet. Returns
+   null if it can't be used, e.g. because it has been created by a build
+   with another layout. Mapped once per plugin library and process, the
+   file stays open for the slot locks. */
+static inline MmapControlSegment * attachMmapControlSegment(void) {
+    MmapControlState * psState;
+    MmapControlSegment * psSegment;
+    MmapControlSegment * psExpected;
+    struct stat sStat;
+    void * area;
+    int fd, expected;
+    psState = mmapControlState();
+    psSegment = __atomic_load_n(&psState->segment, __ATOMIC_ACQUIRE);
+    if (psSegment != NULL) {
+        return psSegment;
+    }
+    fd = open(MMAP_CONTROL_NAME, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    // all threads attaching at the same time use the first descriptor
+    expected = -1;
+    if (!__atomic_compare_exchange_n(&psState->fd, &expected, fd, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        close(fd);
+        fd = expected;
+    }
+    // growing a new, empty file fills it with zeros: no slot is owned and
+    // all index entries are empty
+    if (fstat(fd, &sStat) != 0 ||
+        (sStat.st_size < (off_t)sizeof(MmapControlSegment) &&
+         ftruncate(fd, sizeof(MmapControlSegment)) != 0)) {
+        return NULL;
+    }
+    area = mmap(NULL, sizeof(MmapControlSegment), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (area == MAP_FAILED) {
+        return NULL;
+    }
+    psSegment = (MmapControlSegment *)area;
+    // all processes creating the segment at the same time write the same
+    // layout, the magic is written last
+    if (__atomic_load_n(&psSegment->magic, __ATOMIC_ACQUIRE) == 0) {
+        psSegment->version = MMAP_CONTROL_VERSION;
+        psSegment->slotCount = MMAP_CONTROL_SLOTS;
+        psSegment->slotSize = sizeof(MmapSlot);
+        psSegment->slotOffset = offsetof(MmapControlSegment, slots);
+        psSegment->indexSize = MMAP_CONTROL_INDEX_SIZE;
+        psSegment->indexOffset = offsetof(MmapControlSegment, index);
+        psSegment->sceneOffset = offsetof(MmapControlSegment, scene);
+        __atomic_store_n(&psSegment->magic, MMAP_CONTROL_MAGIC, __ATOMIC_RELEASE);
+    }
+    if (psSegment->magic != MMAP_CONTROL_MAGIC ||
+        psSegment->version != MMAP_CONTROL_VERSION ||
+        psSegment->slotCount != MMAP_CONTROL_SLOTS ||
+        psSegment->slotSize != sizeof(MmapSlot) ||
+        psSegment->indexSize != MMAP_CONTROL_INDEX_SIZE) {
+        munmap(area, sizeof(MmapControlSegment));
+        return NULL;
+    }
+    // another thread may have mapped it in the meantime
+    psExpected = NULL;
+    if (!__atomic_compare_exchange_n(&psState->segment, &psExpected, psSegment, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        munmap(area, sizeof(MmapControlSegment));
+        psSegment = psExpected;
+    }
+    return psSegment;
+}
+
+/* Take (type F_WRLCK) or drop (F_UNLCK) the lock on the owner field of
+   slot i without waiting. Returns 1 on success, 0 if another library or
+   process holds it. */
+static inline int lockMmapSlot(MmapControlState * psState, int i, short type) {
+    struct flock sLock;
+    memset(&sLock, 0, sizeof(sLock));
+    sLock.l_type = type;
+    sLock.l_whence = SEEK_SET;
+    sLock.l_start = offsetof(MmapControlSegment, slots) + i * sizeof(MmapSlot) +
+                    offsetof(MmapSlot, owner);
+    sLock.l_len = 1;
+    return fcntl(psState->fd, MMAP_CONTROL_SETLK, &sLock) == 0;
+}
+
+/* Claim a free slot in the control segment for an instance. Slots of
+   processes that ended without cleaning up are taken over, their locks
+   are gone. Returns null if the segment can't be used or all slots are
+   owned, the instance uses an mmap file then. Not realtime safe, it's
+   called once when MMAPFNAME is set. */
+static inline MmapSlot * acquireMmapSlot(void) {
+    MmapControlState * psState;
+    MmapControlSegment * psSegment;
+    MmapSlot * psSlot;
+    uint64_t bit;
+    int32_t owner, pid;
+    int i;
+    psSegment = attachMmapControlSegment();
+    if (psSegment == NULL) {
+        return NULL;
+    }
+    psState = mmapControlState();
+    pid = getpid();
+    for (i = 0; i < MMAP_CONTROL_SLOTS; i++) {
+        psSlot = &psSegment->slots[i];
+        owner = __atomic_load_n(&psSlot->owner, __ATOMIC_ACQUIRE);
+#ifndef F_OFD_SETLK
+        if (owner == pid) {
+            continue;
+        }
+#endif
+        // owned by an instance of this library
+        bit = (uint64_t)1 << (i % 64);
+        if (__atomic_fetch_or(&psState->owned[i / 64], bit, __ATOMIC_ACQ_REL) & bit) {
+            continue;
+        }
+        if (!lockMmapSlot(psState, i, F_WRLCK)) {
+            __atomic_fetch_and(&psState->owned[i / 64], ~bit, __ATOMIC_RELEASE);
+            continue;
+        }
+        if (!__atomic_compare_exchange_n(&psSlot->owner, &owner, pid, 0,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            lockMmapSlot(psState, i, F_UNLCK);
+            __atomic_fetch_and(&psState->owned[i / 64], ~bit, __ATOMIC_RELEASE);
+            continue;
+        }
+        if (owner != 0) {
+            // drop the index entry left behind by the ended process
+            unregisterMmapSlot(psSegment, psSlot);
+        }
+        memset((char *)psSlot + offsetof(MmapSlot, id), 0,
+               sizeof(MmapSlot) - offsetof(MmapSlot, id));
+        return psSlot;
+    }
+    return NULL;
+}
+
+/* Give a slot returned by acquireMmapSlot() back, in cleanup(). Accepts
+   null. */
+static inline void releaseMmapSlot(MmapSlot * psSlot) {
+    MmapControlState * psState;
+    MmapControlSegment * psSegment;
+    int i;
+    if (psSlot == NULL) {
+        return;
+    }
+    psState = mmapControlState();
+    psSegment = attachMmapControlSegment();
+    i = psSlot - psSegment->slots;
+    unregisterMmapSlot(psSegment, psSlot);
+    __atomic_store_n(&psSlot->owner, 0, __ATOMIC_RELEASE);
+    lockMmapSlot(psState, i, F_UNLCK);
+    __atomic_fetch_and(&psState->owned[i / 64], ~((uint64_t)1 << (i % 64)), __ATOMIC_RELEASE);
+}
+
+/* Stage the parameter set of the instance in psSlot for the next scene,
+   for controllers. */
+static inline void stageMmapScene(MmapControlSegment * psSegment,
+                                  MmapSlot * psSlot,
+                                  const LADSPA_Data * pfParams,
+                                  int paramcount) {
+    memcpy(psSlot->scene.params, pfParams, paramcount * sizeof(LADSPA_Data));
+    __atomic_store_n(&psSlot->scene.generation,
+                     __atomic_load_n(&psSegment->scene.generation, __ATOMIC_ACQUIRE) + 1,
+                     __ATOMIC_RELEASE);
+}
+
+/* Publish all parameter sets staged with stageMmapScene() at once, for
+   controllers. Returns the generation of the new scene. */
+static inline uint32_t publishMmapScene(MmapControlSegment * psSegment) {
+    uint32_t generation;
+    generation = __atomic_load_n(&psSegment->scene.generation, __ATOMIC_ACQUIRE) + 1;
+    __atomic_store_n(&psSegment->scene.switchNs, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&psSegment->scene.generation, generation, __ATOMIC_RELEASE);
+    return generation;
+}
+
+/* Copy the parameters staged for a new scene into pfParams once the
+   scene switches, see MmapSceneHeader. Returns 1 in the run() that
+   switches, 0 otherwise, always 0 without a slot. SampleCount and
+   samplerate give the length of the block about to be processed. */
+static inline int readMmapScene(MmapSlot * psSlot,
+                                LADSPA_Data * pfParams,
+                                int paramcount,
+                                unsigned long SampleCount,
+                                float samplerate) {
+    MmapControlSegment * psSegment;
+    struct timespec spec;
+    uint32_t generation;
+    int64_t now, switchNs, expected;
+    if (psSlot == NULL) {
+        return 0;
+    }
+    psSegment = attachMmapControlSegment();
+    generation = __atomic_load_n(&psSegment->scene.generation, __ATOMIC_ACQUIRE);
+    if (generation == psSlot->sceneApplied) {
+        return 0;
+    }
+    if (__atomic_load_n(&psSlot->scene.generation, __ATOMIC_ACQUIRE) != generation) {
+        // the instance is not part of this scene
+        __atomic_store_n(&psSlot->sceneApplied, generation, __ATOMIC_RELEASE);
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    now = (int64_t)spec.tv_sec * 1000000000 + spec.tv_nsec;
+    switchNs = __atomic_load_n(&psSegment->scene.switchNs, __ATOMIC_ACQUIRE);
+    if (switchNs == 0) {
+        // switch between this block and the next one of all instances
+        expected = 0;
+        switchNs = now + (int64_t)(SampleCount * 500000000.0 / samplerate);
+        if (!__atomic_compare_exchange_n(&psSegment->scene.switchNs, &expected, switchNs, 0,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            switchNs = expected;
+        }
+    }
+    if (now < switchNs) {
+        return 0;
+    }
+    memcpy(pfParams, psSlot->scene.params, paramcount * sizeof(LADSPA_Data));
+    __atomic_store_n(&psSlot->sceneApplied, generation, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* Remove an instance from where controllers find it: its entry in the
+   control segment index if it has a slot, its mmap file otherwise. */
+static inline void cleanupMmapFile(MmapSlot * psSlot, char pluginname[], float mmapfname, long s, long ns) {
     char name[255];
+    if (psSlot != NULL) {
+        unregisterMmapSlot(attachMmapControlSegment(), psSlot);
+        return;
+    }
     sprintf(name,
             "/dev/shm/t5_%s_%u_%011lu.%09lu",
             pluginname,
@@ -49,9 +890,105 @@ void cleanupMmapFile(char pluginname[], float mmapfname, long s, long ns) {
     }
 }
 
-TimeMmapStruct setupMmapFile(char pluginname[], float mmapfname, int portcount);
-TimeMmapStruct setupMmapFile(char pluginname[], float mmapfname, int portcount) {
+/* Offset of the versioned parameter block behind the legacy area. */
+static inline size_t mmapParamBlockOffset(int paramcount) {
+    size_t legacy = (paramcount + 1) * sizeof(LADSPA_Data);
+    return (legacy + CACHELINE_SIZE - 1) / CACHELINE_SIZE * CACHELINE_SIZE;
+}
+
+/* Copy a new parameter set from the mmap area into pfParams. Returns 1 if
+   a complete new set was copied, 0 if nothing changed or a controller was
+   writing at the same time (the set is picked up by a later call then).
+   *piSequence holds the sequence number of the last applied set. */
+static inline int readMmapParams(LADSPA_Data * mmapArea,
+                                 MmapParamBlock * psBlock,
+                                 uint32_t * piSequence,
+                                 LADSPA_Data * pfParams,
+                                 int paramcount) {
+    uint32_t before, after;
+    before = __atomic_load_n(&psBlock->sequence, __ATOMIC_ACQUIRE);
+    if (before != *piSequence && (before & 1) == 0) {
+        memcpy(pfParams, psBlock->params, paramcount * sizeof(LADSPA_Data));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&psBlock->sequence, __ATOMIC_RELAXED);
+        if (before == after) {
+            *piSequence = before;
+            return 1;
+        }
+    }
+#if MMAP_LEGACY_PROTOCOL
+    LADSPA_Data unchanged = 0.0;
+    LADSPA_Data changed;
+    memcpy(&changed, mmapArea, sizeof(LADSPA_Data));
+    if (changed != 0.0) {
+        memcpy(pfParams, mmapArea + 1, paramcount * sizeof(LADSPA_Data));
+        // reset changed flag to re-enable parametrization by control inputs,
+        // only written when set to keep the cache line clean otherwise
+        memcpy(mmapArea, &unchanged, sizeof(LADSPA_Data));
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/* Set up the areas of an instance in its slot in the control segment and
+   add it to the index. */
+static inline TimeMmapStruct setupMmapSlot(MmapSlot * psSlot, char pluginname[], float mmapfname, int paramcount) {
+    TimeMmapStruct ret;
+    struct timespec spec;
+    clock_gettime(CLOCK_REALTIME, &spec);
+    ret.s = spec.tv_sec;
+    ret.ns = spec.tv_nsec;
+    psSlot->id = mmapControlId(mmapfname);
+    psSlot->paramCount = paramcount;
+    // scenes published before don't apply to the new instance
+    psSlot->sceneApplied = __atomic_load_n(&attachMmapControlSegment()->scene.generation,
+                                           __ATOMIC_ACQUIRE);
+    psSlot->created_s = ret.s;
+    psSlot->created_ns = ret.ns;
+    strncpy(psSlot->pluginname, pluginname, MMAP_CONTROL_NAME_SIZE - 1);
+    ret.mmap = psSlot->legacy;
+    ret.params = &psSlot->params;
+    ret.params->magic = MMAP_PARAMBLOCK_MAGIC;
+    ret.params->paramCount = paramcount;
+    ret.telemetry = NULL;
+    ret.meter = NULL;
+#if MMAP_TELEMETRY
+    ret.telemetry = &psSlot->telemetry;
+    ret.telemetry->magic = MMAP_TELEMETRY_MAGIC;
+    ret.telemetry->buckets = MMAP_TELEMETRY_BUCKETS;
+#endif
+#if MMAP_METERING
+    ret.meter = &psSlot->meter;
+    ret.meter->magic = MMAP_METER_MAGIC;
+#endif
+    registerMmapSlot(attachMmapControlSegment(), psSlot);
+    return ret;
+}
+
+/* Returns 1 if an instance without mmap areas should set them up for the
+   MMAPFNAME port value mmapfname: it is set and setting them up didn't
+   fail for it before. A failure isn't retried in every run(), only once
+   the port changes. */
+static inline int wantMmapSetup(float mmapfname, float failedfname) {
+    return mmapfname != 0.0 && mmapfname != failedfname;
+}
+
+/* Set up the mmap areas of an instance, in a slot of the control segment
+   stored in *ppsSlot if it gets one, in an mmap file of its own
+   otherwise. This is called from run(), a failure leaves ret.mmap null
+   without any output and the instance keeps working with its control
+   ports. The slot is given back with releaseMmapSlot(). */
+static inline TimeMmapStruct setupMmapFile(MmapSlot ** ppsSlot, char pluginname[], float mmapfname, int paramcount) {
     TimeMmapStruct ret;
+    if (useMmapControlSegment()) {
+        *ppsSlot = acquireMmapSlot();
+        if (*ppsSlot != NULL) {
+            return setupMmapSlot(*ppsSlot, pluginname, mmapfname, paramcount);
+        }
+    }
+    size_t size;
+    void * area;
     char name[255];
     long ns;
     time_t s;
@@ -65,14 +1002,50 @@ TimeMmapStruct setupMmapFile(char pluginname[], float mmapfname, int portcount)
             (int)round(mmapfname),
             s,
             ns);
-    int fd = open(name, O_RDWR | O_CREAT, 0600);
-    int fret = ftruncate(fd, (portcount-1) * sizeof(LADSPA_Data));
-    if (fret != 0) {
-        printf("ERROR: could not truncate mmaped file %s", name);
-    }
-    ret.mmap = (LADSPA_Data *) mmap(NULL, portcount * sizeof(LADSPA_Data),
-                PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ret.mmap = NULL;
+    ret.params = NULL;
+    ret.telemetry = NULL;
+    ret.meter = NULL;
     ret.s = s;
     ret.ns = ns;
+    size = mmapParamBlockOffset(paramcount) + sizeof(MmapParamBlock);
+#if MMAP_TELEMETRY
+    size += sizeof(MmapTelemetryBlock);
+#endif
+#if MMAP_METERING
+    size += sizeof(MmapMeterBlock);
+#endif
+    int fd = open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return ret;
+    }
+    // a mapping beyond the end of a file that couldn't be grown would
+    // fault on first access
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        remove(name);
+        return ret;
+    }
+    area = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (area == MAP_FAILED) {
+        remove(name);
+        return ret;
+    }
+    ret.mmap = (LADSPA_Data *)area;
+    ret.params = (MmapParamBlock *)((char *)area + mmapParamBlockOffset(paramcount));
+    ret.params->magic = MMAP_PARAMBLOCK_MAGIC;
+    ret.params->paramCount = paramcount;
+    area = ret.params + 1;
+#if MMAP_TELEMETRY
+    ret.telemetry = (MmapTelemetryBlock *)area;
+    ret.telemetry->magic = MMAP_TELEMETRY_MAGIC;
+    ret.telemetry->buckets = MMAP_TELEMETRY_BUCKETS;
+    area = ret.telemetry + 1;
+#endif
+#if MMAP_METERING
+    ret.meter = (MmapMeterBlock *)area;
+    ret.meter->magic = MMAP_METER_MAGIC;
+#endif
     return ret;
 }
\ No newline at end of file
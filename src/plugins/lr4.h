@@ -7,7 +7,17 @@
 #define SF_F           2
 #define SF_GAIN        3
 #define SF_MMAPFNAME   4
-#define PORTCOUNT      5
+#define SF_SMOOTHING   5
+#define PORTCOUNT      6
+// lr4_lowpass and lr4_highpass keep the ports they were published with,
+// the smoothing time is only a port of the _smooth variants
+#define PORTCOUNT_UNSMOOTHED SF_SMOOTHING
+
+// parameters in the mmap area: F, GAIN
+#define MMAP_PARAMCOUNT 2
+
+// two identical butterworth biquads make up one LR-4 filter
+#define LR4_SECTIONS   2
 
 /*****************************************************************************/
 
@@ -17,63 +27,86 @@ typedef struct {
     long m_created_ns;
     time_t m_created_s;
 
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
     LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+    MmapMeterBlock * m_meterBlock;
+    MeterAccumulator m_meter;
+    // precomputed coefficients of presets recalled through the mmap area
+    PresetBank m_bank;
 
     LADSPA_Data m_fSampleRate;
-    // previous input samples of biquad filters
-    LADSPA_Data m_fxnm1_pass1;
-    LADSPA_Data m_fxnm2_pass1;
-    LADSPA_Data m_fxnm1_pass2;
-    LADSPA_Data m_fxnm2_pass2;
-    // previous output samples of biquad filters
-    LADSPA_Data m_fynm1_pass1;
-    LADSPA_Data m_fynm2_pass1;
-    LADSPA_Data m_fynm1_pass2;
-    LADSPA_Data m_fynm2_pass2;
+    // coefficients and previous samples of both biquad passes
+    BiquadCascade m_cascade;
+    // both passes with the gain folded in
+    BiquadPlan m_plan;
+    // block matrices of the compiled passes for long runs
+    StateSpaceCascade m_statespace;
+    // parameters the coefficients and gain factor were calculated for
+    BiquadParams m_params;
+    LADSPA_Data m_fGain;
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
     // port pointers
     LADSPA_Data * m_pfInput;
     LADSPA_Data * m_pfOutput;
     LADSPA_Data * m_pfF;
     LADSPA_Data * m_pfGain;
     LADSPA_Data * m_pfMmapFname;
+    LADSPA_Data * m_pfSmoothing;
 
 } Lr4LowHighPass;
 
-/* Construct a new plugin instance. */
-LADSPA_Handle instantiateLr4LowHighPass(const LADSPA_Descriptor * Descriptor,
-                                        unsigned long SampleRate) {
+/* Construct a new plugin instance, pluginname names its mmap area and
+   preset bank. */
+static inline LADSPA_Handle instantiateLr4LowHighPass(const LADSPA_Descriptor * Descriptor,
+                                                      unsigned long SampleRate,
+                                                      char pluginname[]) {
     Lr4LowHighPass * psInstance;
     psInstance = (Lr4LowHighPass *)malloc(sizeof(Lr4LowHighPass));
     if (psInstance) {
         psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_slot = NULL;
         psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_meterBlock = NULL;
+        psInstance->m_pfSmoothing = NULL;
+        initPresetBank(&psInstance->m_bank,
+                       pluginname,
+                       MMAP_PARAMCOUNT,
+                       LR4_SECTIONS,
+                       psInstance->m_fSampleRate);
+        initBiquadCascade(&psInstance->m_cascade);
+        initBiquadCascade(&psInstance->m_plan.compiled);
+        psInstance->m_fRunAddingGain = 1.0;
     }  
     return psInstance;
 }
 
 /* Initialise and activate a plugin instance. */
-void activateLr4LowHighPass(LADSPA_Handle Instance);
-void activateLr4LowHighPass(LADSPA_Handle Instance) {
+static inline void activateLr4LowHighPass(LADSPA_Handle Instance) {
     Lr4LowHighPass * psInstance;
     psInstance = (Lr4LowHighPass *)Instance;
-    psInstance->m_fxnm1_pass1 = 0;
-    psInstance->m_fxnm2_pass1 = 0;
-    psInstance->m_fynm1_pass1 = 0;
-    psInstance->m_fynm2_pass1 = 0;
-    psInstance->m_fxnm1_pass2 = 0;
-    psInstance->m_fxnm2_pass2 = 0;
-    psInstance->m_fynm1_pass2 = 0;
-    psInstance->m_fynm2_pass2 = 0;
+    resetBiquadCascade(&psInstance->m_cascade, LR4_SECTIONS);
+    resetBiquadPlan(&psInstance->m_plan);
+    invalidateStateSpaceCascade(&psInstance->m_statespace);
+    invalidateBiquadParams(&psInstance->m_params);
+    psInstance->m_fGain = NAN;
 }
 
 
 /* Connect a port to a data location.  */
-void connectPortToLr4LowHighPass(LADSPA_Handle Instance,
-                                 unsigned long Port,
-                                 LADSPA_Data * DataLocation);
-void connectPortToLr4LowHighPass(LADSPA_Handle Instance,
-                                 unsigned long Port,
-                                 LADSPA_Data * DataLocation) {
+static inline void connectPortToLr4LowHighPass(LADSPA_Handle Instance,
+                                               unsigned long Port,
+                                               LADSPA_Data * DataLocation) {
   
     Lr4LowHighPass * psInstance;
     psInstance = (Lr4LowHighPass *)Instance;
@@ -94,102 +127,162 @@ void connectPortToLr4LowHighPass(LADSPA_Handle Instance,
     case SF_MMAPFNAME:
         psInstance->m_pfMmapFname = DataLocation;
         break;
+    case SF_SMOOTHING:
+        psInstance->m_pfSmoothing = DataLocation;
+        break;
     }
 }
 
-void deleteLr4LowHighPassDescriptor(LADSPA_Descriptor * psDescriptor);
-void deleteLr4LowHighPassDescriptor(LADSPA_Descriptor * psDescriptor) {
-  unsigned long lIndex;
-  if (psDescriptor) {
-    free((char *)psDescriptor->Label);
-    free((char *)psDescriptor->Name);
-    free((char *)psDescriptor->Maker);
-    free((char *)psDescriptor->Copyright);
-    free((LADSPA_PortDescriptor *)psDescriptor->PortDescriptors);
-    for (lIndex = 0; lIndex < psDescriptor->PortCount; lIndex++)
-      free((char *)(psDescriptor->PortNames[lIndex]));
-    free((char **)psDescriptor->PortNames);
-    free((LADSPA_PortRangeHint *)psDescriptor->PortRangeHints);
-    free(psDescriptor);
-  }
+/* Set the output gain of run_adding(). */
+static inline void setRunAddingGainLr4LowHighPass(LADSPA_Handle Instance, LADSPA_Data Gain) {
+    ((Lr4LowHighPass *)Instance)->m_fRunAddingGain = Gain;
 }
 
-/* Run the filter algorithm for a block of SampleCount samples. */
-void runLr4LowHighPass(LADSPA_Handle Instance, unsigned long SampleCount, BiquadCoeffs coeffs);
-void runLr4LowHighPass(LADSPA_Handle Instance, unsigned long SampleCount, BiquadCoeffs coeffs) {
+/* Run the SectionCount passes of the plan. SectionCount is meant to be a
+   compile time constant. The gain factor is applied unless it is folded
+   in. */
+CASCADE_KERNEL void runLr4LowHighPassPlan(Lr4LowHighPass * psInstance,
+                                         const int SectionCount,
+                                         unsigned long SampleCount,
+                                         const int Adding) {
+  runStateSpaceCascadeMode(&psInstance->m_statespace,
+                           &psInstance->m_plan.compiled,
+                           SectionCount,
+                           psInstance->m_pfInput,
+                           psInstance->m_pfOutput,
+                           SampleCount,
+                           Adding,
+                           psInstance->m_fRunAddingGain,
+                           psInstance->m_plan.compiled.gainFactor == 1.0);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. DesignType
+   is DESIGN_LR4_LOWPASS or DESIGN_LR4_HIGHPASS. With Adding the result is
+   added to the output buffer (run_adding). */
+CASCADE_KERNEL void runLr4LowHighPass(LADSPA_Handle Instance,
+                                     unsigned long SampleCount,
+                                     const int DesignType,
+                                     const int Adding) {
 
-  LADSPA_Data * pfInput;
-  LADSPA_Data * pfOutput;
   Lr4LowHighPass * psInstance;
-  unsigned long lSampleIndex;
-  LADSPA_Data unchanged = 0.0;
-  LADSPA_Data changed;
-  LADSPA_Data * mmptr;
-  float fGainFactor;
-  float xn, yn; // xn/yn holds currently processed input/output samples.
-  float xnm1, xnm2, ynm1, ynm2; // holds previously processed input/output samples.
+  LADSPA_Data params[MMAP_PARAMCOUNT];
+  BiquadCoeffs coeffs;
+  int changed_coeffs = 0;
+  int changed_mmap = 0;
+  int changed_preset = 0;
+  unsigned long fpuMode;
+  uint64_t startCycles;
   // get Lr4LowHighPass Instance
   psInstance = (Lr4LowHighPass *)Instance;
-  // get input and output buffers
-  pfInput = psInstance->m_pfInput;
-  pfOutput = psInstance->m_pfOutput;
-  // memcpy parameters over from mmapped area
-  mmptr = psInstance->m_mmapArea;
-  if (mmptr != NULL) {
-    memcpy(&changed, mmptr, sizeof(LADSPA_Data));
-    if (changed != 0.0) {
-      mmptr += 1;
-      memcpy(psInstance->m_pfF, mmptr, sizeof(LADSPA_Data));
-      mmptr += 1;
-      memcpy(psInstance->m_pfGain, mmptr, sizeof(LADSPA_Data));
-    }
-    // reset changed flag to re-enable parametrization by control inputs
-    memcpy(psInstance->m_mmapArea, &unchanged, sizeof(LADSPA_Data));
+  startCycles = startMmapTelemetry(psInstance->m_telemetry);
+  // recall a preset with precomputed coefficients
+  changed_preset = readPresetBank(&psInstance->m_bank,
+                                  psInstance->m_mmapParams,
+                                  params,
+                                  psInstance->m_cascade.target,
+                                  &psInstance->m_cascade.targetGainFactor);
+  // copy parameters over from mmapped area or a scene
+  if (psInstance->m_mmapArea != NULL &&
+      (changed_preset ||
+       readMmapScene(psInstance->m_slot,
+                     params,
+                     MMAP_PARAMCOUNT,
+                     SampleCount,
+                     psInstance->m_fSampleRate) ||
+       readMmapParams(psInstance->m_mmapArea,
+                      psInstance->m_mmapParams,
+                      &psInstance->m_mmapSequence,
+                      params,
+                      MMAP_PARAMCOUNT))) {
+    changed_mmap = 1;
+    *(psInstance->m_pfF) = params[0];
+    *(psInstance->m_pfGain) = params[1];
   }
-  fGainFactor = dbToGainFactor(*(psInstance->m_pfGain));
-  // get preciosuly processed samples
-  xnm1 = psInstance->m_fxnm1_pass1;
-  xnm2 = psInstance->m_fxnm2_pass1;
-  ynm1 = psInstance->m_fynm1_pass1;
-  ynm2 = psInstance->m_fynm2_pass1;
-  // FILTER PROCESSING First Pass /////////////////////////////////////////////
-  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
-    xn = *(pfInput++);
-    yn = (coeffs.b0 * xn   + coeffs.b1 * xnm1 + coeffs.b2 * xnm2 - 
-          coeffs.a1 * ynm1 - coeffs.a2 * ynm2);
-    xnm2 = xnm1;
-    xnm1 = xn;
-    ynm2 = ynm1;
-    ynm1 = yn;
-    *(pfOutput++) = yn;
+  if (changed_preset) {
+    // the recalled coefficients belong to these parameters
+    updateBiquadParams(&psInstance->m_params,
+                       params[0],
+                       0,
+                       0.7071067811865476,
+                       psInstance->m_fSampleRate);
+    psInstance->m_fGain = params[1];
+    changed_coeffs = 1;
   }
-  // store preciously calculated samples in BiQuad instance for later
-  psInstance->m_fxnm1_pass1 = xnm1;
-  psInstance->m_fxnm2_pass1 = xnm2;
-  psInstance->m_fynm1_pass1 = ynm1;
-  psInstance->m_fynm2_pass1 = ynm2;
-  // reset output buffer pointer
-  pfOutput = psInstance->m_pfOutput;
-  // get preciosuly processed samples
-  xnm1 = psInstance->m_fxnm1_pass2;
-  xnm2 = psInstance->m_fxnm2_pass2;
-  ynm1 = psInstance->m_fynm1_pass2;
-  ynm2 = psInstance->m_fynm2_pass2;
-  // FILTER PROCESSING Second Pass ////////////////////////////////////////////
-  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
-    xn = *(pfOutput);
-    yn = (coeffs.b0 * xn   + coeffs.b1 * xnm1 + coeffs.b2 * xnm2 - 
-          coeffs.a1 * ynm1 - coeffs.a2 * ynm2);
-    xnm2 = xnm1;
-    xnm1 = xn;
-    ynm2 = ynm1;
-    ynm1 = yn;
-    *(pfOutput++) = yn * fGainFactor;
+  // recalculate coeffs and gain factor only if their inputs changed
+  if (updateBiquadParams(&psInstance->m_params,
+                         *(psInstance->m_pfF),
+                         0,
+                         0.7071067811865476,
+                         psInstance->m_fSampleRate)) {
+    coeffs = designBiquad(DesignType,
+                          *(psInstance->m_pfF),
+                          0,
+                          0.7071067811865476,
+                          psInstance->m_fSampleRate);
+    // both passes use the same coefficients
+    psInstance->m_cascade.target[0] = coeffs;
+    psInstance->m_cascade.target[1] = coeffs;
+    changed_coeffs = 1;
   }
-  // store preciously calculated samples in BiQuad instance for later
-  psInstance->m_fxnm1_pass2 = xnm1;
-  psInstance->m_fxnm2_pass2 = xnm2;
-  psInstance->m_fynm1_pass2 = ynm1;
-  psInstance->m_fynm2_pass2 = ynm2;
+  if (*(psInstance->m_pfGain) != psInstance->m_fGain) {
+    psInstance->m_fGain = *(psInstance->m_pfGain);
+    psInstance->m_cascade.targetGainFactor = dbToGainFactor(psInstance->m_fGain);
+    changed_coeffs = 1;
+  }
+  // apply new coeffs at once or ramp towards them, the compiled plan
+  // takes over once they are reached
+  if (changed_coeffs) {
+    stopBiquadPlan(&psInstance->m_plan, &psInstance->m_cascade);
+    startBiquadCascadeRamp(&psInstance->m_cascade,
+                           LR4_SECTIONS,
+                           smoothingToSamples(psInstance->m_pfSmoothing,
+                                              psInstance->m_fSampleRate));
+  }
+  if (startBiquadPlan(&psInstance->m_plan, &psInstance->m_cascade, LR4_SECTIONS)) {
+    invalidateStateSpaceCascade(&psInstance->m_statespace);
+  }
+  // FILTER PROCESSING, both passes in one go /////////////////////////////////
+  fpuMode = disableDenormals();
+  if (!psInstance->m_plan.active) {
+    runBiquadCascadeMode(&psInstance->m_cascade,
+                         LR4_SECTIONS,
+                         psInstance->m_pfInput,
+                         psInstance->m_pfOutput,
+                         SampleCount,
+                         Adding,
+                         psInstance->m_fRunAddingGain);
+  } else if (psInstance->m_plan.count == LR4_SECTIONS) {
+    runLr4LowHighPassPlan(psInstance, LR4_SECTIONS, SampleCount, Adding);
+  } else {
+    // both passes are flat at the edge of the frequency range
+    runLr4LowHighPassPlan(psInstance, 0, SampleCount, Adding);
+  }
+  restoreDenormals(fpuMode);
+  publishMmapMeter(psInstance->m_meterBlock,
+                   &psInstance->m_meter,
+                   msToSamples(MMAP_METER_WINDOW_MS, psInstance->m_fSampleRate));
+  updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
 }
 
+/* Ports of the Lr4(Low|High)Pass filters, shared by all descriptors. */
+static const LADSPA_PortDescriptor g_piLr4PortDescriptors[PORTCOUNT] = {
+    [SF_INPUT] = PORT_AUDIO_INPUT,
+    [SF_OUTPUT] = PORT_AUDIO_OUTPUT,
+    [SF_F ... SF_SMOOTHING] = PORT_CONTROL_INPUT
+};
+
+static const char * const g_pcLr4PortNames[PORTCOUNT] = {
+    [SF_INPUT] = "Input",
+    [SF_OUTPUT] = "Output",
+    [SF_F] = "Cutoff Frequency [Hz]",
+    [SF_GAIN] = "Overall Gain [dB]",
+    [SF_MMAPFNAME] = "MMAP-Filename-Part",
+    [SF_SMOOTHING] = "Smoothing Time [ms]"
+};
+
+static const LADSPA_PortRangeHint g_psLr4PortRangeHints[PORTCOUNT] = {
+    [SF_F] = HINT_F,
+    [SF_GAIN] = HINT_G,
+    [SF_MMAPFNAME] = HINT_MMAPFNAME,
+    [SF_SMOOTHING] = HINT_SMOOTHING
+};
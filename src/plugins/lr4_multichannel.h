@@ -0,0 +1,290 @@
+//#include "helpers.h"
+//#include "cascade.h"
+
+/*****************************************************************************/
+
+/* Port layout of the multichannel Lr4(Low|High)Pass filters for CHANNELS
+   channels:
+
+   0 .. CHANNELS-1             audio inputs
+   CHANNELS .. 2*CHANNELS-1    audio outputs
+   2*CHANNELS                  link channels (all channels use channel 1)
+   2*CHANNELS+1+2*i            cutoff frequency of channel i
+   2*CHANNELS+2+2*i            gain of channel i
+   4*CHANNELS+1                mmap filename part
+
+   The parameters in the mmap area are the control ports in this order,
+   without the mmap filename part. */
+
+#define SF_INPUT(i)       (i)
+#define SF_OUTPUT(c, i)   ((c) + (i))
+#define SF_LINK(c)        (2 * (c))
+#define SF_F(c, i)        (2 * (c) + 1 + 2 * (i))
+#define SF_GAIN(c, i)     (2 * (c) + 2 + 2 * (i))
+#define SF_MMAPFNAME(c)   (4 * (c) + 1)
+#define PORTCOUNT(c)      (4 * (c) + 2)
+
+#define MMAP_PARAMCOUNT(c) (2 * (c) + 1)
+
+// two identical butterworth biquads make up one LR-4 filter
+#define LR4_SECTIONS   2
+
+/*****************************************************************************/
+
+/* Instance data for the multichannel Lr4(Low|High)Pass filters */
+typedef struct {
+
+    long m_created_ns;
+    time_t m_created_s;
+
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
+    LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+
+    LADSPA_Data m_fSampleRate;
+    int m_iChannels;
+    // coefficients and previous samples of both biquad passes, all channels
+    BiquadLaneCascade m_cascade;
+    // parameters the coefficients and gain factors were calculated for
+    BiquadParams m_params[CASCADE_MAX_LANES];
+    BiquadCoeffs m_coeffs[CASCADE_MAX_LANES];
+    LADSPA_Data m_fGain[CASCADE_MAX_LANES];
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
+    // port pointers
+    LADSPA_Data * m_ppfInput[CASCADE_MAX_LANES];
+    LADSPA_Data * m_ppfOutput[CASCADE_MAX_LANES];
+    LADSPA_Data * m_pfLink;
+    LADSPA_Data * m_pfF[CASCADE_MAX_LANES];
+    LADSPA_Data * m_pfGain[CASCADE_MAX_LANES];
+    LADSPA_Data * m_pfMmapFname;
+
+} Lr4LowHighPassMultiChannel;
+
+/* Construct a new plugin instance. The channel count is stored in the
+   descriptor's ImplementationData. */
+static inline LADSPA_Handle instantiateLr4LowHighPassMultiChannel(const LADSPA_Descriptor * Descriptor,
+                                                                  unsigned long SampleRate) {
+    Lr4LowHighPassMultiChannel * psInstance;
+    psInstance = (Lr4LowHighPassMultiChannel *)malloc(sizeof(Lr4LowHighPassMultiChannel));
+    if (psInstance) {
+        psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_iChannels = (int)(long)Descriptor->ImplementationData;
+        psInstance->m_slot = NULL;
+        psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_fRunAddingGain = 1.0;
+    }
+    return psInstance;
+}
+
+/* Initialise and activate a plugin instance. */
+static inline void activateLr4LowHighPassMultiChannel(LADSPA_Handle Instance) {
+    Lr4LowHighPassMultiChannel * psInstance;
+    int iChannel;
+    psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+    resetBiquadLaneCascade(&psInstance->m_cascade);
+    for (iChannel = 0; iChannel < CASCADE_MAX_LANES; iChannel++) {
+        invalidateBiquadParams(&psInstance->m_params[iChannel]);
+        psInstance->m_fGain[iChannel] = NAN;
+    }
+}
+
+/* Connect a port to a data location.  */
+static inline void connectPortToLr4LowHighPassMultiChannel(LADSPA_Handle Instance,
+                                                           unsigned long Port,
+                                                           LADSPA_Data * DataLocation) {
+    Lr4LowHighPassMultiChannel * psInstance;
+    int c, i;
+    psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+    c = psInstance->m_iChannels;
+    if (Port < SF_OUTPUT(c, 0)) {
+        psInstance->m_ppfInput[Port - SF_INPUT(0)] = DataLocation;
+    } else if (Port < SF_LINK(c)) {
+        psInstance->m_ppfOutput[Port - SF_OUTPUT(c, 0)] = DataLocation;
+    } else if (Port == SF_LINK(c)) {
+        psInstance->m_pfLink = DataLocation;
+    } else if (Port < SF_MMAPFNAME(c)) {
+        i = (Port - SF_F(c, 0)) / 2;
+        if ((Port - SF_F(c, 0)) % 2 == 0) {
+            psInstance->m_pfF[i] = DataLocation;
+        } else {
+            psInstance->m_pfGain[i] = DataLocation;
+        }
+    } else if (Port == SF_MMAPFNAME(c)) {
+        psInstance->m_pfMmapFname = DataLocation;
+    }
+}
+
+
+/* Set the output gain of run_adding(). */
+static inline void setRunAddingGainLr4LowHighPassMultiChannel(LADSPA_Handle Instance, LADSPA_Data Gain) {
+    ((Lr4LowHighPassMultiChannel *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. DesignType
+   is DESIGN_LR4_LOWPASS or DESIGN_LR4_HIGHPASS. With Adding the results
+   are added to the output buffers (run_adding). */
+static inline void runLr4LowHighPassMultiChannel(LADSPA_Handle Instance,
+                                                 unsigned long SampleCount,
+                                                 const int DesignType,
+                                                 const int Adding) {
+
+  Lr4LowHighPassMultiChannel * psInstance;
+  LADSPA_Data params[MMAP_PARAMCOUNT(CASCADE_MAX_LANES)];
+  LADSPA_Data fF, fGain;
+  BiquadDesign designs[CASCADE_MAX_LANES];
+  BiquadCoeffs designed[CASCADE_MAX_LANES];
+  int changed[CASCADE_MAX_LANES];
+  unsigned long fpuMode;
+  uint64_t startCycles;
+  int c, i, link;
+  int designCount = 0;
+  int changed_coeffs = 0;
+  int changed_mmap = 0;
+  // get Lr4LowHighPassMultiChannel Instance
+  psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+  startCycles = startMmapTelemetry(psInstance->m_telemetry);
+  c = psInstance->m_iChannels;
+  // copy parameters over from mmapped area or a scene
+  if (psInstance->m_mmapArea != NULL &&
+      (readMmapScene(psInstance->m_slot,
+                     params,
+                     MMAP_PARAMCOUNT(c),
+                     SampleCount,
+                     psInstance->m_fSampleRate) ||
+       readMmapParams(psInstance->m_mmapArea,
+                      psInstance->m_mmapParams,
+                      &psInstance->m_mmapSequence,
+                      params,
+                      MMAP_PARAMCOUNT(c)))) {
+    changed_mmap = 1;
+    *(psInstance->m_pfLink) = params[0];
+    for (i = 0; i < c; i++) {
+      *(psInstance->m_pfF[i]) = params[1 + 2 * i];
+      *(psInstance->m_pfGain[i]) = params[2 + 2 * i];
+    }
+  }
+  // recalculate coeffs and gain factors only if their inputs changed,
+  // linked channels all use the controls of channel 1
+  link = *(psInstance->m_pfLink) != 0.0;
+  for (i = 0; i < c; i++) {
+    fF = *(psInstance->m_pfF[link ? 0 : i]);
+    fGain = *(psInstance->m_pfGain[link ? 0 : i]);
+    changed[i] = updateBiquadParams(&psInstance->m_params[i],
+                                    fF,
+                                    0,
+                                    0.7071067811865476,
+                                    psInstance->m_fSampleRate);
+    if (changed[i] && !(link && i > 0)) {
+      designs[designCount].type = DesignType;
+      designs[designCount].f = fF;
+      designs[designCount].g = 0;
+      designs[designCount++].q = 0.7071067811865476;
+    }
+    if (fGain != psInstance->m_fGain[i]) {
+      psInstance->m_fGain[i] = fGain;
+      setBiquadLaneGainFactor(&psInstance->m_cascade, i, dbToGainFactor(fGain));
+      changed_coeffs = 1;
+    }
+  }
+  // all changed channels in one go
+  if (designCount > 0) {
+    designBiquadSections(designs, designCount, psInstance->m_fSampleRate, designed);
+    designCount = 0;
+  }
+  for (i = 0; i < c; i++) {
+    if (!changed[i]) {
+      continue;
+    }
+    if (link && i > 0) {
+      // share the coefficients calculated for channel 1
+      psInstance->m_coeffs[i] = psInstance->m_coeffs[0];
+    } else {
+      psInstance->m_coeffs[i] = designed[designCount++];
+    }
+    setBiquadLaneCoeffs(&psInstance->m_cascade, 0, i, psInstance->m_coeffs[i]);
+    setBiquadLaneCoeffs(&psInstance->m_cascade, 1, i, psInstance->m_coeffs[i]);
+    changed_coeffs = 1;
+  }
+  // FILTER PROCESSING, both passes of all channels in one go /////////////////
+  fpuMode = disableDenormals();
+  switch (c) {
+  case 2:
+    runBiquadLaneCascadeMode(&psInstance->m_cascade, LR4_SECTIONS, 2,
+                             psInstance->m_ppfInput, psInstance->m_ppfOutput, SampleCount,
+                             Adding, psInstance->m_fRunAddingGain);
+    break;
+  case 4:
+    runBiquadLaneCascadeMode(&psInstance->m_cascade, LR4_SECTIONS, 4,
+                             psInstance->m_ppfInput, psInstance->m_ppfOutput, SampleCount,
+                             Adding, psInstance->m_fRunAddingGain);
+    break;
+  case 8:
+    runBiquadLaneCascadeMode(&psInstance->m_cascade, LR4_SECTIONS, 8,
+                             psInstance->m_ppfInput, psInstance->m_ppfOutput, SampleCount,
+                             Adding, psInstance->m_fRunAddingGain);
+    break;
+  }
+  restoreDenormals(fpuMode);
+  updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
+}
+
+/* Ports of the multichannel Lr4(Low|High)Pass filters for C channels,
+   shared by the low and high pass descriptors. */
+#define LR4_CHANNEL_NAMES(i)   "Cutoff Frequency " #i " [Hz]", "Gain " #i " [dB]"
+#define LR4_CHANNEL_HINTS(i)   HINT_F, HINT_G
+
+#define LR4_MULTICHANNEL_PORTS(C)                                                 \
+static const LADSPA_PortDescriptor g_piLr4MultiChannelPortDescriptors##C[PORTCOUNT(C)] = { \
+    [SF_INPUT(0) ... SF_INPUT(C - 1)] = PORT_AUDIO_INPUT,                         \
+    [SF_OUTPUT(C, 0) ... SF_OUTPUT(C, C - 1)] = PORT_AUDIO_OUTPUT,                \
+    [SF_LINK(C) ... SF_MMAPFNAME(C)] = PORT_CONTROL_INPUT                         \
+};                                                                                \
+static const char * const g_pcLr4MultiChannelPortNames##C[PORTCOUNT(C)] = {     \
+    [SF_INPUT(0)] = SEQ_##C(INPUT_NAME),                                          \
+    [SF_OUTPUT(C, 0)] = SEQ_##C(OUTPUT_NAME),                                     \
+    [SF_LINK(C)] = "Link Channels",                                               \
+    [SF_F(C, 0)] = SEQ_##C(LR4_CHANNEL_NAMES),                                    \
+    [SF_MMAPFNAME(C)] = "MMAP-Filename-Part"                                      \
+};                                                                                \
+static const LADSPA_PortRangeHint g_psLr4MultiChannelPortRangeHints##C[PORTCOUNT(C)] = { \
+    [SF_LINK(C)] = HINT_LINK,                                                     \
+    [SF_F(C, 0)] = SEQ_##C(LR4_CHANNEL_HINTS),                                    \
+    [SF_MMAPFNAME(C)] = HINT_MMAPFNAME                                            \
+};
+
+LR4_MULTICHANNEL_PORTS(2)
+LR4_MULTICHANNEL_PORTS(4)
+LR4_MULTICHANNEL_PORTS(8)
+
+/* Descriptor of the C channel variant of a multichannel Lr4(Low|High)Pass. */
+#define LR4_MULTICHANNEL_DESCRIPTOR(ID, LABEL, NAME, C, RUN, RUN_ADDING, CLEANUP) { \
+    .UniqueID = ID,                                                               \
+    .Label = LABEL,                                                               \
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,                                \
+    .Name = NAME,                                                                 \
+    .Maker = T5_MAKER,                                                            \
+    .Copyright = T5_COPYRIGHT,                                                    \
+    .PortCount = PORTCOUNT(C),                                                    \
+    .PortDescriptors = g_piLr4MultiChannelPortDescriptors##C,                     \
+    .PortNames = g_pcLr4MultiChannelPortNames##C,                                 \
+    .PortRangeHints = g_psLr4MultiChannelPortRangeHints##C,                       \
+    .ImplementationData = (void *)C,                                              \
+    .instantiate = instantiateLr4LowHighPassMultiChannel,                         \
+    .connect_port = connectPortToLr4LowHighPassMultiChannel,                      \
+    .activate = activateLr4LowHighPassMultiChannel,                               \
+    .run = RUN,                                                                   \
+    .run_adding = RUN_ADDING,                                                     \
+    .set_run_adding_gain = setRunAddingGainLr4LowHighPassMultiChannel,            \
+    .deactivate = NULL,                                                           \
+    .cleanup = CLEANUP                                                            \
+}
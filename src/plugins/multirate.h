@@ -0,0 +1,328 @@
+/* multirate.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Multirate processing of low frequency bands. The input is decimated by
+   2 per stage with half-band FIR filters down to the reduced rate R of
+   at least MULTIRATE_MIN_RATE, the low band is processed at R and
+   interpolated back through the same stages. A cascade that ends in a
+   lowpass at 300Hz doesn't need a 96kHz stream, at 12kHz every section
+   costs an eighth and its poles are much further away from z = 1.
+
+   Every other tap of a half-band filter is zero, except the center tap of
+   0.5. Each stage is split into its two polyphase branches: decimating
+   computes only every second output, from the nonzero taps, interpolating
+   computes the branch of the side taps for one output and takes the
+   center tap, a plain delay, for the other. With symmetric taps a sample
+   at the lower rate costs (taps + 1) / 4 multiplies in each direction.
+
+   Taps come from a Kaiser window (beta MULTIRATE_KAISER_BETA). Stage s
+   counts from the reduced rate up and runs between 2^s R and 2^(s+1) R.
+   Everything up to R / 4 is passed with a ripple below 1e-4dB, everything
+   that would alias or image into it is at least 100dB down. Stage 0 needs
+   the sharpest filter, it rejects from 3 R / 4 up, the stages above see
+   the same bands as a smaller part of their rate and get by with fewer
+   taps. What is processed at R has to be band limited to R / 4 by the
+   processing itself, e.g. by a lowpass that is far down there.
+
+   The filters are linear phase, so the added latency is a whole number of
+   samples at the full rate, the same for all frequencies, returned by
+   multirateLatency(). Signals that are not processed this way only need a
+   delay by this amount to stay aligned, e.g. the other bands of a
+   crossover.
+
+   Blocks of any length are processed in chunks of up to
+   MULTIRATE_BLOCKSIZE samples at the full rate. */
+
+//#include "helpers.h"
+
+/*****************************************************************************/
+
+#define MULTIRATE_MAX_STAGES  6
+// decimate as long as the reduced rate stays at or above this
+#define MULTIRATE_MIN_RATE    8000
+// samples at the full rate processed per chunk
+#define MULTIRATE_BLOCKSIZE   256
+#define MULTIRATE_MAX_TAPS    31
+#define MULTIRATE_KAISER_BETA 11.0
+
+// taps of stage 0, 1 and all above, each 4 n + 3
+#define MULTIRATE_TAPS_0      31
+#define MULTIRATE_TAPS_1      23
+#define MULTIRATE_TAPS_N      19
+
+/* one half-band stage with the history of its decimator and interpolator */
+typedef struct {
+
+  int taps;
+  // side taps, symmetric: side[j] belongs to the taps center +- (2 j + 1)
+  float side[(MULTIRATE_MAX_TAPS + 1) / 4];
+  // decimator input, the last taps - 1 samples before the chunk in front
+  // of it
+  float decHistory[MULTIRATE_MAX_TAPS - 1 + MULTIRATE_BLOCKSIZE];
+  // interpolator input at the lower rate, the last (taps - 1) / 2 samples
+  // before the chunk in front of it
+  float intHistory[(MULTIRATE_MAX_TAPS - 1) / 2 + MULTIRATE_BLOCKSIZE / 2];
+  // parity of the number of samples taken at the higher rate so far
+  int phase;
+  // length and parity of the current chunk at the higher rate
+  unsigned long count;
+  int chunkPhase;
+
+} HalfbandStage;
+
+/* decimation and interpolation by 2^stages */
+typedef struct {
+
+  int stages;
+  float reducedRate;
+  HalfbandStage stage[MULTIRATE_MAX_STAGES];
+  // the chunk at 2^s R in buffer s, the full rate is buffer stages
+  float buffer[MULTIRATE_MAX_STAGES + 1][MULTIRATE_BLOCKSIZE];
+
+} Multirate;
+
+/*****************************************************************************/
+
+/* Modified Bessel function of the first kind, order 0, for the window. */
+static inline double multirateBesselI0(double x) {
+  double sum = 1, term = 1;
+  int k;
+  for (k = 1; k < 50; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+/* Design the side taps of a half-band stage with Taps taps. They are
+   normalized to sum up to 0.5, so DC passes with a gain of exactly 1. */
+static inline void designHalfbandStage(HalfbandStage * psStage, int Taps) {
+  int c = (Taps - 1) / 2, j, n;
+  double sum = 0, x, w, h[(MULTIRATE_MAX_TAPS + 1) / 4];
+  psStage->taps = Taps;
+  for (j = 0; j < (Taps + 1) / 4; j++) {
+    n = 2 * j + 1;
+    x = (double)n / (c + 1);
+    w = multirateBesselI0(MULTIRATE_KAISER_BETA * sqrt(1 - x * x))
+        / multirateBesselI0(MULTIRATE_KAISER_BETA);
+    // 0.5 sinc(n / 2), sin(pi n / 2) is +-1 for odd n
+    h[j] = ((j & 1) ? -1.0 : 1.0) / (M_PI * n) * w;
+    sum += 2 * h[j];
+  }
+  for (j = 0; j < (Taps + 1) / 4; j++) {
+    psStage->side[j] = h[j] * 0.5 / sum;
+  }
+}
+
+/* Number of stages for samplerate and the taps of all stages. */
+static inline void initMultirate(Multirate * psMultirate, float samplerate) {
+  int s;
+  psMultirate->stages = 0;
+  while (psMultirate->stages < MULTIRATE_MAX_STAGES &&
+         samplerate / (2 << psMultirate->stages) >= MULTIRATE_MIN_RATE) {
+    psMultirate->stages++;
+  }
+  psMultirate->reducedRate = samplerate / (1 << psMultirate->stages);
+  for (s = 0; s < psMultirate->stages; s++) {
+    designHalfbandStage(&psMultirate->stage[s],
+                        s == 0 ? MULTIRATE_TAPS_0 : s == 1 ? MULTIRATE_TAPS_1 : MULTIRATE_TAPS_N);
+  }
+}
+
+/* Clear the histories of all stages. */
+static inline void resetMultirate(Multirate * psMultirate) {
+  HalfbandStage * psStage;
+  int s;
+  for (s = 0; s < psMultirate->stages; s++) {
+    psStage = &psMultirate->stage[s];
+    memset(psStage->decHistory, 0, sizeof(psStage->decHistory));
+    memset(psStage->intHistory, 0, sizeof(psStage->intHistory));
+    psStage->phase = 0;
+  }
+}
+
+/* Latency in samples at the full rate: stage s delays by taps - 1
+   samples at its higher rate, half of it in the decimator and half in
+   the interpolator. */
+static inline unsigned long multirateLatency(const Multirate * psMultirate) {
+  unsigned long lLatency = 0;
+  int s;
+  for (s = 0; s < psMultirate->stages; s++) {
+    lLatency += (unsigned long)(psMultirate->stage[s].taps - 1)
+                << (psMultirate->stages - 1 - s);
+  }
+  return lLatency;
+}
+
+/* Decimate SampleCount samples by 2 into pfOutput, returns the number of
+   output samples. Samples at even positions of the whole stream get an
+   output, so a pair of outputs of the interpolator is complete as soon
+   as its first sample is due. The input is split into its two polyphase
+   branches first: the center tap reads one of them, the side taps the
+   other, both with contiguous loads. Taps is a compile time constant at
+   every call site, the loop over the taps is unrolled and the one over
+   the outputs vectorized. */
+static inline unsigned long decimateHalfbandTaps(HalfbandStage * psStage,
+                                                 const float * pfInput,
+                                                 float * pfOutput,
+                                                 unsigned long SampleCount,
+                                                 const int Taps) {
+  const int c = (Taps - 1) / 2;
+  float * x = psStage->decHistory;
+  // x[i + Taps - 1] is input sample i, p[c + 2 m] the center of output m
+  const float * p = x + psStage->phase;
+  float side[(Taps + 1) / 4];
+  float afSide[(MULTIRATE_MAX_TAPS + MULTIRATE_BLOCKSIZE) / 2];
+  float afCenter[(MULTIRATE_MAX_TAPS + MULTIRATE_BLOCKSIZE) / 2];
+  unsigned long i, m, lOutputs, lLength;
+  float y;
+  int j;
+  // local taps, pfOutput can't change them
+  memcpy(side, psStage->side, sizeof(side));
+  psStage->count = SampleCount;
+  psStage->chunkPhase = psStage->phase;
+  lOutputs = (SampleCount + 1 - psStage->phase) / 2;
+  lLength = Taps - 1 + SampleCount - psStage->phase;
+  memcpy(x + Taps - 1, pfInput, SampleCount * sizeof(float));
+  // c is odd, the side taps are at even offsets from p, the center taps
+  // at odd ones
+  for (i = 0; i < lLength / 2; i++) {
+    afSide[i] = p[2 * i];
+    afCenter[i] = p[2 * i + 1];
+  }
+  if (lLength & 1) {
+    afSide[lLength / 2] = p[lLength - 1];
+  }
+  for (m = 0; m < lOutputs; m++) {
+    y = 0.5f * afCenter[m + (c - 1) / 2];
+    for (j = 0; j < (Taps + 1) / 4; j++) {
+      y += side[j] * (afSide[m + (c - 1) / 2 - j] + afSide[m + (c + 1) / 2 + j]);
+    }
+    pfOutput[m] = y;
+  }
+  psStage->phase ^= SampleCount & 1;
+  memmove(x, x + SampleCount, (Taps - 1) * sizeof(float));
+  return lOutputs;
+}
+
+/* Interpolate the processed outputs of the last decimateHalfbandTaps()
+   of the stage by 2 into pfOutput, the chunk length at the higher rate.
+   An output at an even position is the side taps branch of the lower
+   rate sample that belongs to it, the output behind it is the center tap
+   branch, that sample delayed. The side taps branch is computed for all
+   samples first, vectorized like the decimator, then both branches are
+   interleaved. */
+static inline void interpolateHalfbandTaps(HalfbandStage * psStage,
+                                           const float * pfInput,
+                                           float * pfOutput,
+                                           const int Taps) {
+  const int c = (Taps - 1) / 2;
+  float * x = psStage->intHistory;
+  // t[m] is input m, c samples of history in front of it
+  const float * t = x + c;
+  float side[(Taps + 1) / 4];
+  float afEven[MULTIRATE_BLOCKSIZE / 2 + 1];
+  unsigned long lInputs, lPairs, m;
+  float y;
+  int j;
+  memcpy(side, psStage->side, sizeof(side));
+  if (psStage->count == 0) {
+    return;
+  }
+  lInputs = (psStage->count + 1 - psStage->chunkPhase) / 2;
+  lPairs = (psStage->count - psStage->chunkPhase) / 2;
+  memcpy(x + c, pfInput, lInputs * sizeof(float));
+  for (m = 0; m < lInputs; m++) {
+    y = 0;
+    for (j = 0; j < (Taps + 1) / 4; j++) {
+      y += side[j] * (t[m - (c - 2 * j - 1) / 2] + t[m - (c + 2 * j + 1) / 2]);
+    }
+    afEven[m] = 2 * y;
+  }
+  // the chunk may start with the second output of the last pair of the
+  // previous chunk, and end with the first one of a pair
+  if (psStage->chunkPhase) {
+    *pfOutput++ = t[-1 - (c - 1) / 2];
+  }
+  for (m = 0; m < lPairs; m++) {
+    pfOutput[2 * m] = afEven[m];
+    pfOutput[2 * m + 1] = t[m - (c - 1) / 2];
+  }
+  if (lPairs < lInputs) {
+    pfOutput[2 * lPairs] = afEven[lPairs];
+  }
+  memmove(x, x + lInputs, c * sizeof(float));
+}
+
+/* decimateHalfbandTaps() for the taps of psStage */
+static inline unsigned long decimateHalfbandStage(HalfbandStage * psStage,
+                                                  const float * pfInput,
+                                                  float * pfOutput,
+                                                  unsigned long SampleCount) {
+  switch (psStage->taps) {
+  case MULTIRATE_TAPS_0:
+    return decimateHalfbandTaps(psStage, pfInput, pfOutput, SampleCount, MULTIRATE_TAPS_0);
+  case MULTIRATE_TAPS_1:
+    return decimateHalfbandTaps(psStage, pfInput, pfOutput, SampleCount, MULTIRATE_TAPS_1);
+  default:
+    return decimateHalfbandTaps(psStage, pfInput, pfOutput, SampleCount, MULTIRATE_TAPS_N);
+  }
+}
+
+/* interpolateHalfbandTaps() for the taps of psStage */
+static inline void interpolateHalfbandStage(HalfbandStage * psStage,
+                                            const float * pfInput,
+                                            float * pfOutput) {
+  switch (psStage->taps) {
+  case MULTIRATE_TAPS_0:
+    interpolateHalfbandTaps(psStage, pfInput, pfOutput, MULTIRATE_TAPS_0);
+    break;
+  case MULTIRATE_TAPS_1:
+    interpolateHalfbandTaps(psStage, pfInput, pfOutput, MULTIRATE_TAPS_1);
+    break;
+  default:
+    interpolateHalfbandTaps(psStage, pfInput, pfOutput, MULTIRATE_TAPS_N);
+    break;
+  }
+}
+
+/* Decimate a chunk of SampleCount (at most MULTIRATE_BLOCKSIZE) samples
+   through all stages into buffer 0. Returns the number of samples at the
+   reduced rate, which may be 0 for short chunks. */
+static inline unsigned long decimateMultirate(Multirate * psMultirate,
+                                              const LADSPA_Data * pfInput,
+                                              unsigned long SampleCount) {
+  int s;
+  if (psMultirate->stages == 0) {
+    memcpy(psMultirate->buffer[0], pfInput, SampleCount * sizeof(float));
+    return SampleCount;
+  }
+  // stages count from the reduced rate, decimation starts at the top
+  for (s = psMultirate->stages - 1; s >= 0; s--) {
+    SampleCount = decimateHalfbandStage(&psMultirate->stage[s],
+                                        s == psMultirate->stages - 1 ? pfInput
+                                                                     : psMultirate->buffer[s + 1],
+                                        psMultirate->buffer[s],
+                                        SampleCount);
+  }
+  return SampleCount;
+}
+
+/* Interpolate the processed buffer 0 of the chunk last decimated back to
+   the full rate. Returns the chunk at the full rate, as long as the one
+   that was decimated. */
+static inline const float * interpolateMultirate(Multirate * psMultirate) {
+  int s;
+  for (s = 0; s < psMultirate->stages; s++) {
+    interpolateHalfbandStage(&psMultirate->stage[s],
+                             psMultirate->buffer[s],
+                             psMultirate->buffer[s + 1]);
+  }
+  return psMultirate->buffer[psMultirate->stages];
+}
+
+/*****************************************************************************/
+
+/* EOF */
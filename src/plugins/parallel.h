@@ -0,0 +1,673 @@
+/* parallel.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Parallel realization of a biquad cascade. The transfer function of a
+   cascade of N sections and its gain factor g is expanded into partial
+   fractions, with w = z^-1:
+
+     H  =  g * prod N_i(w) / D_i(w)  =  C + sum B_k(w) / D_k(w)
+
+   Every branch keeps the denominator D_k of one section of the cascade,
+   so no polynomial roots have to be found. The direct term is
+   C = g * prod b2_i / a2_i and the first order numerator B_k is the
+   remainder of H * D_k modulo D_k,
+
+     B_k  =  g * prod N_i / prod_{i!=k} D_i   (mod D_k)
+
+   computed in the ring of polynomials modulo D_k, where every element is
+   c0 + c1 w and w^2 = -(1 + a1 w) / a2. That is real arithmetic for real,
+   complex and repeated poles alike, and the differences between close
+   poles come from differences of the coefficients, which are exact. The
+   branches don't depend on each other, so each one runs in a SIMD lane
+   and their sum is the output: the latency per sample is the one of a
+   single section instead of N of them.
+
+   The branches are computed in double precision, two branches per SSE
+   register. In the parallel form rounding errors of the branches don't
+   cancel the way they do in the cascade, so poles of different sections
+   close to each other and branches much louder than their sum cost
+   accuracy. Every expansion is checked at PARALLEL_CHECK_POINTS
+   frequencies against the response of the cascade and rejected if it
+   deviates by more than PARALLEL_MAX_ERROR or if the branches are louder
+   than the sum by more than PARALLEL_MAX_CANCELLATION. Sections with a
+   pole at or next to zero (a2 below PARALLEL_MIN_A2) aren't expanded at
+   all. The cascade then keeps running.
+
+   The expansion is only computed when coefficients change, and not by
+   the audio thread: expanding and checking 5 sections takes about 3.5us,
+   most of it in the libm calls of the check. The audio thread hands the
+   targets to a worker thread, one per plugin library, through a
+   ParallelJob and wakes it with sem_post(), which never blocks. The
+   request is written like a seqlock, the result is published with the
+   generation of the request it belongs to. The audio thread installs it
+   once that generation is the one it asked for last. Until then the
+   plugin runs the cascade in another form. If the worker thread can't be
+   started there is never a parallel form, which costs speed only.
+
+   While a ramp moves the coefficients the cascade runs, the parallel form
+   takes over once the cascade has settled on its targets and their
+   expansion has arrived. Both forms realize the same transfer function,
+   so the state of one is translated into the state of the other at every
+   switch, such that both give the same zero input response. The output
+   continues without a click.
+
+*/
+
+//#include "helpers.h"
+//#include "cascade.h"
+
+/*****************************************************************************/
+
+#define PARALLEL_MAX_SECTIONS CASCADE_MAX_LANES
+#define PARALLEL_VECTOR_LANES 2
+#define PARALLEL_MAX_VECTORS (PARALLEL_MAX_SECTIONS / PARALLEL_VECTOR_LANES)
+// frequencies the expansion is checked at, log spaced up to Nyquist
+#define PARALLEL_CHECK_POINTS 24
+// largest relative error of the expanded response (about -160dB)
+#define PARALLEL_MAX_ERROR 1e-8
+// largest ratio of the summed branch magnitudes to the response (80dB)
+#define PARALLEL_MAX_CANCELLATION 1e4
+// sections with |a2| below this aren't expanded
+#define PARALLEL_MIN_A2 1e-6
+// elements of the ring modulo D_k closer than this to a multiple of D_k
+// (relative) aren't inverted
+#define PARALLEL_MIN_DETERMINANT 1e-12
+
+typedef double ParallelVector __attribute__((vector_size(PARALLEL_VECTOR_LANES * sizeof(double))));
+typedef long long ParallelMask __attribute__((vector_size(PARALLEL_VECTOR_LANES * sizeof(long long))));
+
+/* a cascade expanded into parallel branches */
+typedef struct {
+
+  // branch coefficients and state, one branch per lane, unused lanes are
+  // zero and compute silence
+  ParallelVector b0[PARALLEL_MAX_VECTORS];
+  ParallelVector b1[PARALLEL_MAX_VECTORS];
+  ParallelVector a1[PARALLEL_MAX_VECTORS];
+  ParallelVector a2[PARALLEL_MAX_VECTORS];
+  ParallelVector s1[PARALLEL_MAX_VECTORS];
+  ParallelVector s2[PARALLEL_MAX_VECTORS];
+  // direct term
+  double direct;
+  // the sections the branches were expanded from
+  BiquadCoeffs sections[PARALLEL_MAX_SECTIONS];
+  // 1 if the expansion of the current targets is usable
+  int valid;
+  // 1 while the parallel form runs instead of the cascade
+  int active;
+
+} ParallelBiquads;
+
+/* Expansion of one instance by the worker thread. The audio thread
+   writes the request, the worker the result. */
+typedef struct ParallelJobStruct {
+
+  // generation of the request, odd while the audio thread writes it
+  uint32_t requested;
+  int count;
+  double gainFactor;
+  BiquadCoeffs sections[PARALLEL_MAX_SECTIONS];
+  // generation of the request the result was expanded from
+  uint32_t done;
+  // branch coefficients, direct term, sections and valid of the result
+  ParallelBiquads result;
+  // 1 while the audio thread waits for the result of its last request
+  int waiting;
+  // next job of the worker
+  struct ParallelJobStruct * next;
+
+} ParallelJob;
+
+/* Worker thread expanding the jobs of all instances of a plugin library.
+   control serializes starting and stopping it, lock guards the list of
+   jobs, which the worker holds while it expands them. */
+typedef struct {
+
+  pthread_mutex_t control;
+  pthread_mutex_t lock;
+  sem_t wake;
+  pthread_t thread;
+  ParallelJob * jobs;
+  int count;
+  int running;
+  int quit;
+
+} ParallelWorker;
+
+/* c0 + c1 w, a polynomial modulo the denominator of a section */
+typedef struct {
+
+  double c0;
+  double c1;
+
+} ParallelRemainder;
+
+/*****************************************************************************/
+
+/* v with every lane below CASCADE_FLUSH_THRESHOLD set to zero. */
+static inline ParallelVector flushParallelState(ParallelVector v) {
+  const ParallelVector t = (ParallelVector){ 0, 0 } + CASCADE_FLUSH_THRESHOLD;
+  ParallelMask keep = (v > t) | (v < -t);
+  return (ParallelVector)((ParallelMask)v & keep);
+}
+
+/* Forget expansion and state, called when the cascade is reset. */
+static inline void resetParallelBiquads(ParallelBiquads * psParallel) {
+  memset(psParallel, 0, sizeof(ParallelBiquads));
+}
+
+
+/* c0 + c1 w + c2 w^2 modulo the denominator of psModulus. */
+static inline ParallelRemainder reduceParallelQuadratic(double c0, double c1, double c2,
+                                                        const BiquadCoeffs * psModulus) {
+  ParallelRemainder r;
+  r.c0 = c0 - c2 / psModulus->a2;
+  r.c1 = c1 - c2 * psModulus->a1 / psModulus->a2;
+  return r;
+}
+
+/* x * y modulo the denominator of psModulus. */
+static inline ParallelRemainder multiplyParallelRemainder(ParallelRemainder x,
+                                                          ParallelRemainder y,
+                                                          const BiquadCoeffs * psModulus) {
+  return reduceParallelQuadratic(x.c0 * y.c0, x.c0 * y.c1 + x.c1 * y.c0, x.c1 * y.c1, psModulus);
+}
+
+/* x / y modulo the denominator of psModulus. Returns 0 if y has (almost)
+   a common root with it and can't be inverted. */
+static inline int divideParallelRemainder(ParallelRemainder x,
+                                          ParallelRemainder y,
+                                          const BiquadCoeffs * psModulus,
+                                          ParallelRemainder * psResult) {
+  double a1 = psModulus->a1;
+  double a2 = psModulus->a2;
+  // a2 times the determinant of the multiplication by y
+  double d = y.c0 * y.c0 * a2 - y.c0 * y.c1 * a1 + y.c1 * y.c1;
+  ParallelRemainder inverse;
+  if (!(fabs(d) > PARALLEL_MIN_DETERMINANT *
+                  (y.c0 * y.c0 * fabs(a2) + fabs(y.c0 * y.c1 * a1) + y.c1 * y.c1))) {
+    return 0;
+  }
+  inverse.c0 = (y.c0 * a2 - y.c1 * a1) / d;
+  inverse.c1 = -y.c1 * a2 / d;
+  *psResult = multiplyParallelRemainder(x, inverse, psModulus);
+  return 1;
+}
+
+/* fGain times the numerators of sections iNumerator .. SectionCount - 1
+   divided by the denominators of sections iFirst .. SectionCount - 1
+   except section iSection, modulo the denominator of section iSection.
+   Returns 0 if a denominator can't be inverted. */
+static inline int productParallelRemainder(const BiquadCoeffs * psCoeffs,
+                                           int SectionCount,
+                                           int iSection,
+                                           int iFirst,
+                                           int iNumerator,
+                                           double fGain,
+                                           ParallelRemainder * psResult) {
+  const BiquadCoeffs * m = &psCoeffs[iSection];
+  ParallelRemainder r = { fGain, 0 };
+  int i;
+  for (i = iFirst; i < SectionCount; i++) {
+    const BiquadCoeffs * c = &psCoeffs[i];
+    if (i >= iNumerator) {
+      r = multiplyParallelRemainder(r, reduceParallelQuadratic(c->b0, c->b1, c->b2, m), m);
+    }
+    if (i != iSection &&
+        !divideParallelRemainder(r, reduceParallelQuadratic(1.0, c->a1, c->a2, m), m, &r)) {
+      return 0;
+    }
+  }
+  *psResult = r;
+  return 1;
+}
+
+/* Real and imaginary part of c0 + c1 w + c2 w^2 at w = exp(-j fW). */
+static inline void evaluateParallelQuadratic(double c0, double c1, double c2, double fW,
+                                             double * pfRe, double * pfIm) {
+  *pfRe = c0 + c1 * cos(fW) + c2 * cos(2 * fW);
+  *pfIm = -c1 * sin(fW) - c2 * sin(2 * fW);
+}
+
+/* Returns 1 if the expansion in psParallel reproduces the response of the
+   cascade psCoeffs / fGainFactor accurately, see the top of this file. */
+static inline int checkParallelBiquads(const ParallelBiquads * psParallel,
+                                       const BiquadCoeffs * psCoeffs,
+                                       int SectionCount,
+                                       double fGainFactor) {
+  double fW, fNRe, fNIm, fDRe, fDIm, fDD, fRe, fIm, fTemp;
+  double fCascadeRe, fCascadeIm, fParallelRe, fParallelIm, fBranches, fCascade, fError;
+  int iPoint, iSection, v, l;
+  for (iPoint = 0; iPoint < PARALLEL_CHECK_POINTS; iPoint++) {
+    fW = M_PI * pow(1e-4, 1.0 - (double)iPoint / (PARALLEL_CHECK_POINTS - 1));
+    fCascadeRe = fGainFactor;
+    fCascadeIm = 0;
+    fParallelRe = psParallel->direct;
+    fParallelIm = 0;
+    fBranches = fabs(psParallel->direct);
+    for (iSection = 0; iSection < SectionCount; iSection++) {
+      const BiquadCoeffs * c = &psCoeffs[iSection];
+      v = iSection / PARALLEL_VECTOR_LANES;
+      l = iSection % PARALLEL_VECTOR_LANES;
+      evaluateParallelQuadratic(1.0, c->a1, c->a2, fW, &fDRe, &fDIm);
+      fDD = fDRe * fDRe + fDIm * fDIm;
+      // cascade: times N_i / D_i
+      evaluateParallelQuadratic(c->b0, c->b1, c->b2, fW, &fNRe, &fNIm);
+      fRe = (fNRe * fDRe + fNIm * fDIm) / fDD;
+      fIm = (fNIm * fDRe - fNRe * fDIm) / fDD;
+      fTemp = fCascadeRe * fRe - fCascadeIm * fIm;
+      fCascadeIm = fCascadeRe * fIm + fCascadeIm * fRe;
+      fCascadeRe = fTemp;
+      // parallel: plus B_k / D_k
+      evaluateParallelQuadratic(psParallel->b0[v][l], psParallel->b1[v][l], 0, fW, &fNRe, &fNIm);
+      fRe = (fNRe * fDRe + fNIm * fDIm) / fDD;
+      fIm = (fNIm * fDRe - fNRe * fDIm) / fDD;
+      fParallelRe += fRe;
+      fParallelIm += fIm;
+      fBranches += sqrt(fRe * fRe + fIm * fIm);
+    }
+    fCascade = sqrt(fCascadeRe * fCascadeRe + fCascadeIm * fCascadeIm);
+    fError = sqrt((fParallelRe - fCascadeRe) * (fParallelRe - fCascadeRe) +
+                  (fParallelIm - fCascadeIm) * (fParallelIm - fCascadeIm));
+    if (!(fError <= fCascade * PARALLEL_MAX_ERROR) ||
+        !(fBranches <= fCascade * PARALLEL_MAX_CANCELLATION)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Translate the state of the cascade into the state of the parallel
+   branches. The state s1 + s2 w of a section i gives the zero input
+   response g * (s1 + s2 w) * prod_{l>i} N_l / prod_{l>=i} D_l, so the
+   state of branch k is the remainder of the sum of these times D_k modulo
+   D_k, to which only the sections i <= k contribute. Returns 0 if that
+   isn't possible. */
+static inline int enterParallelBiquads(ParallelBiquads * psParallel,
+                                        const BiquadCascade * psCascade,
+                                        int SectionCount) {
+  ParallelRemainder sState, sFactor;
+  int iSection, i, v, l;
+  memset(psParallel->s1, 0, sizeof(psParallel->s1));
+  memset(psParallel->s2, 0, sizeof(psParallel->s2));
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    sState.c0 = 0;
+    sState.c1 = 0;
+    for (i = 0; i <= iSection; i++) {
+      ParallelRemainder s = { psCascade->state[i].s1, psCascade->state[i].s2 };
+      if (!productParallelRemainder(psParallel->sections, SectionCount, iSection, i, i + 1,
+                                    psCascade->gainFactor, &sFactor)) {
+        return 0;
+      }
+      s = multiplyParallelRemainder(s, sFactor, &psParallel->sections[iSection]);
+      sState.c0 += s.c0;
+      sState.c1 += s.c1;
+    }
+    v = iSection / PARALLEL_VECTOR_LANES;
+    l = iSection % PARALLEL_VECTOR_LANES;
+    psParallel->s1[v][l] = sState.c0;
+    psParallel->s2[v][l] = sState.c1;
+  }
+  return 1;
+}
+
+/* Translate the state of the parallel branches back into the state of
+   the cascade, which must still have the coefficients the branches were
+   expanded from. Section by section, the state of branch k minus the
+   contributions of the sections before k leaves the state of section k
+   times the remainder of g * prod_{l>k} N_l / D_l. If a pole of the
+   cascade is cancelled by a zero of a later section its state can't be
+   recovered, the cascade then starts from silence. */
+static inline void leaveParallelBiquads(const ParallelBiquads * psParallel,
+                                        BiquadCascade * psCascade,
+                                        int SectionCount) {
+  ParallelRemainder sState, sFactor;
+  int iSection, i, v, l;
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    const BiquadCoeffs * m = &psParallel->sections[iSection];
+    v = iSection / PARALLEL_VECTOR_LANES;
+    l = iSection % PARALLEL_VECTOR_LANES;
+    sState.c0 = psParallel->s1[v][l];
+    sState.c1 = psParallel->s2[v][l];
+    for (i = 0; i < iSection; i++) {
+      ParallelRemainder s = { psCascade->state[i].s1, psCascade->state[i].s2 };
+      if (!productParallelRemainder(psParallel->sections, SectionCount, iSection, i, i + 1,
+                                    psCascade->gainFactor, &sFactor)) {
+        break;
+      }
+      s = multiplyParallelRemainder(s, sFactor, m);
+      sState.c0 -= s.c0;
+      sState.c1 -= s.c1;
+    }
+    if (i < iSection ||
+        !productParallelRemainder(psParallel->sections, SectionCount, iSection, iSection,
+                                  iSection + 1, psCascade->gainFactor, &sFactor) ||
+        !divideParallelRemainder(sState, sFactor, m, &sState)) {
+      memset(psCascade->state, 0, SectionCount * sizeof(BiquadState));
+      return;
+    }
+    psCascade->state[iSection].s1 = sState.c0;
+    psCascade->state[iSection].s2 = sState.c1;
+  }
+}
+
+/* Hand the state of a running parallel form back to psCascade, which
+   must still have the coefficients the branches were expanded from. The
+   cascade runs until the parallel form takes over again. */
+static inline void stopParallelBiquads(ParallelBiquads * psParallel,
+                                       BiquadCascade * psCascade,
+                                       int SectionCount) {
+  if (psParallel->active) {
+    leaveParallelBiquads(psParallel, psCascade, SectionCount);
+    psParallel->active = 0;
+  }
+}
+
+/* Expand the SectionCount sections psCoeffs and the gain factor
+   fGainFactor into the branches of psParallel and set valid to whether
+   the expansion is usable. Not realtime safe, the worker thread does it
+   for the audio thread. */
+static inline void expandParallelBiquads(ParallelBiquads * psParallel,
+                                         const BiquadCoeffs * psCoeffs,
+                                         int SectionCount,
+                                         double fGainFactor) {
+  ParallelRemainder sBranch;
+  int iSection, v, l;
+  const BiquadCoeffs * t = psCoeffs;
+  psParallel->valid = 0;
+  // a single section is its own parallel form
+  if (SectionCount < 2 || SectionCount > PARALLEL_MAX_SECTIONS) {
+    return;
+  }
+  memcpy(psParallel->sections, t, SectionCount * sizeof(BiquadCoeffs));
+  memset(psParallel->b0, 0, sizeof(psParallel->b0));
+  memset(psParallel->b1, 0, sizeof(psParallel->b1));
+  memset(psParallel->a1, 0, sizeof(psParallel->a1));
+  memset(psParallel->a2, 0, sizeof(psParallel->a2));
+  psParallel->direct = fGainFactor;
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    if (!(fabs(t[iSection].a2) >= PARALLEL_MIN_A2)) {
+      return;
+    }
+    psParallel->direct *= t[iSection].b2 / t[iSection].a2;
+  }
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    if (!productParallelRemainder(t, SectionCount, iSection, 0, 0, fGainFactor, &sBranch)) {
+      return;
+    }
+    v = iSection / PARALLEL_VECTOR_LANES;
+    l = iSection % PARALLEL_VECTOR_LANES;
+    psParallel->b0[v][l] = sBranch.c0;
+    psParallel->b1[v][l] = sBranch.c1;
+    psParallel->a1[v][l] = t[iSection].a1;
+    psParallel->a2[v][l] = t[iSection].a2;
+  }
+  psParallel->valid = checkParallelBiquads(psParallel, t, SectionCount, fGainFactor);
+}
+
+/* Worker of this plugin library. */
+static inline ParallelWorker * parallelWorker(void) {
+  static ParallelWorker sWorker = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+  return &sWorker;
+}
+
+/* Expand the last request of psJob if it is complete and has no result
+   yet, in the worker thread. A request written at the same time is
+   skipped, its writer wakes the worker again. */
+static inline void expandParallelJob(ParallelJob * psJob) {
+  BiquadCoeffs sections[PARALLEL_MAX_SECTIONS];
+  uint32_t requested;
+  double fGainFactor;
+  int count;
+  requested = __atomic_load_n(&psJob->requested, __ATOMIC_ACQUIRE);
+  if ((requested & 1) || requested == psJob->done) {
+    return;
+  }
+  count = psJob->count;
+  fGainFactor = psJob->gainFactor;
+  memcpy(sections, psJob->sections, sizeof(sections));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&psJob->requested, __ATOMIC_RELAXED) != requested ||
+      count < 0 || count > PARALLEL_MAX_SECTIONS) {
+    return;
+  }
+  expandParallelBiquads(&psJob->result, sections, count, fGainFactor);
+  __atomic_store_n(&psJob->done, requested, __ATOMIC_RELEASE);
+}
+
+/* Thread function of the worker: expand all jobs whenever it is woken,
+   until it is told to quit. */
+static void * runParallelWorker(void * pvWorker) {
+  ParallelWorker * psWorker = (ParallelWorker *)pvWorker;
+  ParallelJob * psJob;
+  for (;;) {
+    while (sem_wait(&psWorker->wake) != 0);
+    pthread_mutex_lock(&psWorker->lock);
+    if (psWorker->quit) {
+      pthread_mutex_unlock(&psWorker->lock);
+      return NULL;
+    }
+    for (psJob = psWorker->jobs; psJob != NULL; psJob = psJob->next) {
+      expandParallelJob(psJob);
+    }
+    pthread_mutex_unlock(&psWorker->lock);
+  }
+}
+
+/* Hand psJob to the worker, starting it for the first job, in
+   instantiate(). */
+static inline void registerParallelJob(ParallelJob * psJob) {
+  ParallelWorker * psWorker = parallelWorker();
+  memset(psJob, 0, sizeof(ParallelJob));
+  pthread_mutex_lock(&psWorker->control);
+  if (!psWorker->running && sem_init(&psWorker->wake, 0, 0) == 0) {
+    psWorker->quit = 0;
+    if (pthread_create(&psWorker->thread, NULL, runParallelWorker, psWorker) == 0) {
+      __atomic_store_n(&psWorker->running, 1, __ATOMIC_RELEASE);
+    } else {
+      sem_destroy(&psWorker->wake);
+    }
+  }
+  pthread_mutex_lock(&psWorker->lock);
+  psJob->next = psWorker->jobs;
+  psWorker->jobs = psJob;
+  psWorker->count++;
+  pthread_mutex_unlock(&psWorker->lock);
+  pthread_mutex_unlock(&psWorker->control);
+}
+
+/* Take psJob away from the worker again and stop the worker with the
+   last job, in cleanup(). Waits for an expansion in progress. */
+static inline void unregisterParallelJob(ParallelJob * psJob) {
+  ParallelWorker * psWorker = parallelWorker();
+  ParallelJob ** ppsJob;
+  int quit;
+  pthread_mutex_lock(&psWorker->control);
+  pthread_mutex_lock(&psWorker->lock);
+  for (ppsJob = &psWorker->jobs; *ppsJob != NULL; ppsJob = &(*ppsJob)->next) {
+    if (*ppsJob == psJob) {
+      *ppsJob = psJob->next;
+      psWorker->count--;
+      break;
+    }
+  }
+  quit = psWorker->count == 0 && psWorker->running;
+  psWorker->quit = quit;
+  pthread_mutex_unlock(&psWorker->lock);
+  if (quit) {
+    sem_post(&psWorker->wake);
+    pthread_join(psWorker->thread, NULL);
+    sem_destroy(&psWorker->wake);
+    __atomic_store_n(&psWorker->running, 0, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&psWorker->control);
+}
+
+/* Ask the worker for the expansion of the targets of the first
+   SectionCount sections of psCascade and its target gain factor. Until
+   installParallelBiquads() has installed it the parallel form isn't
+   used. Call this whenever targets change, before
+   startBiquadCascadeRamp(): a running parallel form hands its state back
+   to the cascade first, which still has the coefficients it was expanded
+   from. Realtime safe. */
+static inline void requestParallelBiquads(ParallelBiquads * psParallel,
+                                          ParallelJob * psJob,
+                                          BiquadCascade * psCascade,
+                                          int SectionCount) {
+  ParallelWorker * psWorker = parallelWorker();
+  uint32_t generation;
+  stopParallelBiquads(psParallel, psCascade, SectionCount);
+  psParallel->valid = 0;
+  psJob->waiting = 0;
+  // a single section is its own parallel form
+  if (SectionCount < 2 || SectionCount > PARALLEL_MAX_SECTIONS ||
+      !__atomic_load_n(&psWorker->running, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  generation = psJob->requested;
+  __atomic_store_n(&psJob->requested, generation + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  psJob->count = SectionCount;
+  psJob->gainFactor = psCascade->targetGainFactor;
+  memcpy(psJob->sections, psCascade->target, SectionCount * sizeof(BiquadCoeffs));
+  __atomic_store_n(&psJob->requested, generation + 2, __ATOMIC_RELEASE);
+  psJob->waiting = 1;
+  sem_post(&psWorker->wake);
+}
+
+/* Install the expansion asked for with requestParallelBiquads() once the
+   worker has published it. Returns 1 if it was installed with this call.
+   Costs a single load while the worker isn't done. */
+static inline int installParallelBiquads(ParallelBiquads * psParallel, ParallelJob * psJob) {
+  const ParallelBiquads * psResult = &psJob->result;
+  if (!psJob->waiting ||
+      __atomic_load_n(&psJob->done, __ATOMIC_ACQUIRE) != psJob->requested) {
+    return 0;
+  }
+  psJob->waiting = 0;
+  memcpy(psParallel->b0, psResult->b0, sizeof(psParallel->b0));
+  memcpy(psParallel->b1, psResult->b1, sizeof(psParallel->b1));
+  memcpy(psParallel->a1, psResult->a1, sizeof(psParallel->a1));
+  memcpy(psParallel->a2, psResult->a2, sizeof(psParallel->a2));
+  memcpy(psParallel->sections, psResult->sections, sizeof(psParallel->sections));
+  psParallel->direct = psResult->direct;
+  psParallel->valid = psResult->valid;
+  return 1;
+}
+
+/*****************************************************************************/
+
+/* Run SampleCount samples through the SectionCount branches of
+   psParallel and sum them up. SectionCount is meant to be a compile time
+   constant at every call site. With Adding the sum times fRunAddingGain
+   is added to pfOutput, with Metering levels are added to psMeter, the
+   output before the run_adding gain, see runBiquadCascadeBlock(). */
+CASCADE_KERNEL void runParallelBiquadsBlock(ParallelBiquads * psParallel,
+                                           const int SectionCount,
+                                           const LADSPA_Data * pfInput,
+                                           LADSPA_Data * pfOutput,
+                                           unsigned long SampleCount,
+                                           const int Adding,
+                                           float fRunAddingGain,
+                                           const int Metering,
+                                           MeterAccumulator * psMeter) {
+  const int Vectors = (SectionCount + PARALLEL_VECTOR_LANES - 1) / PARALLEL_VECTOR_LANES;
+  ParallelVector b0[PARALLEL_MAX_VECTORS], b1[PARALLEL_MAX_VECTORS];
+  ParallelVector a1[PARALLEL_MAX_VECTORS], a2[PARALLEL_MAX_VECTORS];
+  ParallelVector s1[PARALLEL_MAX_VECTORS], s2[PARALLEL_MAX_VECTORS];
+  ParallelVector xv, yv, sum;
+  double direct = psParallel->direct;
+  unsigned long lSampleIndex;
+  int v;
+  float xn, yn;
+  float fAbs, fInPeak = 0, fOutPeak = 0, fInSquares = 0, fOutSquares = 0;
+  unsigned long lInClips = 0, lOutClips = 0;
+  for (v = 0; v < Vectors; v++) {
+    b0[v] = psParallel->b0[v];
+    b1[v] = psParallel->b1[v];
+    a1[v] = psParallel->a1[v];
+    a2[v] = psParallel->a2[v];
+    s1[v] = psParallel->s1[v];
+    s2[v] = psParallel->s2[v];
+  }
+  // FILTER PROCESSING, all branches side by side /////////////////////////////
+  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+    xn = pfInput[lSampleIndex];
+    if (Metering) {
+      fAbs = fabsf(xn);
+      fInPeak = fAbs > fInPeak ? fAbs : fInPeak;
+      fInSquares += xn * xn;
+      lInClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    xv = (ParallelVector){ 0, 0 } + (double)xn;
+    sum = (ParallelVector){ 0, 0 };
+    for (v = 0; v < Vectors; v++) {
+      yv = b0[v] * xv + s1[v];
+      s1[v] = b1[v] * xv - a1[v] * yv + s2[v];
+      s2[v] = -a2[v] * yv;
+      sum += yv;
+    }
+    yn = direct * xn + sum[0] + sum[1];
+    if (Metering) {
+      fAbs = fabsf(yn);
+      fOutPeak = fAbs > fOutPeak ? fAbs : fOutPeak;
+      fOutSquares += yn * yn;
+      lOutClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    if (Adding) {
+      pfOutput[lSampleIndex] += yn * fRunAddingGain;
+    } else {
+      pfOutput[lSampleIndex] = yn;
+    }
+  }
+  if (Metering) {
+    psMeter->inPeak = fInPeak > psMeter->inPeak ? fInPeak : psMeter->inPeak;
+    psMeter->outPeak = fOutPeak > psMeter->outPeak ? fOutPeak : psMeter->outPeak;
+    psMeter->inSquares += fInSquares;
+    psMeter->outSquares += fOutSquares;
+    psMeter->samples += SampleCount;
+    psMeter->inClips += lInClips;
+    psMeter->outClips += lOutClips;
+  }
+  for (v = 0; v < Vectors; v++) {
+    psParallel->s1[v] = flushParallelState(s1[v]);
+    psParallel->s2[v] = flushParallelState(s2[v]);
+  }
+}
+
+/* Run SampleCount samples through the first SectionCount sections of
+   psCascade, in parallel form whenever the cascade has settled on targets
+   with a usable expansion, else as the cascade itself. Adding selects the
+   run_adding flavour, see runBiquadCascadeMode(). */
+CASCADE_KERNEL void runParallelBiquadsMode(ParallelBiquads * psParallel,
+                                          BiquadCascade * psCascade,
+                                          const int SectionCount,
+                                          const LADSPA_Data * pfInput,
+                                          LADSPA_Data * pfOutput,
+                                          unsigned long SampleCount,
+                                          const int Adding,
+                                          float fRunAddingGain) {
+  if (!psParallel->active && psParallel->valid && psCascade->rampSteps == 0) {
+    // the cascade has reached the targets of the expansion
+    psParallel->active = enterParallelBiquads(psParallel, psCascade, SectionCount);
+    psParallel->valid = psParallel->active;
+  }
+  if (!psParallel->active) {
+    runBiquadCascadeMode(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                         Adding, fRunAddingGain);
+    return;
+  }
+#if MMAP_METERING
+  if (psCascade->meter != NULL) {
+    runParallelBiquadsBlock(psParallel, SectionCount, pfInput, pfOutput, SampleCount,
+                            Adding, fRunAddingGain, 1, psCascade->meter);
+    return;
+  }
+#endif
+  runParallelBiquadsBlock(psParallel, SectionCount, pfInput, pfOutput, SampleCount,
+                          Adding, fRunAddingGain, 0, NULL);
+}
+
+/* EOF */
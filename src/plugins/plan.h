@@ -0,0 +1,151 @@
+/* plan.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Compiled form of a biquad cascade that has settled on its targets.
+   Sections that pass their input through unchanged, like peaking and
+   shelving sections at 0dB, are dropped, and the gain factor is folded
+   into the b coefficients of the last remaining section. The result is
+   a shorter cascade with a gain factor of 1, which the plugin runs with
+   a kernel unrolled for its section count: flat bands cost nothing and
+   the gain costs no multiply per sample.
+
+   The plan is compiled once the full cascade has reached its targets
+   and is given up whenever targets change: ramps always run on the full
+   cascade, and the compiled sections hand their state back to it first.
+   Folding the gain factor g into the numerator of the last section
+   scales its state by g as well, which is undone on the way back. A gain
+   factor below PLAN_MIN_FOLDED_GAIN is not folded in: its state would
+   approach the flush threshold and dividing by g would blow up what is
+   left of it. The compiled cascade then keeps g as its gain factor.
+
+   A dropped section must not leave a tail behind, so the plan only takes
+   over once the state of every section to be dropped has decayed below
+   PLAN_MAX_DROPPED_STATE, an identity section still rings with the poles
+   it had when it was ramped to 0dB. The rest of that state is cleared,
+   so when the section is needed again it starts from exactly the state
+   it would have had in the full cascade and the output continues without
+   a click.
+
+*/
+
+//#include "helpers.h"
+//#include "cascade.h"
+
+/*****************************************************************************/
+
+// largest deviation of b0 from 1 of a section that is dropped, the
+// coefficient calculations only get 1 up to rounding
+#define PLAN_IDENTITY_TOLERANCE 1e-15
+// largest state of a section that is dropped (about -240dB)
+#define PLAN_MAX_DROPPED_STATE 1e-12
+// smallest gain factor folded into the last section (-120dB), keeps its
+// state far above CASCADE_FLUSH_THRESHOLD
+#define PLAN_MIN_FOLDED_GAIN 1e-6
+
+/* a cascade without its identity sections and with its gain folded in */
+typedef struct {
+
+  // the remaining sections, with their state while the plan runs
+  BiquadCascade compiled;
+  // section of the full cascade every compiled section comes from
+  int sections[CASCADE_MAX_SECTIONS];
+  int count;
+  // gain factor folded into the last compiled section, 1 for none
+  double foldedGainFactor;
+  // 1 while the compiled cascade runs instead of the full one
+  int active;
+
+} BiquadPlan;
+
+/*****************************************************************************/
+
+/* Forget the plan, called when the full cascade is reset. */
+static inline void resetBiquadPlan(BiquadPlan * psPlan) {
+  psPlan->count = 0;
+  psPlan->active = 0;
+}
+
+/* Returns 1 if a section passes its input through unchanged: numerator
+   and denominator are the same polynomial. */
+static inline int isIdentityBiquad(const BiquadCoeffs * psCoeffs) {
+  return psCoeffs->b1 == psCoeffs->a1 &&
+         psCoeffs->b2 == psCoeffs->a2 &&
+         fabs(psCoeffs->b0 - 1.0) <= PLAN_IDENTITY_TOLERANCE;
+}
+
+/* Compile the first SectionCount sections of psCascade and take over
+   their state, if the cascade has settled on its targets, including the
+   last step of its ramp, and all identity sections are silent. Returns 1
+   if the compiled cascade takes over with this call, it then needs new
+   parallel branches or block matrices. */
+static inline int startBiquadPlan(BiquadPlan * psPlan,
+                                  BiquadCascade * psCascade,
+                                  int SectionCount) {
+  BiquadCascade * c = &psPlan->compiled;
+  float fGainFactor = psCascade->gainFactor;
+  int iSection, n = 0;
+  if (psPlan->active || !psCascade->hasCoeffs ||
+      psCascade->rampSteps != 0 || psCascade->rampCountdown != 0) {
+    return 0;
+  }
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    if (isIdentityBiquad(&psCascade->coeffs[iSection]) &&
+        (fabs(psCascade->state[iSection].s1) > PLAN_MAX_DROPPED_STATE ||
+         fabs(psCascade->state[iSection].s2) > PLAN_MAX_DROPPED_STATE)) {
+      // still ringing, try again with the next run
+      return 0;
+    }
+  }
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    if (isIdentityBiquad(&psCascade->coeffs[iSection])) {
+      memset(&psCascade->state[iSection], 0, sizeof(BiquadState));
+      continue;
+    }
+    psPlan->sections[n] = iSection;
+    c->coeffs[n] = psCascade->coeffs[iSection];
+    c->state[n] = psCascade->state[iSection];
+    c->useDouble[n] = psCascade->useDouble[iSection];
+    n++;
+  }
+  psPlan->foldedGainFactor = 1.0;
+  if (n > 0 && fabs(fGainFactor) >= PLAN_MIN_FOLDED_GAIN) {
+    c->coeffs[n - 1].b0 *= fGainFactor;
+    c->coeffs[n - 1].b1 *= fGainFactor;
+    c->coeffs[n - 1].b2 *= fGainFactor;
+    c->state[n - 1].s1 *= fGainFactor;
+    c->state[n - 1].s2 *= fGainFactor;
+    psPlan->foldedGainFactor = fGainFactor;
+    fGainFactor = 1.0;
+  }
+  memcpy(c->target, c->coeffs, n * sizeof(BiquadCoeffs));
+  c->gainFactor = fGainFactor;
+  c->targetGainFactor = fGainFactor;
+  c->rampSteps = 0;
+  c->rampCountdown = 0;
+  c->hasCoeffs = 1;
+  c->meter = psCascade->meter;
+  psPlan->count = n;
+  psPlan->active = 1;
+  return 1;
+}
+
+/* Hand the state of the compiled sections back to psCascade, called
+   whenever targets change, before startBiquadCascadeRamp(). */
+static inline void stopBiquadPlan(BiquadPlan * psPlan, BiquadCascade * psCascade) {
+  int i;
+  if (!psPlan->active) {
+    return;
+  }
+  for (i = 0; i < psPlan->count; i++) {
+    psCascade->state[psPlan->sections[i]] = psPlan->compiled.state[i];
+  }
+  if (psPlan->count > 0) {
+    psCascade->state[psPlan->sections[psPlan->count - 1]].s1 /= psPlan->foldedGainFactor;
+    psCascade->state[psPlan->sections[psPlan->count - 1]].s2 /= psPlan->foldedGainFactor;
+  }
+  psPlan->active = 0;
+}
+
+/* EOF */
@@ -0,0 +1,261 @@
+/* presets.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Preset banks hold the parameters of a number of presets of one plugin
+   type together with their biquad coefficients, precomputed for a few
+   sample rates. t5_presetbank writes them to
+   PRESET_BANK_DIR/t5_bank_<name>, <name> being the name the plugin uses
+   for its mmap area, e.g. t5_bank_3BandParamEqWithShelves. Instances map
+   the bank of their plugin type read-only when a preset is selected for
+   the first time, instances that never recall a preset don't touch it.
+
+   A controller recalls preset i of an instance by writing i + 1 into the
+   preset field of the instance's parameter block. The audio thread then
+   copies the coefficients of that preset for its sample rate and the
+   preset's parameters, without any coefficient math or parsing. New
+   coefficients are ramped to like any other parameter change. The outcome
+   is reported in presetStatus of the parameter block, one of the
+   PRESET_STATUS_* values below. A bank that can't be used is not tried
+   again by the instance. A bank replaced on disk (write a new file and
+   rename it over the old one) is used by instances that haven't opened
+   it yet.
+
+   File layout, all values in host byte order:
+
+     PresetBankHeader
+     presetCount records, each one
+       LADSPA_Data params[paramCount], in the order of the mmap area,
+                                       padded to a multiple of 8 bytes
+       rateCount times, in the order of sampleRates
+         double gainFactor
+         BiquadCoeffs coeffs[sectionCount]
+
+*/
+
+//#include "helpers.h"
+
+/*****************************************************************************/
+
+#ifndef PRESET_BANK_DIR
+#define PRESET_BANK_DIR "/dev/shm"
+#endif
+
+#define PRESET_BANK_MAGIC 0x31423554 // "T5B1"
+#define PRESET_BANK_VERSION 1
+#define PRESET_BANK_MAX_RATES 8
+#define PRESET_BANK_NAME_SIZE 64
+
+// values of presetStatus in the parameter block
+#define PRESET_STATUS_NONE 0 // no preset selected
+#define PRESET_STATUS_OK 1 // the selected preset has been recalled
+#define PRESET_STATUS_NO_PRESET 2 // the bank has no such preset
+#define PRESET_STATUS_NO_BANK 3 // there is no bank file
+#define PRESET_STATUS_BAD_BANK 4 // the bank can't be mapped or doesn't fit the plugin
+#define PRESET_STATUS_NO_RATE 5 // the bank has no coefficients for the sample rate
+
+/* header at the start of a preset bank file */
+typedef struct {
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t paramCount;
+    uint32_t sectionCount;
+    uint32_t presetCount;
+    uint32_t rateCount;
+    float sampleRates[PRESET_BANK_MAX_RATES];
+
+} __attribute__((aligned(CACHELINE_SIZE))) PresetBankHeader;
+
+/* preset bank as mapped by an instance */
+typedef struct {
+
+    // mapped file, null if the instance has no usable bank
+    const char * base;
+    size_t size;
+    // what the bank has to fit, stored in instantiate()
+    char pluginname[PRESET_BANK_NAME_SIZE];
+    float samplerate;
+    // PRESET_STATUS_NONE until the bank is opened, PRESET_STATUS_OK if it
+    // is usable, why it isn't otherwise
+    uint32_t status;
+    uint32_t paramCount;
+    uint32_t sectionCount;
+    uint32_t presetCount;
+    // size of a preset record and offset of the instance's sample rate in it
+    size_t recordSize;
+    size_t rateOffset;
+    // value of the preset field applied last
+    uint32_t selected;
+
+} PresetBank;
+
+/*****************************************************************************/
+
+/* Size of the parameters at the start of a preset record. */
+static inline size_t presetBankParamsSize(uint32_t paramCount) {
+    return (paramCount * sizeof(LADSPA_Data) + 7) / 8 * 8;
+}
+
+/* Size of the coefficients of a preset for one sample rate. */
+static inline size_t presetBankRateSize(uint32_t sectionCount) {
+    return sizeof(double) + sectionCount * sizeof(BiquadCoeffs);
+}
+
+/* Size of a whole preset record. */
+static inline size_t presetBankRecordSize(const PresetBankHeader * psHeader) {
+    return presetBankParamsSize(psHeader->paramCount) +
+           psHeader->rateCount * presetBankRateSize(psHeader->sectionCount);
+}
+
+/* Name of the bank file of a plugin type. */
+static inline void presetBankName(const char pluginname[], char * pcName) {
+    sprintf(pcName, "%s/t5_bank_%s", PRESET_BANK_DIR, pluginname);
+}
+
+/* Store what the preset bank of an instance has to fit, in
+   instantiate(). The bank is opened by readPresetBank() once a preset is
+   selected. */
+static inline void initPresetBank(PresetBank * psBank,
+                                  const char pluginname[],
+                                  int paramcount,
+                                  int sectioncount,
+                                  float samplerate) {
+    psBank->base = NULL;
+    strncpy(psBank->pluginname, pluginname, PRESET_BANK_NAME_SIZE - 1);
+    psBank->pluginname[PRESET_BANK_NAME_SIZE - 1] = '\0';
+    psBank->samplerate = samplerate;
+    psBank->status = PRESET_STATUS_NONE;
+    psBank->paramCount = paramcount;
+    psBank->sectionCount = sectioncount;
+    psBank->selected = 0;
+}
+
+/* Map the preset bank set up by initPresetBank(). Sets psBank->status to
+   PRESET_STATUS_OK if the bank can be used, to the reason why not
+   otherwise. Not realtime safe, only called for the first selection. */
+static inline void openPresetBank(PresetBank * psBank) {
+    const PresetBankHeader * psHeader;
+    struct stat sStat;
+    char name[255];
+    void * area;
+    uint32_t i;
+    presetBankName(psBank->pluginname, name);
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        psBank->status = PRESET_STATUS_NO_BANK;
+        return;
+    }
+    if (fstat(fd, &sStat) != 0 || sStat.st_size < (off_t)sizeof(PresetBankHeader)) {
+        psBank->status = PRESET_STATUS_BAD_BANK;
+        close(fd);
+        return;
+    }
+    area = mmap(NULL, sStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (area == MAP_FAILED) {
+        psBank->status = PRESET_STATUS_BAD_BANK;
+        return;
+    }
+    psHeader = (const PresetBankHeader *)area;
+    if (psHeader->magic != PRESET_BANK_MAGIC ||
+        psHeader->version != PRESET_BANK_VERSION ||
+        psHeader->paramCount != psBank->paramCount ||
+        psHeader->sectionCount != psBank->sectionCount ||
+        psHeader->rateCount > PRESET_BANK_MAX_RATES ||
+        (size_t)sStat.st_size < sizeof(PresetBankHeader) +
+                                psHeader->presetCount * presetBankRecordSize(psHeader)) {
+        psBank->status = PRESET_STATUS_BAD_BANK;
+        munmap(area, sStat.st_size);
+        return;
+    }
+    for (i = 0; i < psHeader->rateCount && psHeader->sampleRates[i] != psBank->samplerate; i++);
+    if (i == psHeader->rateCount) {
+        psBank->status = PRESET_STATUS_NO_RATE;
+        munmap(area, sStat.st_size);
+        return;
+    }
+    psBank->base = (const char *)area;
+    psBank->size = sStat.st_size;
+    psBank->presetCount = psHeader->presetCount;
+    psBank->recordSize = presetBankRecordSize(psHeader);
+    psBank->rateOffset = presetBankParamsSize(psBank->paramCount) +
+                         i * presetBankRateSize(psBank->sectionCount);
+    psBank->status = PRESET_STATUS_OK;
+}
+
+/* Unmap the bank again, in cleanup(). */
+static inline void closePresetBank(PresetBank * psBank) {
+    if (psBank->base != NULL) {
+        munmap((void *)psBank->base, psBank->size);
+        psBank->base = NULL;
+    }
+}
+
+/* Recall the preset selected in psBlock if the selection changed: copy
+   its parameters into pfParams, its coefficients into psCoeffs and its
+   gain factor into *pfGainFactor. Returns 1 if a preset was recalled, 0
+   otherwise, the outcome goes to psBlock->presetStatus. The first
+   selection opens the bank. Unchanged selections cost a single load. */
+static inline int readPresetBank(PresetBank * psBank,
+                                 MmapParamBlock * psBlock,
+                                 LADSPA_Data * pfParams,
+                                 BiquadCoeffs * psCoeffs,
+                                 float * pfGainFactor) {
+    const char * record;
+    uint32_t preset;
+    double gainFactor;
+    if (psBlock == NULL) {
+        return 0;
+    }
+    preset = __atomic_load_n(&psBlock->preset, __ATOMIC_ACQUIRE);
+    if (preset == psBank->selected) {
+        return 0;
+    }
+    psBank->selected = preset;
+    if (preset == 0) {
+        __atomic_store_n(&psBlock->presetStatus, PRESET_STATUS_NONE, __ATOMIC_RELEASE);
+        return 0;
+    }
+    if (psBank->status == PRESET_STATUS_NONE) {
+        openPresetBank(psBank);
+    }
+    if (psBank->status != PRESET_STATUS_OK) {
+        __atomic_store_n(&psBlock->presetStatus, psBank->status, __ATOMIC_RELEASE);
+        return 0;
+    }
+    if (preset > psBank->presetCount) {
+        __atomic_store_n(&psBlock->presetStatus, PRESET_STATUS_NO_PRESET, __ATOMIC_RELEASE);
+        return 0;
+    }
+    record = psBank->base + sizeof(PresetBankHeader) + (preset - 1) * psBank->recordSize;
+    memcpy(pfParams, record, psBank->paramCount * sizeof(LADSPA_Data));
+    record += psBank->rateOffset;
+    memcpy(&gainFactor, record, sizeof(double));
+    *pfGainFactor = gainFactor;
+    memcpy(psCoeffs, record + sizeof(double), psBank->sectionCount * sizeof(BiquadCoeffs));
+    __atomic_store_n(&psBlock->presetStatus, PRESET_STATUS_OK, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* Store the parameters of a recalled EQ preset, frequency, gain and Q of
+   each section, in the caches of the sections, so the coefficients of the
+   preset are not calculated once more. */
+static inline void primeParamEqBiquadParams(BiquadParams * psParams,
+                                            int SectionCount,
+                                            const LADSPA_Data * pfParams,
+                                            float samplerate) {
+    int iSection;
+    for (iSection = 0; iSection < SectionCount; iSection++) {
+        updateBiquadParams(&psParams[iSection],
+                           pfParams[3 * iSection],
+                           pfParams[3 * iSection + 1],
+                           pfParams[3 * iSection + 2],
+                           samplerate);
+    }
+}
+
+/*****************************************************************************/
+
+/* EOF */
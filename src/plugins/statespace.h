@@ -0,0 +1,294 @@
+/* statespace.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Block state-space kernel for a single channel biquad cascade. The
+   per-sample kernel of cascade.h waits for every section's result before
+   the next one can start, one channel never fills a SIMD register. Here
+   STATESPACE_BLOCKSIZE samples are computed per step from the state at
+   the start of the block:
+
+     y[j]   = g * (C A^j s + sum_{i<=j} h[j-i] x[i])        j < L
+     s'     = A^L s + sum_{i<L} A^(L-1-i) B x[i]
+
+   where s is the state of all sections (the s1 and s2 of cascade.h), A,
+   B, C the state-space matrices of the cascade and h its impulse
+   response. All L outputs are one vector of L floats, summed up from the
+   columns of C A^j and h, and every state variable of s' is independent
+   of the others. None of the products depends on another product of the
+   same block, only the new state on the old one, so the latency of the
+   recursion is paid once per block instead of once per section and
+   sample. With -mavx a block of 8 outputs is one AVX register, with SSE
+   it takes two.
+
+   The state stays the state of the cascade, so the per-sample kernel can
+   take over at any sample: during coefficient ramps, for the rest of a
+   run() that isn't a whole block and for short runs. The matrices are
+   built from the BiquadCoeffs once after every coefficient change, by
+   running the cascade in double precision for each unit state and an
+   impulse, so they follow the exact arithmetic of the sections. The
+   state update is done in double precision, a pole close to the unit
+   circle is then as accurate as in a double precision section. The
+   outputs are summed up in float, the terms of C A^j s partly cancel, so
+   their rounding noise is up to about 20dB above the float resolution
+   (-130dB instead of -147dB for a LR-4 lowpass at 200Hz).
+
+   A block costs (2 N + L) (2 N + L) multiply-adds for N sections, the
+   per-sample kernel 5 N L. That pays when the per-sample kernel is
+   latency bound, which it is for a single channel, and the setup pays
+   from STATESPACE_MIN_SAMPLES samples per run() on.
+
+*/
+
+//#include "helpers.h"
+//#include "cascade.h"
+
+/*****************************************************************************/
+
+// samples per step
+#define STATESPACE_BLOCKSIZE 8
+#define STATESPACE_MAX_SECTIONS 5
+#define STATESPACE_MAX_ORDER (2 * STATESPACE_MAX_SECTIONS)
+// the state is updated in vectors of 2 doubles
+#define STATESPACE_STATE_LANES 2
+#define STATESPACE_STATE_VECTORS (STATESPACE_MAX_ORDER / STATESPACE_STATE_LANES)
+// shorter runs use the per-sample kernel
+#define STATESPACE_MIN_SAMPLES 16
+
+typedef float StateSpaceOutputVector __attribute__((vector_size(STATESPACE_BLOCKSIZE * sizeof(float))));
+typedef double StateSpaceStateVector __attribute__((vector_size(STATESPACE_STATE_LANES * sizeof(double))));
+
+/* block matrices of a cascade and its gain factor */
+typedef struct {
+
+  // outputs of a block: column k of g C A^j for state variable k and
+  // column i of the toeplitz matrix g h[j - i] for input sample i
+  StateSpaceOutputVector state2output[STATESPACE_MAX_ORDER];
+  StateSpaceOutputVector input2output[STATESPACE_BLOCKSIZE];
+  // next state: column k of A^L and column i of A^(L-1-i) B
+  StateSpaceStateVector state2state[STATESPACE_MAX_ORDER][STATESPACE_STATE_VECTORS];
+  StateSpaceStateVector input2state[STATESPACE_BLOCKSIZE][STATESPACE_STATE_VECTORS];
+  // 1 if the matrices belong to the current coefficients
+  int valid;
+
+} StateSpaceCascade;
+
+/*****************************************************************************/
+
+/* Forget the matrices, called whenever the coefficients of the cascade
+   change. They are built again when they are needed. */
+static inline void invalidateStateSpaceCascade(StateSpaceCascade * psStateSpace) {
+  psStateSpace->valid = 0;
+}
+
+/* Push one sample through SectionCount sections with the state pdState
+   (s1 and s2 of each section) in double precision, returns the output
+   of the last section without the gain factor. */
+static inline double stepStateSpaceCascade(const BiquadCoeffs * psCoeffs,
+                                           int SectionCount,
+                                           double * pdState,
+                                           double x) {
+  double y;
+  int iSection;
+  for (iSection = 0; iSection < SectionCount; iSection++) {
+    const BiquadCoeffs * c = &psCoeffs[iSection];
+    y = c->b0 * x + pdState[2 * iSection];
+    pdState[2 * iSection] = c->b1 * x - c->a1 * y + pdState[2 * iSection + 1];
+    pdState[2 * iSection + 1] = c->b2 * x - c->a2 * y;
+    x = y;
+  }
+  return x;
+}
+
+/* Build the block matrices for the current coefficients and gain factor
+   of the first SectionCount sections of psCascade. */
+static inline void buildStateSpaceCascade(StateSpaceCascade * psStateSpace,
+                                          const BiquadCascade * psCascade,
+                                          int SectionCount) {
+  double adState[STATESPACE_MAX_ORDER];
+  double adStates[STATESPACE_BLOCKSIZE][STATESPACE_MAX_ORDER];
+  double adImpulse[STATESPACE_BLOCKSIZE];
+  int Order = 2 * SectionCount;
+  int j, k, i;
+  memset(psStateSpace, 0, sizeof(StateSpaceCascade));
+  // zero input response of every unit state
+  for (k = 0; k < Order; k++) {
+    memset(adState, 0, sizeof(adState));
+    adState[k] = 1.0;
+    for (j = 0; j < STATESPACE_BLOCKSIZE; j++) {
+      psStateSpace->state2output[k][j] = psCascade->gainFactor *
+        stepStateSpaceCascade(psCascade->coeffs, SectionCount, adState, 0.0);
+    }
+    for (i = 0; i < Order; i++) {
+      psStateSpace->state2state[k][i / STATESPACE_STATE_LANES][i % STATESPACE_STATE_LANES] = adState[i];
+    }
+  }
+  // impulse response and the states after it, an impulse at sample i
+  // leaves the state after L - i samples of it
+  memset(adState, 0, sizeof(adState));
+  for (j = 0; j < STATESPACE_BLOCKSIZE; j++) {
+    adImpulse[j] = stepStateSpaceCascade(psCascade->coeffs, SectionCount, adState, j == 0 ? 1.0 : 0.0);
+    memcpy(adStates[j], adState, sizeof(adState));
+  }
+  for (i = 0; i < STATESPACE_BLOCKSIZE; i++) {
+    for (j = i; j < STATESPACE_BLOCKSIZE; j++) {
+      psStateSpace->input2output[i][j] = psCascade->gainFactor * adImpulse[j - i];
+    }
+    for (k = 0; k < Order; k++) {
+      psStateSpace->input2state[i][k / STATESPACE_STATE_LANES][k % STATESPACE_STATE_LANES] =
+        adStates[STATESPACE_BLOCKSIZE - 1 - i][k];
+    }
+  }
+  psStateSpace->valid = 1;
+}
+
+/* Run the whole blocks of SampleCount samples through the first
+   SectionCount sections of psCascade and return the number of samples
+   processed. SectionCount is meant to be a compile time constant at
+   every call site. Adding and Metering select the kernel flavour, see
+   runBiquadCascadeBlock(), the output is metered before the run_adding
+   gain. */
+CASCADE_KERNEL unsigned long runStateSpaceCascadeBlocks(StateSpaceCascade * psStateSpace,
+                                                       BiquadCascade * psCascade,
+                                                       const int SectionCount,
+                                                       const LADSPA_Data * pfInput,
+                                                       LADSPA_Data * pfOutput,
+                                                       unsigned long SampleCount,
+                                                       const int Adding,
+                                                       float fRunAddingGain,
+                                                       const int Metering) {
+  const int Order = 2 * SectionCount;
+  const int Vectors = (Order + STATESPACE_STATE_LANES - 1) / STATESPACE_STATE_LANES;
+  unsigned long lBlocks = SampleCount / STATESPACE_BLOCKSIZE;
+  unsigned long lBlock;
+  StateSpaceStateVector sv[STATESPACE_STATE_VECTORS], nv[STATESPACE_STATE_VECTORS];
+  StateSpaceOutputVector yv;
+  float xn[STATESPACE_BLOCKSIZE];
+  double s;
+  int i, j, k, v;
+  float fAbs, fInPeak = 0, fOutPeak = 0, fInSquares = 0, fOutSquares = 0;
+  unsigned long lInClips = 0, lOutClips = 0;
+  for (k = 0; k < Order; k++) {
+    sv[k / STATESPACE_STATE_LANES][k % STATESPACE_STATE_LANES] =
+      k % 2 == 0 ? psCascade->state[k / 2].s1 : psCascade->state[k / 2].s2;
+  }
+  // FILTER PROCESSING, STATESPACE_BLOCKSIZE samples per step ///////////////
+  for (lBlock = 0; lBlock < lBlocks; lBlock++) {
+    memcpy(xn, pfInput, sizeof(xn));
+    yv = (StateSpaceOutputVector){ 0 };
+    for (v = 0; v < Vectors; v++) {
+      nv[v] = (StateSpaceStateVector){ 0 };
+    }
+    for (k = 0; k < Order; k++) {
+      s = sv[k / STATESPACE_STATE_LANES][k % STATESPACE_STATE_LANES];
+      yv += psStateSpace->state2output[k] * (float)s;
+      for (v = 0; v < Vectors; v++) {
+        nv[v] += psStateSpace->state2state[k][v] * s;
+      }
+    }
+    for (i = 0; i < STATESPACE_BLOCKSIZE; i++) {
+      yv += psStateSpace->input2output[i] * xn[i];
+      for (v = 0; v < Vectors; v++) {
+        nv[v] += psStateSpace->input2state[i][v] * (double)xn[i];
+      }
+    }
+    for (v = 0; v < Vectors; v++) {
+      sv[v] = nv[v];
+    }
+    if (Metering) {
+      for (j = 0; j < STATESPACE_BLOCKSIZE; j++) {
+        fAbs = fabsf(xn[j]);
+        fInPeak = fAbs > fInPeak ? fAbs : fInPeak;
+        fInSquares += xn[j] * xn[j];
+        lInClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+        fAbs = fabsf(yv[j]);
+        fOutPeak = fAbs > fOutPeak ? fAbs : fOutPeak;
+        fOutSquares += yv[j] * yv[j];
+        lOutClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+      }
+    }
+    if (Adding) {
+      yv *= fRunAddingGain;
+    }
+    for (j = 0; j < STATESPACE_BLOCKSIZE; j++) {
+      if (Adding) {
+        pfOutput[j] += yv[j];
+      } else {
+        pfOutput[j] = yv[j];
+      }
+    }
+    pfInput += STATESPACE_BLOCKSIZE;
+    pfOutput += STATESPACE_BLOCKSIZE;
+  }
+  if (Metering) {
+    MeterAccumulator * m = psCascade->meter;
+    m->inPeak = fInPeak > m->inPeak ? fInPeak : m->inPeak;
+    m->outPeak = fOutPeak > m->outPeak ? fOutPeak : m->outPeak;
+    m->inSquares += fInSquares;
+    m->outSquares += fOutSquares;
+    m->samples += lBlocks * STATESPACE_BLOCKSIZE;
+    m->inClips += lInClips;
+    m->outClips += lOutClips;
+  }
+  // store state in cascade for later
+  for (k = 0; k < Order; k++) {
+    s = flushBiquadState(sv[k / STATESPACE_STATE_LANES][k % STATESPACE_STATE_LANES]);
+    if (k % 2 == 0) {
+      psCascade->state[k / 2].s1 = s;
+    } else {
+      psCascade->state[k / 2].s2 = s;
+    }
+  }
+  return lBlocks * STATESPACE_BLOCKSIZE;
+}
+
+/* Run SampleCount samples through the first SectionCount sections of
+   psCascade, with the block kernel if the run is long enough and no ramp
+   is running, else with the per-sample kernel, which also takes the
+   samples after the last whole block. Adding selects the run_adding
+   flavour, see runBiquadCascadeMode(). With Unity the gain factor is
+   folded into the coefficients, the per-sample kernel then doesn't apply
+   it, see runUnityBiquadCascadeMode(). */
+CASCADE_KERNEL void runStateSpaceCascadeMode(StateSpaceCascade * psStateSpace,
+                                            BiquadCascade * psCascade,
+                                            const int SectionCount,
+                                            const LADSPA_Data * pfInput,
+                                            LADSPA_Data * pfOutput,
+                                            unsigned long SampleCount,
+                                            const int Adding,
+                                            float fRunAddingGain,
+                                            const int Unity) {
+  unsigned long lDone;
+  if (SampleCount >= STATESPACE_MIN_SAMPLES &&
+      SectionCount <= STATESPACE_MAX_SECTIONS &&
+      psCascade->rampSteps == 0) {
+    if (!psStateSpace->valid) {
+      buildStateSpaceCascade(psStateSpace, psCascade, SectionCount);
+    }
+#if MMAP_METERING
+    if (psCascade->meter != NULL) {
+      lDone = runStateSpaceCascadeBlocks(psStateSpace, psCascade, SectionCount, pfInput, pfOutput,
+                                         SampleCount, Adding, fRunAddingGain, 1);
+    } else {
+      lDone = runStateSpaceCascadeBlocks(psStateSpace, psCascade, SectionCount, pfInput, pfOutput,
+                                         SampleCount, Adding, fRunAddingGain, 0);
+    }
+#else
+    lDone = runStateSpaceCascadeBlocks(psStateSpace, psCascade, SectionCount, pfInput, pfOutput,
+                                       SampleCount, Adding, fRunAddingGain, 0);
+#endif
+    SampleCount -= lDone;
+    pfInput += lDone;
+    pfOutput += lDone;
+  }
+  if (Unity) {
+    runUnityBiquadCascadeMode(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                              Adding, fRunAddingGain);
+  } else {
+    runBiquadCascadeMode(psCascade, SectionCount, pfInput, pfOutput, SampleCount,
+                         Adding, fRunAddingGain);
+  }
+}
+
+/* EOF */
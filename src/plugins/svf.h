@@ -0,0 +1,288 @@
+/* svf.h
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   State variable filter discretized with the trapezoidal rule (topology
+   preserving transform, the form of A. Simper's "SvfLinearTrapOptimised2").
+   Low- and highpass, peaking EQ and both shelves are mixes of the input
+   and the band- and lowpass outputs of the same two integrators:
+
+     g = tan(pi f / samplerate)       warped cutoff
+     k = 1 / Q                        damping
+     y = m0 * input + m1 * bandpass + m2 * lowpass
+
+   The responses are the ones of the RBJ cookbook biquads, both use the
+   same prewarped bilinear transform.
+
+   Unlike the biquads of cascade.h the state are the two integrator
+   outputs, which keep their meaning when g, k or the mix change. Every set
+   of coefficients with g > 0 and k > 0 is a stable filter, so they may
+   change at every sample without the filter blowing up or clicking the
+   way a direct form biquad does. A ramp towards new coefficients moves g
+   by a constant factor per sample (the cutoff glides logarithmically) and
+   k and the mix linearly. A sample of a running ramp costs one multiply,
+   four adds and one division more than a sample at fixed coefficients,
+   the trig and pow() calls of a recalculation happen only once per ramp.
+
+   The state is flushed with flushBiquadState() after each block, so
+   cascade.h has to be included before this file.
+
+*/
+
+//#include "helpers.h"
+//#include "cascade.h"
+
+/*****************************************************************************/
+
+#define SVF_LOWPASS    0
+#define SVF_HIGHPASS   1
+#define SVF_PEAKING    2
+#define SVF_LOW_SHELF  3
+#define SVF_HIGH_SHELF 4
+
+// cutoffs are kept between these fractions of the sample rate, where g is
+// finite and positive
+#define SVF_MIN_F      1e-6
+#define SVF_MAX_F      0.4999
+
+/* coefficients of the state variable filter, see above */
+typedef struct {
+
+  double g;
+  double k;
+  double m0;
+  double m1;
+  double m2;
+
+} SvfCoeffs;
+
+/* coefficients and state of one state variable filter */
+typedef struct {
+
+  // coefficients currently in use
+  SvfCoeffs coeffs;
+  // coefficients set by the plugin, reached at the end of a ramp
+  SvfCoeffs target;
+  // per sample factor of g and increments of k and the mix of a ramp
+  double gRatio;
+  SvfCoeffs delta;
+  // samples left in the running ramp
+  unsigned long rampSamples;
+  // 0 until the first coefficients were applied after reset
+  int hasCoeffs;
+  // integrator states
+  double ic1eq;
+  double ic2eq;
+  // levels of input and output are summed up here, null for no metering
+  MeterAccumulator * meter;
+
+} SvfFilter;
+
+/*****************************************************************************/
+
+/* Coefficients of a filter of the given type. For the peaking EQ and the
+   shelves g is their gain in dB, for low- and highpass it is ignored.
+   fGainFactor scales the output and is folded into the mix. */
+static inline SvfCoeffs calcSvfCoeffs(int type, float f, float g, float q,
+                                      float fGainFactor, float samplerate) {
+  SvfCoeffs coeffs;
+  double A = pow(10, g / 40.0);
+  double fRatio = f / samplerate;
+  fRatio = fRatio > SVF_MIN_F ? fRatio : SVF_MIN_F;
+  fRatio = fRatio < SVF_MAX_F ? fRatio : SVF_MAX_F;
+  coeffs.g = tan(M_PI * fRatio);
+  coeffs.k = 1.0 / q;
+  switch (type) {
+  case SVF_LOWPASS:
+    coeffs.m0 = 0;
+    coeffs.m1 = 0;
+    coeffs.m2 = 1;
+    break;
+  case SVF_HIGHPASS:
+    coeffs.m0 = 1;
+    coeffs.m1 = -coeffs.k;
+    coeffs.m2 = -1;
+    break;
+  case SVF_PEAKING:
+    coeffs.k = 1.0 / (q * A);
+    coeffs.m0 = 1;
+    coeffs.m1 = coeffs.k * (A * A - 1);
+    coeffs.m2 = 0;
+    break;
+  case SVF_LOW_SHELF:
+    coeffs.g /= sqrt(A);
+    coeffs.m0 = 1;
+    coeffs.m1 = coeffs.k * (A - 1);
+    coeffs.m2 = A * A - 1;
+    break;
+  case SVF_HIGH_SHELF:
+    coeffs.g *= sqrt(A);
+    coeffs.m0 = A * A;
+    coeffs.m1 = coeffs.k * (1 - A) * A;
+    coeffs.m2 = 1 - A * A;
+    break;
+  }
+  coeffs.m0 *= fGainFactor;
+  coeffs.m1 *= fGainFactor;
+  coeffs.m2 *= fGainFactor;
+  return coeffs;
+}
+
+/* Prepare a new filter, called once when a plugin is instantiated. */
+static inline void initSvfFilter(SvfFilter * psFilter) {
+  psFilter->meter = NULL;
+}
+
+/* Reset the state. The first coefficients set after a reset are always
+   applied without a ramp. */
+static inline void resetSvfFilter(SvfFilter * psFilter) {
+  psFilter->ic1eq = 0;
+  psFilter->ic2eq = 0;
+  psFilter->rampSamples = 0;
+  psFilter->hasCoeffs = 0;
+}
+
+/* Move towards psFilter->target within RampSamples samples, or apply it at
+   once if RampSamples is 0 or there are no coefficients yet. A running
+   ramp continues from where it is. */
+static inline void startSvfRamp(SvfFilter * psFilter, unsigned long RampSamples) {
+  SvfCoeffs * c = &psFilter->coeffs;
+  SvfCoeffs * t = &psFilter->target;
+  if (RampSamples == 0 || !psFilter->hasCoeffs) {
+    *c = *t;
+    psFilter->rampSamples = 0;
+    psFilter->hasCoeffs = 1;
+    return;
+  }
+  psFilter->gRatio = pow(t->g / c->g, 1.0 / RampSamples);
+  psFilter->delta.k = (t->k - c->k) / RampSamples;
+  psFilter->delta.m0 = (t->m0 - c->m0) / RampSamples;
+  psFilter->delta.m1 = (t->m1 - c->m1) / RampSamples;
+  psFilter->delta.m2 = (t->m2 - c->m2) / RampSamples;
+  psFilter->rampSamples = RampSamples;
+}
+
+/* Run SampleCount samples through the filter. With Ramping (a compile time
+   constant at every call site) the coefficients move one step per sample,
+   otherwise they are fixed for the block. Adding and Metering select the
+   kernel flavour like runBiquadCascadeBlock() does. pfInput and pfOutput
+   may point to the same buffer. */
+static inline void runSvfBlock(SvfFilter * psFilter,
+                               const LADSPA_Data * pfInput,
+                               LADSPA_Data * pfOutput,
+                               unsigned long SampleCount,
+                               const int Ramping,
+                               const int Adding,
+                               float fRunAddingGain,
+                               const int Metering) {
+  SvfCoeffs c = psFilter->coeffs;
+  SvfCoeffs d = psFilter->delta;
+  double gRatio = psFilter->gRatio;
+  double ic1eq = psFilter->ic1eq, ic2eq = psFilter->ic2eq;
+  double a1, a2, a3, v0, v1, v2, v3;
+  unsigned long lSampleIndex;
+  float yn;
+  float fAbs, fInPeak = 0, fOutPeak = 0, fInSquares = 0, fOutSquares = 0;
+  unsigned long lInClips = 0, lOutClips = 0;
+  a1 = 1 / (1 + c.g * (c.g + c.k));
+  a2 = c.g * a1;
+  a3 = c.g * a2;
+  for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
+    if (Ramping) {
+      c.g *= gRatio;
+      c.k += d.k;
+      c.m0 += d.m0;
+      c.m1 += d.m1;
+      c.m2 += d.m2;
+      a1 = 1 / (1 + c.g * (c.g + c.k));
+      a2 = c.g * a1;
+      a3 = c.g * a2;
+    }
+    v0 = pfInput[lSampleIndex];
+    if (Metering) {
+      fAbs = fabsf(v0);
+      fInPeak = fAbs > fInPeak ? fAbs : fInPeak;
+      fInSquares += v0 * v0;
+      lInClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    v3 = v0 - ic2eq;
+    v1 = a1 * ic1eq + a2 * v3;
+    v2 = ic2eq + a2 * ic1eq + a3 * v3;
+    ic1eq = 2 * v1 - ic1eq;
+    ic2eq = 2 * v2 - ic2eq;
+    yn = c.m0 * v0 + c.m1 * v1 + c.m2 * v2;
+    if (Metering) {
+      fAbs = fabsf(yn);
+      fOutPeak = fAbs > fOutPeak ? fAbs : fOutPeak;
+      fOutSquares += yn * yn;
+      lOutClips += fAbs >= MMAP_METER_CLIP_LEVEL;
+    }
+    if (Adding) {
+      pfOutput[lSampleIndex] += yn * fRunAddingGain;
+    } else {
+      pfOutput[lSampleIndex] = yn;
+    }
+  }
+  if (Metering) {
+    MeterAccumulator * m = psFilter->meter;
+    m->inPeak = fInPeak > m->inPeak ? fInPeak : m->inPeak;
+    m->outPeak = fOutPeak > m->outPeak ? fOutPeak : m->outPeak;
+    m->inSquares += fInSquares;
+    m->outSquares += fOutSquares;
+    m->samples += SampleCount;
+    m->inClips += lInClips;
+    m->outClips += lOutClips;
+  }
+  psFilter->coeffs = c;
+  psFilter->ic1eq = flushBiquadState(ic1eq);
+  psFilter->ic2eq = flushBiquadState(ic2eq);
+}
+
+/* Run SampleCount samples through the filter, the rest of a running ramp
+   sample by sample and everything behind it with fixed coefficients. */
+static inline void runSvfRamp(SvfFilter * psFilter,
+                              const LADSPA_Data * pfInput,
+                              LADSPA_Data * pfOutput,
+                              unsigned long SampleCount,
+                              const int Adding,
+                              float fRunAddingGain,
+                              const int Metering) {
+  unsigned long lBlockSize;
+  if (psFilter->rampSamples > 0) {
+    lBlockSize = SampleCount < psFilter->rampSamples ? SampleCount : psFilter->rampSamples;
+    runSvfBlock(psFilter, pfInput, pfOutput, lBlockSize, 1, Adding, fRunAddingGain, Metering);
+    psFilter->rampSamples -= lBlockSize;
+    if (psFilter->rampSamples == 0) {
+      // land exactly on the target, without the rounding of the steps
+      psFilter->coeffs = psFilter->target;
+    }
+    SampleCount -= lBlockSize;
+    pfInput += lBlockSize;
+    pfOutput += lBlockSize;
+  }
+  if (SampleCount > 0) {
+    runSvfBlock(psFilter, pfInput, pfOutput, SampleCount, 0, Adding, fRunAddingGain, Metering);
+  }
+}
+
+/* Run SampleCount samples through the filter, with or without metering
+   depending on psFilter->meter. Adding selects the kernel flavour. */
+static inline void runSvfMode(SvfFilter * psFilter,
+                              const LADSPA_Data * pfInput,
+                              LADSPA_Data * pfOutput,
+                              unsigned long SampleCount,
+                              const int Adding,
+                              float fRunAddingGain) {
+#if MMAP_METERING
+  if (psFilter->meter != NULL) {
+    runSvfRamp(psFilter, pfInput, pfOutput, SampleCount, Adding, fRunAddingGain, 1);
+    return;
+  }
+#endif
+  runSvfRamp(psFilter, pfInput, pfOutput, SampleCount, Adding, fRunAddingGain, 0);
+}
+
+/*****************************************************************************/
+
+/* EOF */
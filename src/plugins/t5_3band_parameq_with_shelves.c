@@ -21,8 +21,18 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
 #include <ladspa.h>
 #include "helpers.h"
+#include "design.h"
+#include "coeffs.h"
+#include "cascade.h"
+#include "parallel.h"
+#include "statespace.h"
+#include "plan.h"
+#include "presets.h"
+#include "descriptors.h"
 
 /*****************************************************************************/
 
@@ -45,7 +55,22 @@
 #define SF_HIGH_Q     16
 #define SF_GAIN       17
 #define SF_MMAPFNAME  18
-#define PORTCOUNT     19
+#define SF_SMOOTHING  19
+#define PORTCOUNT     20
+// 3band_parameq_with_shelves keeps the ports it was published with, the
+// smoothing time is only a port of 3band_parameq_with_shelves_smooth
+#define PORTCOUNT_UNSMOOTHED SF_SMOOTHING
+
+// biquad sections in processing order
+#define SECTION_LOW    0
+#define SECTION_P1     1
+#define SECTION_P2     2
+#define SECTION_P3     3
+#define SECTION_HIGH   4
+#define SECTIONCOUNT   5
+
+// parameters in the mmap area: LOW_F .. GAIN
+#define MMAP_PARAMCOUNT 16
 
 /*****************************************************************************/
 
@@ -55,31 +80,35 @@ typedef struct {
     long m_created_ns;
     time_t m_created_s;
 
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
     LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+    MmapMeterBlock * m_meterBlock;
+    MeterAccumulator m_meter;
+    // precomputed coefficients of presets recalled through the mmap area
+    PresetBank m_bank;
 
     LADSPA_Data m_fSampleRate;
-    // previous input samples of biquad filters
-    LADSPA_Data m_fxnm1_LOW;
-    LADSPA_Data m_fxnm2_LOW;
-    LADSPA_Data m_fxnm1_P1;
-    LADSPA_Data m_fxnm2_P1;
-    LADSPA_Data m_fxnm1_P2;
-    LADSPA_Data m_fxnm2_P2;
-    LADSPA_Data m_fxnm1_P3;
-    LADSPA_Data m_fxnm2_P3;
-    LADSPA_Data m_fxnm1_HIGH;
-    LADSPA_Data m_fxnm2_HIGH;
-    // previous output samples of biquad filters
-    LADSPA_Data m_fynm1_LOW;
-    LADSPA_Data m_fynm2_LOW;
-    LADSPA_Data m_fynm1_P1;
-    LADSPA_Data m_fynm2_P1;
-    LADSPA_Data m_fynm1_P2;
-    LADSPA_Data m_fynm2_P2;
-    LADSPA_Data m_fynm1_P3;
-    LADSPA_Data m_fynm2_P3;
-    LADSPA_Data m_fynm1_HIGH;
-    LADSPA_Data m_fynm2_HIGH;
+    // coefficients and previous samples of all biquad filters
+    BiquadCascade m_cascade;
+    // the sections that aren't flat, with the gain folded in
+    BiquadPlan m_plan;
+    // the compiled sections expanded into parallel branches
+    ParallelBiquads m_parallel;
+    // their expansion by the worker thread
+    ParallelJob m_parallelJob;
+    // block matrices for long runs if there is no parallel form
+    StateSpaceCascade m_statespace;
+    // parameters the coefficients and gain factor were calculated for
+    BiquadParams m_params[SECTIONCOUNT];
+    LADSPA_Data m_fGain;
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
     // port pointers
     LADSPA_Data * m_pfInput;
     LADSPA_Data * m_pfOutput;
@@ -100,61 +129,27 @@ typedef struct {
     LADSPA_Data * m_pfHighQ;
     LADSPA_Data * m_pfGain;
     LADSPA_Data * m_pfMmapFname;
+    LADSPA_Data * m_pfSmoothing;
 
 } ThreeBandParametricEqWithShelves;
 
 /* Helpers... ****************************************************************/
 
-BiquadCoeffs calcCoeffsLowShelf(float f, float g, float q, float samplerate) {
-    BiquadCoeffs coeffs;
-    float w0 = 2.0 * M_PI * f / samplerate;
-    float alpha = sin(w0) / (2.0 * q);
-    float A = pow(10, g / 40.0);
-    float cs = cos(w0);
-    float norm = 1 / ((A+1.0) + (A-1.0)*cs + 2.0*sqrt(A)*alpha);
-    coeffs.b0 = norm * (    A*( (A+1.0) - (A-1.0)*cs + 2.0*sqrt(A)*alpha ));
-    coeffs.b1 = norm * (2.0*A*( (A-1.0) - (A+1.0)*cs                     ));
-    coeffs.b2 = norm * (    A*( (A+1.0) - (A-1.0)*cs - 2.0*sqrt(A)*alpha ));
-    coeffs.a1 = norm * ( -2.0*( (A-1.0) + (A+1.0)*cs                     ));
-    coeffs.a2 = norm * (        (A+1.0) + (A-1.0)*cs - 2.0*sqrt(A)*alpha);
-    return coeffs;
-}
-
-BiquadCoeffs calcCoeffsPeaking(float f, float g, float q, float samplerate) {
-    BiquadCoeffs coeffs;
-    float w0 = 2.0 * M_PI * f / samplerate;
-    float alpha = sin(w0) / (2.0 * q);
-    float A = pow(10, g / 40.0);
-    float cs = cos(w0);
-    float norm = 1 / (1.0 + alpha / A);
-    coeffs.b0 = norm * (1.0 + alpha * A);
-    coeffs.b1 = norm * (-2.0 * cs);
-    coeffs.b2 = norm * (1.0 - alpha * A);
-    coeffs.a1 = norm * (-2.0 * cs);
-    coeffs.a2 = norm * (1.0 - alpha / A);
-    return coeffs;
-}
-
-BiquadCoeffs calcCoeffsHighShelf(float f, float g, float q, float samplerate) {
-    BiquadCoeffs coeffs;
-    float w0 = 2.0 * M_PI * f / samplerate;
-    float alpha = sin(w0) / (2.0 * q);
-    float A = pow(10, g / 40.0);
-    float cs = cos(w0);
-    float norm = 1 / ((A+1.0) - (A-1.0)*cs + 2.0*sqrt(A)*alpha);
-    coeffs.b0 = norm * (     A*( (A+1.0) + (A-1.0)*cos(w0) + 2.0*sqrt(A)*alpha ));
-    coeffs.b1 = norm * (-2.0*A*( (A-1.0) + (A+1.0)*cos(w0)                     ));
-    coeffs.b2 = norm * (     A*( (A+1.0) + (A-1.0)*cos(w0) - 2.0*sqrt(A)*alpha ));
-    coeffs.a1 = norm * (   2.0*( (A-1.0) - (A+1.0)*cos(w0)                     ));
-    coeffs.a2 = norm * (         (A+1.0) - (A-1.0)*cos(w0) - 2.0*sqrt(A)*alpha);
-    return coeffs;
-}
-
 void setupMmapFileForThreeBandParametricEqWithShelves(ThreeBandParametricEqWithShelves * psInstance) {
     // setup shared memory area to enable parametrization at runtime from external processes
     TimeMmapStruct ret;
-    ret = setupMmapFile("3BandParamEqWithShelves", *(psInstance->m_pfMmapFname), PORTCOUNT); 
+    ret = setupMmapFile(&psInstance->m_slot, "3BandParamEqWithShelves", *(psInstance->m_pfMmapFname), MMAP_PARAMCOUNT);
     psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    // meter input and output levels in the filter loop
+    psInstance->m_meterBlock = ret.meter;
+    if (ret.meter != NULL) {
+        resetMeterAccumulator(&psInstance->m_meter);
+        psInstance->m_cascade.meter = &psInstance->m_meter;
+        psInstance->m_plan.compiled.meter = &psInstance->m_meter;
+    }
     psInstance->m_created_s = ret.s;
     psInstance->m_created_ns = ret.ns;
 }
@@ -168,7 +163,23 @@ LADSPA_Handle instantiateThreeBandParametricEqWithShelves(const LADSPA_Descripto
     psInstance = (ThreeBandParametricEqWithShelves *)malloc(sizeof(ThreeBandParametricEqWithShelves));
     if (psInstance) {
         psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_slot = NULL;
         psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_meterBlock = NULL;
+        psInstance->m_pfSmoothing = NULL;
+        initPresetBank(&psInstance->m_bank,
+                       "3BandParamEqWithShelves",
+                       MMAP_PARAMCOUNT,
+                       SECTIONCOUNT,
+                       psInstance->m_fSampleRate);
+        initBiquadCascade(&psInstance->m_cascade);
+        initBiquadCascade(&psInstance->m_plan.compiled);
+        registerParallelJob(&psInstance->m_parallelJob);
+        psInstance->m_fRunAddingGain = 1.0;
     }  
     return psInstance;
 }
@@ -178,27 +189,16 @@ LADSPA_Handle instantiateThreeBandParametricEqWithShelves(const LADSPA_Descripto
 /* Initialise and activate a plugin instance. */
 void activateThreeBandParametricEqWithShelves(LADSPA_Handle Instance) {
     ThreeBandParametricEqWithShelves * psInstance;
+    int iSection;
     psInstance = (ThreeBandParametricEqWithShelves *)Instance;
-    psInstance->m_fxnm1_LOW = 0;
-    psInstance->m_fxnm2_LOW = 0;
-    psInstance->m_fynm1_LOW = 0;
-    psInstance->m_fynm2_LOW = 0;
-    psInstance->m_fxnm1_P1 = 0;
-    psInstance->m_fxnm2_P1 = 0;
-    psInstance->m_fynm1_P1 = 0;
-    psInstance->m_fynm2_P1 = 0;
-    psInstance->m_fxnm1_P2 = 0;
-    psInstance->m_fxnm2_P2 = 0;
-    psInstance->m_fynm1_P2 = 0;
-    psInstance->m_fynm2_P2 = 0;
-    psInstance->m_fxnm1_P3 = 0;
-    psInstance->m_fxnm2_P3 = 0;
-    psInstance->m_fynm1_P3 = 0;
-    psInstance->m_fynm2_P3 = 0;
-    psInstance->m_fxnm1_HIGH = 0;
-    psInstance->m_fxnm2_HIGH = 0;
-    psInstance->m_fynm1_HIGH = 0;
-    psInstance->m_fynm2_HIGH = 0;
+    resetBiquadCascade(&psInstance->m_cascade, SECTIONCOUNT);
+    resetBiquadPlan(&psInstance->m_plan);
+    resetParallelBiquads(&psInstance->m_parallel);
+    invalidateStateSpaceCascade(&psInstance->m_statespace);
+    for (iSection = 0; iSection < SECTIONCOUNT; iSection++) {
+        invalidateBiquadParams(&psInstance->m_params[iSection]);
+    }
+    psInstance->m_fGain = NAN;
 }
 
 /*****************************************************************************/
@@ -269,214 +269,248 @@ void connectPortToThreeBandParametricEqWithShelves(LADSPA_Handle Instance,
     case SF_MMAPFNAME:
         psInstance->m_pfMmapFname = DataLocation;
         break;
+    case SF_SMOOTHING:
+        psInstance->m_pfSmoothing = DataLocation;
+        break;
     }
 }
 
 /*****************************************************************************/
 
-/* Run the filter algorithm for a block of SampleCount samples. */
-void runThreeBandParametricEqWithShelves(LADSPA_Handle Instance,
-                                         unsigned long SampleCount) {
+/* Run the SectionCount sections of the plan, in parallel form if there is
+   a usable one, else in blocks. SectionCount is meant to be a compile
+   time constant. */
+CASCADE_KERNEL void runThreeBandParametricEqWithShelvesPlan(ThreeBandParametricEqWithShelves * psInstance,
+                                                           const int SectionCount,
+                                                           unsigned long SampleCount,
+                                                           const int Adding) {
+    if (SectionCount == 0) {
+        // nothing left but the gain factor, which may be 1
+        if (psInstance->m_plan.compiled.gainFactor == 1.0) {
+            runUnityBiquadCascadeMode(&psInstance->m_plan.compiled,
+                                      0,
+                                      psInstance->m_pfInput,
+                                      psInstance->m_pfOutput,
+                                      SampleCount,
+                                      Adding,
+                                      psInstance->m_fRunAddingGain);
+        } else {
+            runBiquadCascadeMode(&psInstance->m_plan.compiled,
+                                 0,
+                                 psInstance->m_pfInput,
+                                 psInstance->m_pfOutput,
+                                 SampleCount,
+                                 Adding,
+                                 psInstance->m_fRunAddingGain);
+        }
+    } else if (psInstance->m_parallel.valid) {
+        runParallelBiquadsMode(&psInstance->m_parallel,
+                               &psInstance->m_plan.compiled,
+                               SectionCount,
+                               psInstance->m_pfInput,
+                               psInstance->m_pfOutput,
+                               SampleCount,
+                               Adding,
+                               psInstance->m_fRunAddingGain);
+    } else {
+        runStateSpaceCascadeMode(&psInstance->m_statespace,
+                                 &psInstance->m_plan.compiled,
+                                 SectionCount,
+                                 psInstance->m_pfInput,
+                                 psInstance->m_pfOutput,
+                                 SampleCount,
+                                 Adding,
+                                 psInstance->m_fRunAddingGain,
+                                 psInstance->m_plan.compiled.gainFactor == 1.0);
+    }
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. With Adding
+   the result is added to the output buffer (run_adding). */
+CASCADE_KERNEL void runThreeBandParametricEqWithShelvesMode(LADSPA_Handle Instance,
+                                                           unsigned long SampleCount,
+                                                           const int Adding) {
 
-    LADSPA_Data * pfInput;
-    LADSPA_Data * pfOutput;
-    ThreeBandParametricEqWithShelves * psInstance;
-    BiquadCoeffs coeffs_LOW, coeffs_P1, coeffs_P2, coeffs_P3, coeffs_HIGH;
-    unsigned long lSampleIndex;
-    LADSPA_Data unchanged = 0.0;
-    LADSPA_Data changed;
-    LADSPA_Data * mmptr;
-    float fGainFactor;
-    float xn, yn; // xn/yn holds currently processed input/output samples.
-    float xnm1, xnm2, ynm1, ynm2; // holds previously processed input/output samples.
     // get ThreeBandParametricEqWithShelves Instance
-    psInstance = (ThreeBandParametricEqWithShelves *)Instance;
-    // get input and output buffers
-    pfInput = psInstance->m_pfInput;
-    pfOutput = psInstance->m_pfOutput;
-    // memcpy parameters over from mmapped area
-    mmptr = psInstance->m_mmapArea;
-    if (mmptr != NULL) {
-        memcpy(&changed, mmptr, sizeof(LADSPA_Data));
-        if (changed != 0.0) {
-            mmptr += 1;
-            memcpy(psInstance->m_pfLowF, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfLowG, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfLowQ, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP1F, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP1G, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP1Q, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP2F, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP2G, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP2Q, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP3F, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP3G, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfP3Q, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfHighF, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfHighG, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfHighQ, mmptr, sizeof(LADSPA_Data));
-            mmptr += 1;
-            memcpy(psInstance->m_pfGain, mmptr, sizeof(LADSPA_Data));
+    ThreeBandParametricEqWithShelves * psInstance = (ThreeBandParametricEqWithShelves *)Instance;
+    // frequency, gain and Q of every section, lowest first
+    LADSPA_Data * ppfControls[SECTIONCOUNT][3] = {
+        [SECTION_LOW] = { psInstance->m_pfLowF, psInstance->m_pfLowG, psInstance->m_pfLowQ },
+        [SECTION_P1] = { psInstance->m_pfP1F, psInstance->m_pfP1G, psInstance->m_pfP1Q },
+        [SECTION_P2] = { psInstance->m_pfP2F, psInstance->m_pfP2G, psInstance->m_pfP2Q },
+        [SECTION_P3] = { psInstance->m_pfP3F, psInstance->m_pfP3G, psInstance->m_pfP3Q },
+        [SECTION_HIGH] = { psInstance->m_pfHighF, psInstance->m_pfHighG, psInstance->m_pfHighQ }
+    };
+    BiquadCoeffs * coeffs;
+    BiquadParams * params;
+    BiquadDesign designs[SECTIONCOUNT];
+    BiquadCoeffs designed[SECTIONCOUNT];
+    int designedSection[SECTIONCOUNT];
+    int designCount = 0;
+    int iSection, iDesign;
+    LADSPA_Data f, g, q;
+    int changed_coeffs = 0;
+    int changed_mmap = 0;
+    int changed_preset = 0;
+    unsigned long fpuMode;
+    uint64_t startCycles;
+    LADSPA_Data mmapParams[MMAP_PARAMCOUNT];
+    startCycles = startMmapTelemetry(psInstance->m_telemetry);
+    coeffs = psInstance->m_cascade.target;
+    params = psInstance->m_params;
+    // copy parameters over from mmapped area, a scene or a recalled preset
+    // with precomputed coefficients
+    if (psInstance->m_mmapArea != NULL) {
+        changed_preset = readPresetBank(&psInstance->m_bank,
+                                        psInstance->m_mmapParams,
+                                        mmapParams,
+                                        coeffs,
+                                        &psInstance->m_cascade.targetGainFactor);
+        if (changed_preset ||
+            readMmapScene(psInstance->m_slot,
+                          mmapParams,
+                          MMAP_PARAMCOUNT,
+                          SampleCount,
+                          psInstance->m_fSampleRate) ||
+            readMmapParams(psInstance->m_mmapArea,
+                           psInstance->m_mmapParams,
+                           &psInstance->m_mmapSequence,
+                           mmapParams,
+                           MMAP_PARAMCOUNT)) {
+            changed_mmap = 1;
+            *(psInstance->m_pfLowF) = mmapParams[0];
+            *(psInstance->m_pfLowG) = mmapParams[1];
+            *(psInstance->m_pfLowQ) = mmapParams[2];
+            *(psInstance->m_pfP1F) = mmapParams[3];
+            *(psInstance->m_pfP1G) = mmapParams[4];
+            *(psInstance->m_pfP1Q) = mmapParams[5];
+            *(psInstance->m_pfP2F) = mmapParams[6];
+            *(psInstance->m_pfP2G) = mmapParams[7];
+            *(psInstance->m_pfP2Q) = mmapParams[8];
+            *(psInstance->m_pfP3F) = mmapParams[9];
+            *(psInstance->m_pfP3G) = mmapParams[10];
+            *(psInstance->m_pfP3Q) = mmapParams[11];
+            *(psInstance->m_pfHighF) = mmapParams[12];
+            *(psInstance->m_pfHighG) = mmapParams[13];
+            *(psInstance->m_pfHighQ) = mmapParams[14];
+            *(psInstance->m_pfGain) = mmapParams[15];
+        }
+        if (changed_preset) {
+            // the recalled coefficients belong to these parameters
+            primeParamEqBiquadParams(params, SECTIONCOUNT, mmapParams, psInstance->m_fSampleRate);
+            psInstance->m_fGain = mmapParams[15];
+            changed_coeffs = 1;
         }
-        // reset changed flag to re-enable parametrization by control inputs
-        memcpy(psInstance->m_mmapArea, &unchanged, sizeof(LADSPA_Data));
-    } else if (*(psInstance->m_pfMmapFname) != 0.0) {
+    } else if (wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
         setupMmapFileForThreeBandParametricEqWithShelves(psInstance);
     }
-    // calculate coeffs and gain factor
-    coeffs_LOW = calcCoeffsLowShelf(*(psInstance->m_pfLowF),
-                                    *(psInstance->m_pfLowG),
-                                    *(psInstance->m_pfLowQ),
-                                    psInstance->m_fSampleRate);
-    coeffs_P1 = calcCoeffsPeaking(*(psInstance->m_pfP1F),
-                                  *(psInstance->m_pfP1G),
-                                  *(psInstance->m_pfP1Q),
-                                  psInstance->m_fSampleRate);
-    coeffs_P2 = calcCoeffsPeaking(*(psInstance->m_pfP2F),
-                                  *(psInstance->m_pfP2G),
-                                  *(psInstance->m_pfP2Q),
-                                  psInstance->m_fSampleRate);
-    coeffs_P3 = calcCoeffsPeaking(*(psInstance->m_pfP3F),
-                                  *(psInstance->m_pfP3G),
-                                  *(psInstance->m_pfP3Q),
-                                  psInstance->m_fSampleRate);
-    coeffs_HIGH = calcCoeffsHighShelf(*(psInstance->m_pfHighF),
-                                      *(psInstance->m_pfHighG),
-                                      *(psInstance->m_pfHighQ),
-                                      psInstance->m_fSampleRate);
-    fGainFactor = dbToGainFactor(*(psInstance->m_pfGain));
-    // FILTER PROCESSING FOR LOW SHELF EQ ///////////////////////////////////////
-    // get preciosuly processed samples
-    xnm1 = psInstance->m_fxnm1_LOW;
-    xnm2 = psInstance->m_fxnm2_LOW;
-    ynm1 = psInstance->m_fynm1_LOW;
-    ynm2 = psInstance->m_fynm2_LOW;
-    // apply biquad calculation to buffers
-    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
-        xn = *(pfInput++);
-        yn = (coeffs_LOW.b0 * xn   + coeffs_LOW.b1 * xnm1 + coeffs_LOW.b2 * xnm2 - 
-              coeffs_LOW.a1 * ynm1 - coeffs_LOW.a2 * ynm2);
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-        *(pfOutput++) = yn;
+    // calculate coeffs and gain factor, but only if their inputs changed
+    for (iSection = 0; iSection < SECTIONCOUNT; iSection++) {
+        f = *(ppfControls[iSection][0]);
+        g = *(ppfControls[iSection][1]);
+        q = *(ppfControls[iSection][2]);
+        if (updateBiquadParams(&params[iSection], f, g, q, psInstance->m_fSampleRate)) {
+            designs[designCount].type = designTypeParamEqWithShelves(iSection, SECTIONCOUNT);
+            designs[designCount].f = f;
+            designs[designCount].g = g;
+            designs[designCount].q = q;
+            designedSection[designCount++] = iSection;
+        }
+    }
+    // all changed sections in one go
+    if (designCount > 0) {
+        designBiquadSections(designs, designCount, psInstance->m_fSampleRate, designed);
+        for (iDesign = 0; iDesign < designCount; iDesign++) {
+            coeffs[designedSection[iDesign]] = designed[iDesign];
+        }
+        changed_coeffs = 1;
+    }
+    if (*(psInstance->m_pfGain) != psInstance->m_fGain) {
+        psInstance->m_fGain = *(psInstance->m_pfGain);
+        psInstance->m_cascade.targetGainFactor = dbToGainFactor(psInstance->m_fGain);
+        changed_coeffs = 1;
     }
-    // store preciously calculated samples in BiQuad instance for later
-    psInstance->m_fxnm1_LOW = xnm1;
-    psInstance->m_fxnm2_LOW = xnm2;
-    psInstance->m_fynm1_LOW = ynm1;
-    psInstance->m_fynm2_LOW = ynm2;
-    // FILTER PROCESSING FOR PEAKING EQ 1 ///////////////////////////////////////
-    // reset output buffer pointer
-    pfOutput = psInstance->m_pfOutput;
-    // get preciosuly processed samples
-    xnm1 = psInstance->m_fxnm1_P1;
-    xnm2 = psInstance->m_fxnm2_P1;
-    ynm1 = psInstance->m_fynm1_P1;
-    ynm2 = psInstance->m_fynm2_P1;
-    // apply biquad calculation to buffers
-    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
-        xn = *(pfOutput);
-        yn = (coeffs_P1.b0 * xn   + coeffs_P1.b1 * xnm1 + coeffs_P1.b2 * xnm2 - 
-              coeffs_P1.a1 * ynm1 - coeffs_P1.a2 * ynm2);
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-        *(pfOutput++) = yn;
+    // apply new coeffs at once or ramp towards them with all five
+    // sections, the compiled plan takes over once they are reached
+    if (changed_coeffs) {
+        stopParallelBiquads(&psInstance->m_parallel,
+                            &psInstance->m_plan.compiled,
+                            psInstance->m_plan.count);
+        stopBiquadPlan(&psInstance->m_plan, &psInstance->m_cascade);
+        startBiquadCascadeRamp(&psInstance->m_cascade,
+                               SECTIONCOUNT,
+                               smoothingToSamples(psInstance->m_pfSmoothing,
+                                                  psInstance->m_fSampleRate));
     }
-    // store preciously calculated samples in BiQuad instance for later
-    psInstance->m_fxnm1_P1 = xnm1;
-    psInstance->m_fxnm2_P1 = xnm2;
-    psInstance->m_fynm1_P1 = ynm1;
-    psInstance->m_fynm2_P1 = ynm2;
-    // FILTER PROCESSING FOR PEAKING EQ 2 ///////////////////////////////////////
-    // reset output buffer pointer
-    pfOutput = psInstance->m_pfOutput;
-    // get preciosuly processed samples
-    xnm1 = psInstance->m_fxnm1_P2;
-    xnm2 = psInstance->m_fxnm2_P2;
-    ynm1 = psInstance->m_fynm1_P2;
-    ynm2 = psInstance->m_fynm2_P2;
-    // apply biquad calculation to buffers
-    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
-        xn = *(pfOutput);
-        yn = (coeffs_P2.b0 * xn   + coeffs_P2.b1 * xnm1 + coeffs_P2.b2 * xnm2 - 
-              coeffs_P2.a1 * ynm1 - coeffs_P2.a2 * ynm2);
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-        *(pfOutput++) = yn;
+    if (startBiquadPlan(&psInstance->m_plan, &psInstance->m_cascade, SECTIONCOUNT)) {
+        requestParallelBiquads(&psInstance->m_parallel,
+                               &psInstance->m_parallelJob,
+                               &psInstance->m_plan.compiled,
+                               psInstance->m_plan.count);
+        invalidateStateSpaceCascade(&psInstance->m_statespace);
     }
-    // store preciously calculated samples in BiQuad instance for later
-    psInstance->m_fxnm1_P2 = xnm1;
-    psInstance->m_fxnm2_P2 = xnm2;
-    psInstance->m_fynm1_P2 = ynm1;
-    psInstance->m_fynm2_P2 = ynm2;
-    // FILTER PROCESSING FOR PEAKING EQ 3 ///////////////////////////////////////
-    // reset output buffer pointer
-    pfOutput = psInstance->m_pfOutput;
-    // get preciosuly processed samples
-    xnm1 = psInstance->m_fxnm1_P3;
-    xnm2 = psInstance->m_fxnm2_P3;
-    ynm1 = psInstance->m_fynm1_P3;
-    ynm2 = psInstance->m_fynm2_P3;
-    // apply biquad calculation to buffers
-    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
-        xn = *(pfOutput);
-        yn = (coeffs_P3.b0 * xn   + coeffs_P3.b1 * xnm1 + coeffs_P3.b2 * xnm2 - 
-              coeffs_P3.a1 * ynm1 - coeffs_P3.a2 * ynm2);
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-        *(pfOutput++) = yn;
+    // the parallel form takes over from the block matrices once the
+    // worker has expanded the plan
+    if (psInstance->m_plan.active) {
+        installParallelBiquads(&psInstance->m_parallel, &psInstance->m_parallelJob);
     }
-    // store preciously calculated samples in BiQuad instance for later
-    psInstance->m_fxnm1_P3 = xnm1;
-    psInstance->m_fxnm2_P3 = xnm2;
-    psInstance->m_fynm1_P3 = ynm1;
-    psInstance->m_fynm2_P3 = ynm2;
-    // FILTER PROCESSING FOR HIGH SHELF EQ //////////////////////////////////////
-    // reset output buffer pointer
-    pfOutput = psInstance->m_pfOutput;
-    // get preciosuly processed samples
-    xnm1 = psInstance->m_fxnm1_HIGH;
-    xnm2 = psInstance->m_fxnm2_HIGH;
-    ynm1 = psInstance->m_fynm1_HIGH;
-    ynm2 = psInstance->m_fynm2_HIGH;
-    // apply biquad calculation to buffers
-    for (lSampleIndex = 0; lSampleIndex < SampleCount; lSampleIndex++) {
-        xn = *(pfOutput);
-        yn = (coeffs_HIGH.b0 * xn   + coeffs_HIGH.b1 * xnm1 + coeffs_HIGH.b2 * xnm2 - 
-              coeffs_HIGH.a1 * ynm1 - coeffs_HIGH.a2 * ynm2);
-        xnm2 = xnm1;
-        xnm1 = xn;
-        ynm2 = ynm1;
-        ynm1 = yn;
-        *(pfOutput++) = yn * fGainFactor;
+    // FILTER PROCESSING, the sections left side by side or in blocks ///////////
+    fpuMode = disableDenormals();
+    if (!psInstance->m_plan.active) {
+        runBiquadCascadeMode(&psInstance->m_cascade,
+                             SECTIONCOUNT,
+                             psInstance->m_pfInput,
+                             psInstance->m_pfOutput,
+                             SampleCount,
+                             Adding,
+                             psInstance->m_fRunAddingGain);
+    } else {
+        // every section count gets its own unrolled kernels
+        switch (psInstance->m_plan.count) {
+        case 0:
+            runThreeBandParametricEqWithShelvesPlan(psInstance, 0, SampleCount, Adding);
+            break;
+        case 1:
+            runThreeBandParametricEqWithShelvesPlan(psInstance, 1, SampleCount, Adding);
+            break;
+        case 2:
+            runThreeBandParametricEqWithShelvesPlan(psInstance, 2, SampleCount, Adding);
+            break;
+        case 3:
+            runThreeBandParametricEqWithShelvesPlan(psInstance, 3, SampleCount, Adding);
+            break;
+        case 4:
+            runThreeBandParametricEqWithShelvesPlan(psInstance, 4, SampleCount, Adding);
+            break;
+        case 5:
+            runThreeBandParametricEqWithShelvesPlan(psInstance, 5, SampleCount, Adding);
+            break;
+        }
     }
-    // store preciously calculated samples in BiQuad instance for later
-    psInstance->m_fxnm1_HIGH = xnm1;
-    psInstance->m_fxnm2_HIGH = xnm2;
-    psInstance->m_fynm1_HIGH = ynm1;
-    psInstance->m_fynm2_HIGH = ynm2;
+    restoreDenormals(fpuMode);
+    publishMmapMeter(psInstance->m_meterBlock,
+                     &psInstance->m_meter,
+                     msToSamples(MMAP_METER_WINDOW_MS, psInstance->m_fSampleRate));
+    updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runThreeBandParametricEqWithShelves(LADSPA_Handle Instance,
+                                         unsigned long SampleCount) {
+    runThreeBandParametricEqWithShelvesMode(Instance, SampleCount, 0);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   result to the output buffer. */
+void runAddingThreeBandParametricEqWithShelves(LADSPA_Handle Instance,
+                                               unsigned long SampleCount) {
+    runThreeBandParametricEqWithShelvesMode(Instance, SampleCount, 1);
+}
+
+/* Set the output gain of run_adding(). */
+void setRunAddingGainThreeBandParametricEqWithShelves(LADSPA_Handle Instance,
+                                                      LADSPA_Data Gain) {
+    ((ThreeBandParametricEqWithShelves *)Instance)->m_fRunAddingGain = Gain;
 }
 
 /*****************************************************************************/
@@ -486,335 +520,117 @@ void cleanupThreeBandParametricEqWithShelves(LADSPA_Handle Instance) {
     ThreeBandParametricEqWithShelves * psInstance;
     psInstance = (ThreeBandParametricEqWithShelves *)Instance;
     if (psInstance->m_mmapArea != NULL) {
-        cleanupMmapFile("3BandParamEqWithShelves",
+        cleanupMmapFile(psInstance->m_slot,
+                    "3BandParamEqWithShelves",
                     *(psInstance->m_pfMmapFname),
                     psInstance->m_created_s,
                     psInstance->m_created_ns);
-        free(Instance);
-    }
-}
-
-/*****************************************************************************/
-
-LADSPA_Descriptor * g_psThreeBandParametricEqWithShelvesInstanceDescriptor = NULL;
-
-/*****************************************************************************/
-
-/* _init() is called automatically when the plugin library is first loaded. */
-void _init() {
-
-    char ** pcPortNames;
-    LADSPA_PortDescriptor * piPortDescriptors;
-    LADSPA_PortRangeHint * psPortRangeHints;
-    
-    g_psThreeBandParametricEqWithShelvesInstanceDescriptor
-      = (LADSPA_Descriptor *)malloc(sizeof(LADSPA_Descriptor));
-
-    if (g_psThreeBandParametricEqWithShelvesInstanceDescriptor != NULL) {
-    
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->UniqueID
-            = 5541;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->Label
-            = strdup("3band_parameq_with_shelves");
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->Properties
-            = LADSPA_PROPERTY_HARD_RT_CAPABLE;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->Name 
-            = strdup("T5's 3-Band Parametric with Shelves");
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->Maker
-            = strdup("Juergen Herrmann (t-5@t-5.eu)");
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->Copyright
-            = strdup("3-clause BSD licence");
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->PortCount
-            = PORTCOUNT;
-        piPortDescriptors
-            = (LADSPA_PortDescriptor *)calloc(PORTCOUNT, sizeof(LADSPA_PortDescriptor));
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->PortDescriptors
-            = (const LADSPA_PortDescriptor *)piPortDescriptors;
-        piPortDescriptors[SF_INPUT]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_AUDIO;
-        piPortDescriptors[SF_OUTPUT]
-            = LADSPA_PORT_OUTPUT | LADSPA_PORT_AUDIO;
-        piPortDescriptors[SF_LOW_F]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_LOW_G]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_LOW_Q]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P1_F]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P1_G]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P1_Q]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P2_F]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P2_G]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P2_Q]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P3_F]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P3_G]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_P3_Q]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_HIGH_F]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_HIGH_G]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_HIGH_Q]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_GAIN]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        piPortDescriptors[SF_MMAPFNAME]
-            = LADSPA_PORT_INPUT | LADSPA_PORT_CONTROL;
-        pcPortNames
-            = (char **)calloc(PORTCOUNT, sizeof(char *));
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->PortNames 
-            = (const char **)pcPortNames;
-        pcPortNames[SF_INPUT]
-            = strdup("Input");
-        pcPortNames[SF_OUTPUT]
-            = strdup("Output");
-        pcPortNames[SF_LOW_F]
-            = strdup("Low Shelf Frequency [Hz]");
-        pcPortNames[SF_LOW_G]
-            = strdup("Low Shelf Gain [dB]");
-        pcPortNames[SF_LOW_Q]
-            = strdup("Low Shelf Q");
-        pcPortNames[SF_P1_F]
-            = strdup("Peaking EQ 1 Frequency [Hz]");
-        pcPortNames[SF_P1_G]
-            = strdup("Peaking EQ 1 Gain [dB]");
-        pcPortNames[SF_P1_Q]
-            = strdup("Peaking EQ 1 Q");
-        pcPortNames[SF_P2_F]
-            = strdup("Peaking EQ 2 Frequency [Hz]");
-        pcPortNames[SF_P2_G]
-            = strdup("Peaking EQ 2 Gain [dB]");
-        pcPortNames[SF_P2_Q]
-            = strdup("Peaking EQ 2 Q");
-        pcPortNames[SF_P3_F]
-            = strdup("Peaking EQ 3 Frequency [Hz]");
-        pcPortNames[SF_P3_G]
-            = strdup("Peaking EQ 3 Gain [dB]");
-        pcPortNames[SF_P3_Q]
-            = strdup("Peaking EQ 3 Q");
-        pcPortNames[SF_HIGH_F]
-            = strdup("High Shelf Frequency [Hz]");
-        pcPortNames[SF_HIGH_G]
-            = strdup("High Shelf Gain [dB]");
-        pcPortNames[SF_HIGH_Q]
-            = strdup("High Shelf Q");
-        pcPortNames[SF_GAIN]
-            = strdup("Overall Gain [dB]");
-        pcPortNames[SF_MMAPFNAME]
-            = strdup("MMAP-Filename-Part");
-        psPortRangeHints = ((LADSPA_PortRangeHint *)
-            calloc(PORTCOUNT, sizeof(LADSPA_PortRangeHint)));
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->PortRangeHints
-            = (const LADSPA_PortRangeHint *)psPortRangeHints;
-        // Low Shelf --------------------------------------------------------- */
-        psPortRangeHints[SF_LOW_F].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_SAMPLE_RATE
-            | LADSPA_HINT_LOGARITHMIC
-            | LADSPA_HINT_DEFAULT_440);
-        psPortRangeHints[SF_LOW_F].LowerBound 
-            = 0;
-        psPortRangeHints[SF_LOW_F].UpperBound
-            = 0.5;
-        psPortRangeHints[SF_LOW_G].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_0);
-        psPortRangeHints[SF_LOW_G].LowerBound 
-            = -12;
-        psPortRangeHints[SF_LOW_G].UpperBound
-            = 12;
-        psPortRangeHints[SF_LOW_Q].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_1);
-        psPortRangeHints[SF_LOW_Q].LowerBound 
-            = 0.1;
-        psPortRangeHints[SF_LOW_Q].UpperBound
-            = 10;
-        // Peaking Parametric EQ 1 -------------------------------------------- */
-        psPortRangeHints[SF_P1_F].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_SAMPLE_RATE
-            | LADSPA_HINT_LOGARITHMIC
-            | LADSPA_HINT_DEFAULT_440);
-        psPortRangeHints[SF_P1_F].LowerBound 
-            = 0;
-        psPortRangeHints[SF_P1_F].UpperBound
-            = 0.5;
-        psPortRangeHints[SF_P1_G].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_0);
-        psPortRangeHints[SF_P1_G].LowerBound 
-            = -12;
-        psPortRangeHints[SF_P1_G].UpperBound
-            = 12;
-        psPortRangeHints[SF_P1_Q].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_1);
-        psPortRangeHints[SF_P1_Q].LowerBound 
-            = 0.1;
-        psPortRangeHints[SF_P1_Q].UpperBound
-            = 10;
-        // Peaking Parametric EQ 2 -------------------------------------------- */
-        psPortRangeHints[SF_P2_F].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_SAMPLE_RATE
-            | LADSPA_HINT_LOGARITHMIC
-            | LADSPA_HINT_DEFAULT_440);
-        psPortRangeHints[SF_P2_F].LowerBound 
-            = 0;
-        psPortRangeHints[SF_P2_F].UpperBound
-            = 0.5;
-        psPortRangeHints[SF_P2_G].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_0);
-        psPortRangeHints[SF_P2_G].LowerBound 
-            = -12;
-        psPortRangeHints[SF_P2_G].UpperBound
-            = 12;
-        psPortRangeHints[SF_P2_Q].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_1);
-        psPortRangeHints[SF_P2_Q].LowerBound 
-            = 0.1;
-        psPortRangeHints[SF_P2_Q].UpperBound
-            = 10;
-        // Peaking Parametric EQ 3 -------------------------------------------- */
-        psPortRangeHints[SF_P3_F].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_SAMPLE_RATE
-            | LADSPA_HINT_LOGARITHMIC
-            | LADSPA_HINT_DEFAULT_440);
-        psPortRangeHints[SF_P3_F].LowerBound 
-            = 0;
-        psPortRangeHints[SF_P3_F].UpperBound
-            = 0.5;
-        psPortRangeHints[SF_P3_G].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_0);
-        psPortRangeHints[SF_P3_G].LowerBound 
-            = -12;
-        psPortRangeHints[SF_P3_G].UpperBound
-            = 12;
-        psPortRangeHints[SF_P3_Q].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_1);
-        psPortRangeHints[SF_P3_Q].LowerBound 
-            = 0.1;
-        psPortRangeHints[SF_P3_Q].UpperBound
-            = 10;
-        // High Shelf -------------------------------------------------------- */
-        psPortRangeHints[SF_HIGH_F].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_SAMPLE_RATE
-            | LADSPA_HINT_LOGARITHMIC
-            | LADSPA_HINT_DEFAULT_440);
-        psPortRangeHints[SF_HIGH_F].LowerBound 
-            = 0;
-        psPortRangeHints[SF_HIGH_F].UpperBound
-            = 0.5;
-        psPortRangeHints[SF_HIGH_G].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_0);
-        psPortRangeHints[SF_HIGH_G].LowerBound 
-            = -12;
-        psPortRangeHints[SF_HIGH_G].UpperBound
-            = 12;
-        psPortRangeHints[SF_HIGH_Q].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_1);
-        psPortRangeHints[SF_HIGH_Q].LowerBound 
-            = 0.1;
-        psPortRangeHints[SF_HIGH_Q].UpperBound
-            = 10;
-        // Gain ------------------------------------------------------------ */
-        psPortRangeHints[SF_GAIN].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_0);
-        psPortRangeHints[SF_GAIN].LowerBound 
-            = -12;
-        psPortRangeHints[SF_GAIN].UpperBound
-            = 12;
-        // MMAP Filename --------------------------------------------------- */
-        psPortRangeHints[SF_MMAPFNAME].HintDescriptor
-            = (LADSPA_HINT_BOUNDED_BELOW 
-            | LADSPA_HINT_BOUNDED_ABOVE
-            | LADSPA_HINT_DEFAULT_0);
-        psPortRangeHints[SF_MMAPFNAME].LowerBound 
-            = 0;
-        psPortRangeHints[SF_MMAPFNAME].UpperBound
-            = 10000000000;
-        // In- and Outpus -------------------------------------------------- */
-        psPortRangeHints[SF_INPUT].HintDescriptor
-            = 0;
-        psPortRangeHints[SF_OUTPUT].HintDescriptor
-            = 0;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->instantiate 
-            = instantiateThreeBandParametricEqWithShelves;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->connect_port 
-            = connectPortToThreeBandParametricEqWithShelves;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->activate
-            = activateThreeBandParametricEqWithShelves;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->run
-            = runThreeBandParametricEqWithShelves;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->run_adding
-            = NULL;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->set_run_adding_gain
-            = NULL;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->deactivate
-            = NULL;
-        g_psThreeBandParametricEqWithShelvesInstanceDescriptor->cleanup
-            = cleanupThreeBandParametricEqWithShelves;
-    }
-}
-  
-/*****************************************************************************/
-
-void deleteDescriptor(LADSPA_Descriptor * psDescriptor) {
-    unsigned long lIndex;
-    if (psDescriptor) {
-        free((char *)psDescriptor->Label);
-        free((char *)psDescriptor->Name);
-        free((char *)psDescriptor->Maker);
-        free((char *)psDescriptor->Copyright);
-        free((LADSPA_PortDescriptor *)psDescriptor->PortDescriptors);
-        for (lIndex = 0; lIndex < psDescriptor->PortCount; lIndex++)
-            free((char *)(psDescriptor->PortNames[lIndex]));
-        free((char **)psDescriptor->PortNames);
-        free((LADSPA_PortRangeHint *)psDescriptor->PortRangeHints);
-        free(psDescriptor);
     }
+    closePresetBank(&psInstance->m_bank);
+    releaseMmapSlot(psInstance->m_slot);
+    unregisterParallelJob(&psInstance->m_parallelJob);
+    free(Instance);
 }
 
 /*****************************************************************************/
 
-/* _fini() is called automatically when the library is unloaded. */
-void _fini() {
-    deleteDescriptor(g_psThreeBandParametricEqWithShelvesInstanceDescriptor);
-}
+static const LADSPA_PortDescriptor g_piThreeBandParametricEqWithShelvesPortDescriptors[PORTCOUNT] = {
+    [SF_INPUT] = PORT_AUDIO_INPUT,
+    [SF_OUTPUT] = PORT_AUDIO_OUTPUT,
+    [SF_LOW_F ... SF_SMOOTHING] = PORT_CONTROL_INPUT
+};
+
+static const char * const g_pcThreeBandParametricEqWithShelvesPortNames[PORTCOUNT] = {
+    [SF_INPUT] = "Input",
+    [SF_OUTPUT] = "Output",
+    [SF_LOW_F] = "Low Shelf Frequency [Hz]",
+    [SF_LOW_G] = "Low Shelf Gain [dB]",
+    [SF_LOW_Q] = "Low Shelf Q",
+    [SF_P1_F] = "Peaking EQ 1 Frequency [Hz]",
+    [SF_P1_G] = "Peaking EQ 1 Gain [dB]",
+    [SF_P1_Q] = "Peaking EQ 1 Q",
+    [SF_P2_F] = "Peaking EQ 2 Frequency [Hz]",
+    [SF_P2_G] = "Peaking EQ 2 Gain [dB]",
+    [SF_P2_Q] = "Peaking EQ 2 Q",
+    [SF_P3_F] = "Peaking EQ 3 Frequency [Hz]",
+    [SF_P3_G] = "Peaking EQ 3 Gain [dB]",
+    [SF_P3_Q] = "Peaking EQ 3 Q",
+    [SF_HIGH_F] = "High Shelf Frequency [Hz]",
+    [SF_HIGH_G] = "High Shelf Gain [dB]",
+    [SF_HIGH_Q] = "High Shelf Q",
+    [SF_GAIN] = "Overall Gain [dB]",
+    [SF_MMAPFNAME] = "MMAP-Filename-Part",
+    [SF_SMOOTHING] = "Smoothing Time [ms]"
+};
+
+static const LADSPA_PortRangeHint g_psThreeBandParametricEqWithShelvesPortRangeHints[PORTCOUNT] = {
+    // Low Shelf --------------------------------------------------------- */
+    [SF_LOW_F] = HINT_F,
+    [SF_LOW_G] = HINT_G,
+    [SF_LOW_Q] = HINT_Q,
+    // Peaking Parametric EQs -------------------------------------------- */
+    [SF_P1_F] = HINT_F,
+    [SF_P1_G] = HINT_G,
+    [SF_P1_Q] = HINT_Q,
+    [SF_P2_F] = HINT_F,
+    [SF_P2_G] = HINT_G,
+    [SF_P2_Q] = HINT_Q,
+    [SF_P3_F] = HINT_F,
+    [SF_P3_G] = HINT_G,
+    [SF_P3_Q] = HINT_Q,
+    // High Shelf -------------------------------------------------------- */
+    [SF_HIGH_F] = HINT_F,
+    [SF_HIGH_G] = HINT_G,
+    [SF_HIGH_Q] = HINT_Q,
+    // Gain, MMAP Filename and Smoothing Time ---------------------------- */
+    [SF_GAIN] = HINT_G,
+    [SF_MMAPFNAME] = HINT_MMAPFNAME,
+    [SF_SMOOTHING] = HINT_SMOOTHING
+};
+
+static const LADSPA_Descriptor g_sThreeBandParametricEqWithShelvesDescriptor = {
+    .UniqueID = 5541,
+    .Label = "3band_parameq_with_shelves",
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+    .Name = "T5's 3-Band Parametric with Shelves",
+    .Maker = T5_MAKER,
+    .Copyright = T5_COPYRIGHT,
+    .PortCount = PORTCOUNT_UNSMOOTHED,
+    .PortDescriptors = g_piThreeBandParametricEqWithShelvesPortDescriptors,
+    .PortNames = g_pcThreeBandParametricEqWithShelvesPortNames,
+    .PortRangeHints = g_psThreeBandParametricEqWithShelvesPortRangeHints,
+    .ImplementationData = NULL,
+    .instantiate = instantiateThreeBandParametricEqWithShelves,
+    .connect_port = connectPortToThreeBandParametricEqWithShelves,
+    .activate = activateThreeBandParametricEqWithShelves,
+    .run = runThreeBandParametricEqWithShelves,
+    .run_adding = runAddingThreeBandParametricEqWithShelves,
+    .set_run_adding_gain = setRunAddingGainThreeBandParametricEqWithShelves,
+    .deactivate = NULL,
+    .cleanup = cleanupThreeBandParametricEqWithShelves
+};
+
+static const LADSPA_Descriptor g_sThreeBandParametricEqWithShelvesSmoothDescriptor = {
+    .UniqueID = 5569,
+    .Label = "3band_parameq_with_shelves_smooth",
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+    .Name = "T5's 3-Band Parametric with Shelves, Smoothed",
+    .Maker = T5_MAKER,
+    .Copyright = T5_COPYRIGHT,
+    .PortCount = PORTCOUNT,
+    .PortDescriptors = g_piThreeBandParametricEqWithShelvesPortDescriptors,
+    .PortNames = g_pcThreeBandParametricEqWithShelvesPortNames,
+    .PortRangeHints = g_psThreeBandParametricEqWithShelvesPortRangeHints,
+    .ImplementationData = NULL,
+    .instantiate = instantiateThreeBandParametricEqWithShelves,
+    .connect_port = connectPortToThreeBandParametricEqWithShelves,
+    .activate = activateThreeBandParametricEqWithShelves,
+    .run = runThreeBandParametricEqWithShelves,
+    .run_adding = runAddingThreeBandParametricEqWithShelves,
+    .set_run_adding_gain = setRunAddingGainThreeBandParametricEqWithShelves,
+    .deactivate = NULL,
+    .cleanup = cleanupThreeBandParametricEqWithShelves
+};
 
 /*****************************************************************************/
 
@@ -823,7 +639,9 @@ const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
     /* Return the requested descriptor or null if the index is out of range. */
     switch (Index) {
     case 0:
-        return g_psThreeBandParametricEqWithShelvesInstanceDescriptor;
+        return &g_sThreeBandParametricEqWithShelvesDescriptor;
+    case 1:
+        return &g_sThreeBandParametricEqWithShelvesSmoothDescriptor;
     default:
         return NULL;
     }
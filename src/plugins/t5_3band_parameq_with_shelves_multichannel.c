@@ -0,0 +1,429 @@
+/* t5_3band_parameq_with_shelves_multichannel.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides a three band parametric equalizer with
+   shelving low- and highpass filters for 2, 4 and 8 channels in one
+   instance. All channels share the same settings, every channel runs in
+   its own SIMD lane.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "design.h"
+#include "coeffs.h"
+#include "cascade.h"
+#include "descriptors.h"
+
+/*****************************************************************************/
+
+/* Port layout for c channels: c audio inputs, c audio outputs, then the
+   control ports of the single channel plugin. */
+#define SF_INPUT(i)        (i)
+#define SF_OUTPUT(c, i)    ((c) + (i))
+#define SF_CONTROL(c, p)   (2 * (c) + (p))
+#define PORTCOUNT(c)       (2 * (c) + CONTROLCOUNT)
+
+// control ports, relative to the first one
+#define CTL_LOW_F      0
+#define CTL_LOW_G      1
+#define CTL_LOW_Q      2
+#define CTL_P1_F       3
+#define CTL_P1_G       4
+#define CTL_P1_Q       5
+#define CTL_P2_F       6
+#define CTL_P2_G       7
+#define CTL_P2_Q       8
+#define CTL_P3_F       9
+#define CTL_P3_G      10
+#define CTL_P3_Q      11
+#define CTL_HIGH_F    12
+#define CTL_HIGH_G    13
+#define CTL_HIGH_Q    14
+#define CTL_GAIN      15
+#define CTL_MMAPFNAME 16
+#define CONTROLCOUNT  17
+
+// biquad sections in processing order
+#define SECTION_LOW    0
+#define SECTION_P1     1
+#define SECTION_P2     2
+#define SECTION_P3     3
+#define SECTION_HIGH   4
+#define SECTIONCOUNT   5
+
+// parameters in the mmap area: LOW_F .. GAIN
+#define MMAP_PARAMCOUNT 16
+
+/*****************************************************************************/
+
+/* Instance data for the multichannel ThreeBandParametricEqWithShelves filter */
+typedef struct {
+
+    long m_created_ns;
+    time_t m_created_s;
+
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
+    LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+
+    LADSPA_Data m_fSampleRate;
+    int m_iChannels;
+    // coefficients and previous samples of all biquad filters, all channels
+    BiquadLaneCascade m_cascade;
+    // parameters the coefficients and gain factor were calculated for
+    BiquadParams m_params[SECTIONCOUNT];
+    LADSPA_Data m_fGain;
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
+    // port pointers
+    LADSPA_Data * m_ppfInput[CASCADE_MAX_LANES];
+    LADSPA_Data * m_ppfOutput[CASCADE_MAX_LANES];
+    LADSPA_Data * m_ppfControl[CONTROLCOUNT];
+
+} ThreeBandParametricEqWithShelvesMultiChannel;
+
+/* Helpers... ****************************************************************/
+
+void setupMmapFileForThreeBandParametricEqWithShelvesMultiChannel(ThreeBandParametricEqWithShelvesMultiChannel * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    ret = setupMmapFile(&psInstance->m_slot, "3BandParamEqWithShelvesMultiChannel",
+                        *(psInstance->m_ppfControl[CTL_MMAPFNAME]),
+                        MMAP_PARAMCOUNT);
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_ppfControl[CTL_MMAPFNAME]) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/* Set the coefficients of section iSection for all channels. */
+void setSectionCoeffs(ThreeBandParametricEqWithShelvesMultiChannel * psInstance,
+                      int iSection,
+                      BiquadCoeffs coeffs) {
+    int iChannel;
+    for (iChannel = 0; iChannel < psInstance->m_iChannels; iChannel++) {
+        setBiquadLaneCoeffs(&psInstance->m_cascade, iSection, iChannel, coeffs);
+    }
+}
+
+/*****************************************************************************/
+
+/* Construct a new plugin instance. */
+LADSPA_Handle instantiateThreeBandParametricEqWithShelvesMultiChannel(const LADSPA_Descriptor * Descriptor,
+                                                                      unsigned long SampleRate) {
+    ThreeBandParametricEqWithShelvesMultiChannel * psInstance;
+    psInstance = (ThreeBandParametricEqWithShelvesMultiChannel *)
+        malloc(sizeof(ThreeBandParametricEqWithShelvesMultiChannel));
+    if (psInstance) {
+        psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_iChannels = (int)(long)Descriptor->ImplementationData;
+        psInstance->m_slot = NULL;
+        psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_fRunAddingGain = 1.0;
+    }
+    return psInstance;
+}
+
+/*****************************************************************************/
+
+/* Initialise and activate a plugin instance. */
+void activateThreeBandParametricEqWithShelvesMultiChannel(LADSPA_Handle Instance) {
+    ThreeBandParametricEqWithShelvesMultiChannel * psInstance;
+    int iSection;
+    psInstance = (ThreeBandParametricEqWithShelvesMultiChannel *)Instance;
+    resetBiquadLaneCascade(&psInstance->m_cascade);
+    for (iSection = 0; iSection < SECTIONCOUNT; iSection++) {
+        invalidateBiquadParams(&psInstance->m_params[iSection]);
+    }
+    psInstance->m_fGain = NAN;
+}
+
+/*****************************************************************************/
+
+/* Connect a port to a data location.  */
+void connectPortToThreeBandParametricEqWithShelvesMultiChannel(LADSPA_Handle Instance,
+                                                               unsigned long Port,
+                                                               LADSPA_Data * DataLocation) {
+    ThreeBandParametricEqWithShelvesMultiChannel * psInstance;
+    int c;
+    psInstance = (ThreeBandParametricEqWithShelvesMultiChannel *)Instance;
+    c = psInstance->m_iChannels;
+    if (Port < SF_OUTPUT(c, 0)) {
+        psInstance->m_ppfInput[Port - SF_INPUT(0)] = DataLocation;
+    } else if (Port < SF_CONTROL(c, 0)) {
+        psInstance->m_ppfOutput[Port - SF_OUTPUT(c, 0)] = DataLocation;
+    } else if (Port < PORTCOUNT(c)) {
+        psInstance->m_ppfControl[Port - SF_CONTROL(c, 0)] = DataLocation;
+    }
+}
+
+/*****************************************************************************/
+
+/* Recalculate the coefficients of all sections whose controls changed, in
+   one go. Returns 1 if any were recalculated. */
+int updateSections(ThreeBandParametricEqWithShelvesMultiChannel * psInstance) {
+    BiquadDesign designs[SECTIONCOUNT];
+    BiquadCoeffs designed[SECTIONCOUNT];
+    int designedSection[SECTIONCOUNT];
+    int designCount = 0;
+    int iSection, iDesign;
+    LADSPA_Data ** ctl;
+    for (iSection = 0; iSection < SECTIONCOUNT; iSection++) {
+        // frequency, gain and Q of every section, lowest first
+        ctl = psInstance->m_ppfControl + CTL_LOW_F + 3 * iSection;
+        if (updateBiquadParams(&psInstance->m_params[iSection],
+                               *(ctl[0]),
+                               *(ctl[1]),
+                               *(ctl[2]),
+                               psInstance->m_fSampleRate)) {
+            designs[designCount].type = designTypeParamEqWithShelves(iSection, SECTIONCOUNT);
+            designs[designCount].f = *(ctl[0]);
+            designs[designCount].g = *(ctl[1]);
+            designs[designCount].q = *(ctl[2]);
+            designedSection[designCount++] = iSection;
+        }
+    }
+    if (designCount == 0) {
+        return 0;
+    }
+    designBiquadSections(designs, designCount, psInstance->m_fSampleRate, designed);
+    for (iDesign = 0; iDesign < designCount; iDesign++) {
+        setSectionCoeffs(psInstance, designedSection[iDesign], designed[iDesign]);
+    }
+    return 1;
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. With Adding
+   the results are added to the output buffers (run_adding). */
+static inline void runThreeBandParametricEqWithShelvesMultiChannelMode(LADSPA_Handle Instance,
+                                                                       unsigned long SampleCount,
+                                                                       const int Adding) {
+
+    ThreeBandParametricEqWithShelvesMultiChannel * psInstance;
+    LADSPA_Data mmapParams[MMAP_PARAMCOUNT];
+    unsigned long fpuMode;
+    uint64_t startCycles;
+    int changed_coeffs = 0;
+    int changed_mmap = 0;
+    int i;
+    // get ThreeBandParametricEqWithShelvesMultiChannel Instance
+    psInstance = (ThreeBandParametricEqWithShelvesMultiChannel *)Instance;
+    startCycles = startMmapTelemetry(psInstance->m_telemetry);
+    // copy parameters over from mmapped area or a scene
+    if (psInstance->m_mmapArea != NULL) {
+        if (readMmapScene(psInstance->m_slot,
+                          mmapParams,
+                          MMAP_PARAMCOUNT,
+                          SampleCount,
+                          psInstance->m_fSampleRate) ||
+            readMmapParams(psInstance->m_mmapArea,
+                           psInstance->m_mmapParams,
+                           &psInstance->m_mmapSequence,
+                           mmapParams,
+                           MMAP_PARAMCOUNT)) {
+            changed_mmap = 1;
+            for (i = 0; i < MMAP_PARAMCOUNT; i++) {
+                *(psInstance->m_ppfControl[i]) = mmapParams[i];
+            }
+        }
+    } else if (wantMmapSetup(*(psInstance->m_ppfControl[CTL_MMAPFNAME]), psInstance->m_fMmapFailed)) {
+        setupMmapFileForThreeBandParametricEqWithShelvesMultiChannel(psInstance);
+    }
+    // calculate coeffs and gain factor, but only if their inputs changed
+    changed_coeffs |= updateSections(psInstance);
+    if (*(psInstance->m_ppfControl[CTL_GAIN]) != psInstance->m_fGain) {
+        changed_coeffs = 1;
+        psInstance->m_fGain = *(psInstance->m_ppfControl[CTL_GAIN]);
+        for (i = 0; i < psInstance->m_iChannels; i++) {
+            setBiquadLaneGainFactor(&psInstance->m_cascade, i, dbToGainFactor(psInstance->m_fGain));
+        }
+    }
+    // FILTER PROCESSING, all five sections of all channels in one pass ///////
+    fpuMode = disableDenormals();
+    switch (psInstance->m_iChannels) {
+    case 2:
+        runBiquadLaneCascadeMode(&psInstance->m_cascade, SECTIONCOUNT, 2,
+                                 psInstance->m_ppfInput, psInstance->m_ppfOutput, SampleCount,
+                                 Adding, psInstance->m_fRunAddingGain);
+        break;
+    case 4:
+        runBiquadLaneCascadeMode(&psInstance->m_cascade, SECTIONCOUNT, 4,
+                                 psInstance->m_ppfInput, psInstance->m_ppfOutput, SampleCount,
+                                 Adding, psInstance->m_fRunAddingGain);
+        break;
+    case 8:
+        runBiquadLaneCascadeMode(&psInstance->m_cascade, SECTIONCOUNT, 8,
+                                 psInstance->m_ppfInput, psInstance->m_ppfOutput, SampleCount,
+                                 Adding, psInstance->m_fRunAddingGain);
+        break;
+    }
+    restoreDenormals(fpuMode);
+    updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runThreeBandParametricEqWithShelvesMultiChannel(LADSPA_Handle Instance,
+                                                     unsigned long SampleCount) {
+    runThreeBandParametricEqWithShelvesMultiChannelMode(Instance, SampleCount, 0);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   results to the output buffers. */
+void runAddingThreeBandParametricEqWithShelvesMultiChannel(LADSPA_Handle Instance,
+                                                           unsigned long SampleCount) {
+    runThreeBandParametricEqWithShelvesMultiChannelMode(Instance, SampleCount, 1);
+}
+
+/* Set the output gain of run_adding(). */
+void setRunAddingGainThreeBandParametricEqWithShelvesMultiChannel(LADSPA_Handle Instance,
+                                                                  LADSPA_Data Gain) {
+    ((ThreeBandParametricEqWithShelvesMultiChannel *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/* Throw away a ThreeBandParametricEqWithShelvesMultiChannel instance. */
+void cleanupThreeBandParametricEqWithShelvesMultiChannel(LADSPA_Handle Instance) {
+    ThreeBandParametricEqWithShelvesMultiChannel * psInstance;
+    psInstance = (ThreeBandParametricEqWithShelvesMultiChannel *)Instance;
+    if (psInstance->m_mmapArea != NULL) {
+        cleanupMmapFile(psInstance->m_slot,
+                        "3BandParamEqWithShelvesMultiChannel",
+                        *(psInstance->m_ppfControl[CTL_MMAPFNAME]),
+                        psInstance->m_created_s,
+                        psInstance->m_created_ns);
+    }
+    releaseMmapSlot(psInstance->m_slot);
+    free(Instance);
+}
+
+/*****************************************************************************/
+
+/* names and range hints of the control ports, in port order */
+#define CONTROL_NAMES                   \
+    "Low Shelf Frequency [Hz]",         \
+    "Low Shelf Gain [dB]",              \
+    "Low Shelf Q",                      \
+    "Peaking EQ 1 Frequency [Hz]",      \
+    "Peaking EQ 1 Gain [dB]",           \
+    "Peaking EQ 1 Q",                   \
+    "Peaking EQ 2 Frequency [Hz]",      \
+    "Peaking EQ 2 Gain [dB]",           \
+    "Peaking EQ 2 Q",                   \
+    "Peaking EQ 3 Frequency [Hz]",      \
+    "Peaking EQ 3 Gain [dB]",           \
+    "Peaking EQ 3 Q",                   \
+    "High Shelf Frequency [Hz]",        \
+    "High Shelf Gain [dB]",             \
+    "High Shelf Q",                     \
+    "Overall Gain [dB]",                \
+    "MMAP-Filename-Part"
+
+#define CONTROL_HINTS                   \
+    HINT_F, HINT_G, HINT_Q,             \
+    HINT_F, HINT_G, HINT_Q,             \
+    HINT_F, HINT_G, HINT_Q,             \
+    HINT_F, HINT_G, HINT_Q,             \
+    HINT_F, HINT_G, HINT_Q,             \
+    HINT_G,                             \
+    HINT_MMAPFNAME
+
+/* Ports of the C channel variant. */
+#define THREEBAND_MULTICHANNEL_PORTS(C)                                                \
+static const LADSPA_PortDescriptor g_piThreeBandMultiChannelPortDescriptors##C[PORTCOUNT(C)] = { \
+    [SF_INPUT(0) ... SF_INPUT(C - 1)] = PORT_AUDIO_INPUT,                              \
+    [SF_OUTPUT(C, 0) ... SF_OUTPUT(C, C - 1)] = PORT_AUDIO_OUTPUT,                     \
+    [SF_CONTROL(C, 0) ... SF_CONTROL(C, CONTROLCOUNT - 1)] = PORT_CONTROL_INPUT        \
+};                                                                                     \
+static const char * const g_pcThreeBandMultiChannelPortNames##C[PORTCOUNT(C)] = {     \
+    [SF_INPUT(0)] = SEQ_##C(INPUT_NAME),                                               \
+    [SF_OUTPUT(C, 0)] = SEQ_##C(OUTPUT_NAME),                                          \
+    [SF_CONTROL(C, 0)] = CONTROL_NAMES                                                 \
+};                                                                                     \
+static const LADSPA_PortRangeHint g_psThreeBandMultiChannelPortRangeHints##C[PORTCOUNT(C)] = { \
+    [SF_CONTROL(C, 0)] = CONTROL_HINTS                                                 \
+};
+
+THREEBAND_MULTICHANNEL_PORTS(2)
+THREEBAND_MULTICHANNEL_PORTS(4)
+THREEBAND_MULTICHANNEL_PORTS(8)
+
+/* Descriptor of the C channel variant. */
+#define THREEBAND_MULTICHANNEL_DESCRIPTOR(ID, LABEL, NAME, C) {                      \
+    .UniqueID = ID,                                                                    \
+    .Label = LABEL,                                                                    \
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,                                     \
+    .Name = NAME,                                                                      \
+    .Maker = T5_MAKER,                                                                 \
+    .Copyright = T5_COPYRIGHT,                                                         \
+    .PortCount = PORTCOUNT(C),                                                         \
+    .PortDescriptors = g_piThreeBandMultiChannelPortDescriptors##C,                    \
+    .PortNames = g_pcThreeBandMultiChannelPortNames##C,                                \
+    .PortRangeHints = g_psThreeBandMultiChannelPortRangeHints##C,                      \
+    .ImplementationData = (void *)C,                                                   \
+    .instantiate = instantiateThreeBandParametricEqWithShelvesMultiChannel,            \
+    .connect_port = connectPortToThreeBandParametricEqWithShelvesMultiChannel,         \
+    .activate = activateThreeBandParametricEqWithShelvesMultiChannel,                  \
+    .run = runThreeBandParametricEqWithShelvesMultiChannel,                            \
+    .run_adding = runAddingThreeBandParametricEqWithShelvesMultiChannel,               \
+    .set_run_adding_gain = setRunAddingGainThreeBandParametricEqWithShelvesMultiChannel, \
+    .deactivate = NULL,                                                                \
+    .cleanup = cleanupThreeBandParametricEqWithShelvesMultiChannel                     \
+}
+
+static const LADSPA_Descriptor g_asThreeBandParametricEqWithShelvesMultiChannelDescriptors[] = {
+    THREEBAND_MULTICHANNEL_DESCRIPTOR(5550,
+                                      "3band_parameq_with_shelves_2ch",
+                                      "T5's 3-Band Parametric with Shelves, 2 Channels",
+                                      2),
+    THREEBAND_MULTICHANNEL_DESCRIPTOR(5551,
+                                      "3band_parameq_with_shelves_4ch",
+                                      "T5's 3-Band Parametric with Shelves, 4 Channels",
+                                      4),
+    THREEBAND_MULTICHANNEL_DESCRIPTOR(5552,
+                                      "3band_parameq_with_shelves_8ch",
+                                      "T5's 3-Band Parametric with Shelves, 8 Channels",
+                                      8)
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+    /* Return the requested descriptor or null if the index is out of range. */
+    if (Index < sizeof(g_asThreeBandParametricEqWithShelvesMultiChannelDescriptors) / sizeof(LADSPA_Descriptor)) {
+        return &g_asThreeBandParametricEqWithShelvesMultiChannelDescriptors[Index];
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
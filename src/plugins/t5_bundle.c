@@ -0,0 +1,78 @@
+/* t5_bundle.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA library bundles all plugins of this package. Hosts that load
+   many of them, like PulseAudio's ladspa-sink, only have to open, relocate
+   and map one library and the shared helpers and filter kernels once.
+
+   The makefile compiles every plugin again for the bundle with
+   -Dladspa_descriptor=<plugin>_descriptor and hidden symbol visibility, so
+   the entry points of the single plugin libraries end up as the functions
+   declared below and only the ladspa_descriptor() of this file is
+   exported. The descriptors keep their labels and unique IDs, a host finds
+   the same plugins in t5_bundle.so as in the single libraries.
+
+*/
+
+/*****************************************************************************/
+
+#include <stddef.h>
+#include <ladspa.h>
+
+/*****************************************************************************/
+
+typedef const LADSPA_Descriptor * (*DescriptorFunction)(unsigned long Index);
+
+const LADSPA_Descriptor * t5_lr4_lowpass_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_lr4_highpass_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_3band_parameq_with_shelves_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_lr4_lowpass_multichannel_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_lr4_highpass_multichannel_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_3band_parameq_with_shelves_multichannel_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_lr4_crossover_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_parameq_with_shelves_nband_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_svf_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_delay_descriptor(unsigned long Index);
+const LADSPA_Descriptor * t5_sub_multirate_descriptor(unsigned long Index);
+
+/* Bundled plugin libraries, their descriptors are numbered in this order. */
+static const DescriptorFunction g_apfBundledLibraries[] = {
+    t5_lr4_lowpass_descriptor,
+    t5_lr4_highpass_descriptor,
+    t5_3band_parameq_with_shelves_descriptor,
+    t5_lr4_lowpass_multichannel_descriptor,
+    t5_lr4_highpass_multichannel_descriptor,
+    t5_3band_parameq_with_shelves_multichannel_descriptor,
+    t5_lr4_crossover_descriptor,
+    t5_parameq_with_shelves_nband_descriptor,
+    t5_svf_descriptor,
+    t5_delay_descriptor,
+    t5_sub_multirate_descriptor
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+__attribute__((visibility("default")))
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+    const LADSPA_Descriptor * psDescriptor;
+    unsigned long lLibrary, lIndex;
+    /* Walk through the bundled libraries, each one numbers its own
+       descriptors from 0 and returns null behind the last one. */
+    for (lLibrary = 0;
+         lLibrary < sizeof(g_apfBundledLibraries) / sizeof(DescriptorFunction);
+         lLibrary++) {
+        for (lIndex = 0; (psDescriptor = g_apfBundledLibraries[lLibrary](lIndex)) != NULL; lIndex++) {
+            if (Index-- == 0) {
+                return psDescriptor;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
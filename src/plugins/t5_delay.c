@@ -0,0 +1,323 @@
+/* t5_delay.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides a delay for the time alignment of the
+   drivers of a crossover, up to DELAY_MAX_MS. The delay is the sum of a
+   time in ms and a number of samples, the latter e.g. for the latency of
+   other plugins in the chain. Fractions of a sample are supported, see
+   delay.h. Changes glide over the Smoothing Time, but at least
+   DELAY_MIN_GLIDE_MS, so they never click.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "delay.h"
+#include "descriptors.h"
+
+/*****************************************************************************/
+
+#define SF_INPUT         0
+#define SF_OUTPUT        1
+#define SF_DELAY_MS      2
+#define SF_DELAY_SAMPLES 3
+#define SF_MMAPFNAME     4
+#define SF_SMOOTHING     5
+#define PORTCOUNT        6
+
+// parameters in the mmap area: DELAY_MS, DELAY_SAMPLES
+#define MMAP_PARAMCOUNT 2
+
+#define HINT_DELAY_MS      { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                             | LADSPA_HINT_DEFAULT_0, 0, DELAY_MAX_MS }
+#define HINT_DELAY_SAMPLES { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                             | LADSPA_HINT_INTEGER | LADSPA_HINT_DEFAULT_0, 0, 4096 }
+
+/*****************************************************************************/
+
+/* Instance data for the Delay */
+typedef struct {
+
+    long m_created_ns;
+    time_t m_created_s;
+
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
+    LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+    MmapMeterBlock * m_meterBlock;
+    MeterAccumulator m_meter;
+
+    LADSPA_Data m_fSampleRate;
+    // ring buffer and delay state
+    DelayLine m_line;
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
+    // port pointers
+    LADSPA_Data * m_pfInput;
+    LADSPA_Data * m_pfOutput;
+    LADSPA_Data * m_pfDelayMs;
+    LADSPA_Data * m_pfDelaySamples;
+    LADSPA_Data * m_pfMmapFname;
+    LADSPA_Data * m_pfSmoothing;
+
+} Delay;
+
+/* Helpers... ****************************************************************/
+
+void setupMmapFileForDelay(Delay * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    ret = setupMmapFile(&psInstance->m_slot, "Delay", *(psInstance->m_pfMmapFname), MMAP_PARAMCOUNT);
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    // meter input and output levels in the delay loop
+    psInstance->m_meterBlock = ret.meter;
+    if (ret.meter != NULL) {
+        resetMeterAccumulator(&psInstance->m_meter);
+        psInstance->m_line.meter = &psInstance->m_meter;
+    }
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/*****************************************************************************/
+
+/* Construct a new Delay instance, with the ring buffer for the longest
+   delay. */
+LADSPA_Handle instantiateDelay(const LADSPA_Descriptor * Descriptor,
+                               unsigned long SampleRate) {
+    Delay * psInstance;
+    psInstance = (Delay *)malloc(sizeof(Delay));
+    if (psInstance) {
+        psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        if (!initDelayLine(&psInstance->m_line, DELAY_MAX_MS * psInstance->m_fSampleRate / 1000.0)) {
+            free(psInstance);
+            return NULL;
+        }
+        psInstance->m_slot = NULL;
+        psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_meterBlock = NULL;
+        psInstance->m_fRunAddingGain = 1.0;
+    }
+    return psInstance;
+}
+
+/*****************************************************************************/
+
+/* Initialise and activate a plugin instance. */
+void activateDelay(LADSPA_Handle Instance) {
+    Delay * psInstance;
+    psInstance = (Delay *)Instance;
+    resetDelayLine(&psInstance->m_line);
+}
+
+/*****************************************************************************/
+
+/* Connect a port to a data location.  */
+void connectPortToDelay(LADSPA_Handle Instance,
+                        unsigned long Port,
+                        LADSPA_Data * DataLocation) {
+    Delay * psInstance;
+    psInstance = (Delay *)Instance;
+    switch (Port) {
+    case SF_INPUT:
+        psInstance->m_pfInput = DataLocation;
+        break;
+    case SF_OUTPUT:
+        psInstance->m_pfOutput = DataLocation;
+        break;
+    case SF_DELAY_MS:
+        psInstance->m_pfDelayMs = DataLocation;
+        break;
+    case SF_DELAY_SAMPLES:
+        psInstance->m_pfDelaySamples = DataLocation;
+        break;
+    case SF_MMAPFNAME:
+        psInstance->m_pfMmapFname = DataLocation;
+        break;
+    case SF_SMOOTHING:
+        psInstance->m_pfSmoothing = DataLocation;
+        break;
+    }
+}
+
+/*****************************************************************************/
+
+/* Run the delay for a block of SampleCount samples. With Adding the result
+   is added to the output buffer (run_adding). */
+static inline void runDelayFilter(LADSPA_Handle Instance,
+                                  unsigned long SampleCount,
+                                  const int Adding) {
+    Delay * psInstance;
+    LADSPA_Data params[MMAP_PARAMCOUNT];
+    unsigned long lOffset, lBlockSize;
+    int changed_delay = 0;
+    int changed_mmap = 0;
+    uint64_t startCycles;
+    // get Delay Instance
+    psInstance = (Delay *)Instance;
+    startCycles = startMmapTelemetry(psInstance->m_telemetry);
+    // copy parameters over from mmapped area or a scene
+    if (psInstance->m_mmapArea != NULL) {
+        if (readMmapScene(psInstance->m_slot,
+                          params,
+                          MMAP_PARAMCOUNT,
+                          SampleCount,
+                          psInstance->m_fSampleRate) ||
+            readMmapParams(psInstance->m_mmapArea,
+                           psInstance->m_mmapParams,
+                           &psInstance->m_mmapSequence,
+                           params,
+                           MMAP_PARAMCOUNT)) {
+            changed_mmap = 1;
+            *(psInstance->m_pfDelayMs) = params[0];
+            *(psInstance->m_pfDelaySamples) = params[1];
+        }
+    } else if (wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForDelay(psInstance);
+    }
+    // glide towards a changed delay
+    changed_delay = setDelayLineTarget(&psInstance->m_line,
+                                       *(psInstance->m_pfDelayMs) * psInstance->m_fSampleRate / 1000.0
+                                       + *(psInstance->m_pfDelaySamples),
+                                       msToSamples(*(psInstance->m_pfSmoothing),
+                                                   psInstance->m_fSampleRate),
+                                       psInstance->m_fSampleRate);
+    // DELAY PROCESSING /////////////////////////////////////////////////////////
+    for (lOffset = 0; lOffset < SampleCount; lOffset += lBlockSize) {
+        lBlockSize = SampleCount - lOffset < DELAY_BLOCKSIZE ? SampleCount - lOffset : DELAY_BLOCKSIZE;
+        runDelayLine(&psInstance->m_line,
+                     psInstance->m_pfInput + lOffset,
+                     psInstance->m_pfOutput + lOffset,
+                     lBlockSize,
+                     Adding,
+                     psInstance->m_fRunAddingGain);
+    }
+    publishMmapMeter(psInstance->m_meterBlock,
+                     &psInstance->m_meter,
+                     msToSamples(MMAP_METER_WINDOW_MS, psInstance->m_fSampleRate));
+    updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_delay, changed_mmap);
+}
+
+/* Run the delay for a block of SampleCount samples. */
+void runDelay(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runDelayFilter(Instance, SampleCount, 0);
+}
+
+/* Run the delay for a block of SampleCount samples and add the result to
+   the output buffer. */
+void runAddingDelay(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runDelayFilter(Instance, SampleCount, 1);
+}
+
+/* Set the output gain of run_adding(). */
+void setRunAddingGainDelay(LADSPA_Handle Instance, LADSPA_Data Gain) {
+    ((Delay *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/* Throw away a Delay instance. */
+void cleanupDelay(LADSPA_Handle Instance) {
+    Delay * psInstance;
+    psInstance = (Delay *)Instance;
+    if (psInstance->m_mmapArea != NULL) {
+        cleanupMmapFile(psInstance->m_slot,
+                        "Delay",
+                        *(psInstance->m_pfMmapFname),
+                        psInstance->m_created_s,
+                        psInstance->m_created_ns);
+    }
+    releaseMmapSlot(psInstance->m_slot);
+    freeDelayLine(&psInstance->m_line);
+    free(Instance);
+}
+
+/*****************************************************************************/
+
+static const LADSPA_PortDescriptor g_piDelayPortDescriptors[PORTCOUNT] = {
+    [SF_INPUT] = PORT_AUDIO_INPUT,
+    [SF_OUTPUT] = PORT_AUDIO_OUTPUT,
+    [SF_DELAY_MS ... SF_SMOOTHING] = PORT_CONTROL_INPUT
+};
+
+static const char * const g_pcDelayPortNames[PORTCOUNT] = {
+    [SF_INPUT] = "Input",
+    [SF_OUTPUT] = "Output",
+    [SF_DELAY_MS] = "Delay [ms]",
+    [SF_DELAY_SAMPLES] = "Delay [samples]",
+    [SF_MMAPFNAME] = "MMAP-Filename-Part",
+    [SF_SMOOTHING] = "Smoothing Time [ms]"
+};
+
+static const LADSPA_PortRangeHint g_psDelayPortRangeHints[PORTCOUNT] = {
+    [SF_DELAY_MS] = HINT_DELAY_MS,
+    [SF_DELAY_SAMPLES] = HINT_DELAY_SAMPLES,
+    [SF_MMAPFNAME] = HINT_MMAPFNAME,
+    [SF_SMOOTHING] = HINT_SMOOTHING
+};
+
+static const LADSPA_Descriptor g_sDelayDescriptor = {
+  .UniqueID = 5566,
+  .Label = "delay",
+  .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,
+  .Name = "T5's Delay",
+  .Maker = T5_MAKER,
+  .Copyright = T5_COPYRIGHT,
+  .PortCount = PORTCOUNT,
+  .PortDescriptors = g_piDelayPortDescriptors,
+  .PortNames = g_pcDelayPortNames,
+  .PortRangeHints = g_psDelayPortRangeHints,
+  .ImplementationData = NULL,
+  .instantiate = instantiateDelay,
+  .connect_port = connectPortToDelay,
+  .activate = activateDelay,
+  .run = runDelay,
+  .run_adding = runAddingDelay,
+  .set_run_adding_gain = setRunAddingGainDelay,
+  .deactivate = NULL,
+  .cleanup = cleanupDelay
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+  /* Return the requested descriptor or null if the index is out of range. */
+  switch (Index) {
+  case 0:
+    return &g_sDelayDescriptor;
+  default:
+    return NULL;
+  }
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,526 @@
+/* t5_lr4_crossover.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides Linkwitz-Riley 24dB/octave crossovers with
+   2 to 5 bands in one instance. The bands are split off one after the
+   other from the highpassed rest of the previous split:
+
+     band 1 = LP(f1)
+     band 2 = HP(f1) LP(f2)
+     band 3 = HP(f1) HP(f2) LP(f3)
+     ...
+     band N = HP(f1) ... HP(fN-1)
+
+   so every highpass is computed once and shared by all bands above it.
+   Band k additionally runs through the LR-4 allpasses of f(k+1) .. f(N-1),
+   which keeps all bands in phase and makes them sum up flat again.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "design.h"
+#include "coeffs.h"
+#include "cascade.h"
+#include "descriptors.h"
+
+/*****************************************************************************/
+
+/* Port layout for b bands:
+
+   0                  audio input
+   1 .. b             audio outputs, lowest band first
+   b+1 .. 2b-1        crossover frequencies, ascending
+   2b .. 3b-1         gain of each band
+   3b                 mmap filename part
+   3b+1               smoothing time
+
+   The parameters in the mmap area are the crossover frequencies followed by
+   the band gains. */
+
+#define SF_INPUT             0
+#define SF_OUTPUT(b, i)      (1 + (i))
+#define SF_F(b, i)           ((b) + 1 + (i))
+#define SF_GAIN(b, i)        (2 * (b) + (i))
+#define SF_MMAPFNAME(b)      (3 * (b))
+#define SF_SMOOTHING(b)      (3 * (b) + 1)
+#define PORTCOUNT(b)         (3 * (b) + 2)
+
+#define MMAP_PARAMCOUNT(b)   (2 * (b) - 1)
+
+#define CROSSOVER_MAX_BANDS  5
+// samples processed per pass through the splitting tree
+#define CROSSOVER_BLOCKSIZE  256
+
+// two identical butterworth biquads make up one LR-4 filter
+#define LR4_SECTIONS         2
+
+/*****************************************************************************/
+
+/* Instance data for the Lr4Crossover */
+typedef struct {
+
+    long m_created_ns;
+    time_t m_created_s;
+
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
+    LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+
+    LADSPA_Data m_fSampleRate;
+    int m_iBands;
+    // band k: lowpass of crossover k and allpasses of all crossovers above,
+    // the last band is the highpass of the last crossover
+    BiquadCascade m_band[CROSSOVER_MAX_BANDS];
+    // highpass of crossover k feeding the next split, not for the last one
+    BiquadCascade m_split[CROSSOVER_MAX_BANDS - 2];
+    // parameters the coefficients and gain factors were calculated for
+    BiquadParams m_params[CROSSOVER_MAX_BANDS - 1];
+    LADSPA_Data m_fGain[CROSSOVER_MAX_BANDS];
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
+    // port pointers
+    LADSPA_Data * m_pfInput;
+    LADSPA_Data * m_ppfOutput[CROSSOVER_MAX_BANDS];
+    LADSPA_Data * m_pfF[CROSSOVER_MAX_BANDS - 1];
+    LADSPA_Data * m_pfGain[CROSSOVER_MAX_BANDS];
+    LADSPA_Data * m_pfMmapFname;
+    LADSPA_Data * m_pfSmoothing;
+
+} Lr4Crossover;
+
+/* Helpers... ****************************************************************/
+
+void setupMmapFileForLr4Crossover(Lr4Crossover * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    ret = setupMmapFile(&psInstance->m_slot, "Lr4Crossover",
+                        *(psInstance->m_pfMmapFname),
+                        MMAP_PARAMCOUNT(psInstance->m_iBands));
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/* Number of sections of band iBand. */
+int bandSections(int iBands, int iBand) {
+    if (iBand == iBands - 1) {
+        return LR4_SECTIONS;
+    }
+    return LR4_SECTIONS + iBands - 2 - iBand;
+}
+
+/* Run a band cascade. The section count only takes a few values, each
+   gets its own unrolled copy of the kernel. With Adding the band is added
+   to its output buffer. */
+static inline void runCrossoverCascade(BiquadCascade * psCascade,
+                                       int iSections,
+                                       const LADSPA_Data * pfInput,
+                                       LADSPA_Data * pfOutput,
+                                       unsigned long SampleCount,
+                                       const int Adding,
+                                       float fRunAddingGain) {
+    switch (iSections) {
+    case 2:
+        runBiquadCascadeMode(psCascade, 2, pfInput, pfOutput, SampleCount, Adding, fRunAddingGain);
+        break;
+    case 3:
+        runBiquadCascadeMode(psCascade, 3, pfInput, pfOutput, SampleCount, Adding, fRunAddingGain);
+        break;
+    case 4:
+        runBiquadCascadeMode(psCascade, 4, pfInput, pfOutput, SampleCount, Adding, fRunAddingGain);
+        break;
+    case 5:
+        runBiquadCascadeMode(psCascade, 5, pfInput, pfOutput, SampleCount, Adding, fRunAddingGain);
+        break;
+    }
+}
+
+/*****************************************************************************/
+
+/* Construct a new plugin instance. The band count is stored in the
+   descriptor's ImplementationData. */
+LADSPA_Handle instantiateLr4Crossover(const LADSPA_Descriptor * Descriptor,
+                                      unsigned long SampleRate) {
+    Lr4Crossover * psInstance;
+    int i;
+    psInstance = (Lr4Crossover *)malloc(sizeof(Lr4Crossover));
+    if (psInstance) {
+        psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_iBands = (int)(long)Descriptor->ImplementationData;
+        psInstance->m_slot = NULL;
+        psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_fRunAddingGain = 1.0;
+        for (i = 0; i < CROSSOVER_MAX_BANDS; i++) {
+            initBiquadCascade(&psInstance->m_band[i]);
+        }
+        for (i = 0; i < CROSSOVER_MAX_BANDS - 2; i++) {
+            initBiquadCascade(&psInstance->m_split[i]);
+        }
+    }
+    return psInstance;
+}
+
+/*****************************************************************************/
+
+/* Initialise and activate a plugin instance. */
+void activateLr4Crossover(LADSPA_Handle Instance) {
+    Lr4Crossover * psInstance;
+    int i;
+    psInstance = (Lr4Crossover *)Instance;
+    for (i = 0; i < CROSSOVER_MAX_BANDS; i++) {
+        resetBiquadCascade(&psInstance->m_band[i], LR4_SECTIONS + CROSSOVER_MAX_BANDS - 2);
+        psInstance->m_band[i].targetGainFactor = 1.0;
+        psInstance->m_fGain[i] = NAN;
+    }
+    for (i = 0; i < CROSSOVER_MAX_BANDS - 2; i++) {
+        resetBiquadCascade(&psInstance->m_split[i], LR4_SECTIONS);
+        psInstance->m_split[i].targetGainFactor = 1.0;
+    }
+    for (i = 0; i < CROSSOVER_MAX_BANDS - 1; i++) {
+        invalidateBiquadParams(&psInstance->m_params[i]);
+    }
+}
+
+/*****************************************************************************/
+
+/* Connect a port to a data location.  */
+void connectPortToLr4Crossover(LADSPA_Handle Instance,
+                               unsigned long Port,
+                               LADSPA_Data * DataLocation) {
+    Lr4Crossover * psInstance;
+    int b;
+    psInstance = (Lr4Crossover *)Instance;
+    b = psInstance->m_iBands;
+    if (Port == SF_INPUT) {
+        psInstance->m_pfInput = DataLocation;
+    } else if (Port < SF_F(b, 0)) {
+        psInstance->m_ppfOutput[Port - SF_OUTPUT(b, 0)] = DataLocation;
+    } else if (Port < SF_GAIN(b, 0)) {
+        psInstance->m_pfF[Port - SF_F(b, 0)] = DataLocation;
+    } else if (Port < SF_MMAPFNAME(b)) {
+        psInstance->m_pfGain[Port - SF_GAIN(b, 0)] = DataLocation;
+    } else if (Port == SF_MMAPFNAME(b)) {
+        psInstance->m_pfMmapFname = DataLocation;
+    } else if (Port == SF_SMOOTHING(b)) {
+        psInstance->m_pfSmoothing = DataLocation;
+    }
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples. With Adding
+   every band is added to its output buffer (run_adding), the split
+   highpasses always run into the internal buffer. */
+static inline void runLr4CrossoverMode(LADSPA_Handle Instance,
+                                       unsigned long SampleCount,
+                                       const int Adding) {
+
+    Lr4Crossover * psInstance;
+    LADSPA_Data params[MMAP_PARAMCOUNT(CROSSOVER_MAX_BANDS)];
+    LADSPA_Data afRest[CROSSOVER_BLOCKSIZE];
+    BiquadDesign designs[3 * (CROSSOVER_MAX_BANDS - 1)];
+    BiquadCoeffs designed[3 * (CROSSOVER_MAX_BANDS - 1)];
+    BiquadCoeffs lp, hp, ap;
+    BiquadCascade * psHighpass;
+    int changedF[CROSSOVER_MAX_BANDS - 1];
+    int designCount = 0;
+    int changed[CROSSOVER_MAX_BANDS];
+    int changedSplit[CROSSOVER_MAX_BANDS - 2];
+    unsigned long lRampSamples;
+    unsigned long lOffset, lBlockSize;
+    unsigned long fpuMode;
+    uint64_t startCycles;
+    int changed_coeffs = 0;
+    int changed_mmap = 0;
+    int b, i, k;
+    // get Lr4Crossover Instance
+    psInstance = (Lr4Crossover *)Instance;
+    startCycles = startMmapTelemetry(psInstance->m_telemetry);
+    b = psInstance->m_iBands;
+    // copy parameters over from mmapped area or a scene
+    if (psInstance->m_mmapArea != NULL) {
+        if (readMmapScene(psInstance->m_slot,
+                          params,
+                          MMAP_PARAMCOUNT(b),
+                          SampleCount,
+                          psInstance->m_fSampleRate) ||
+            readMmapParams(psInstance->m_mmapArea,
+                           psInstance->m_mmapParams,
+                           &psInstance->m_mmapSequence,
+                           params,
+                           MMAP_PARAMCOUNT(b))) {
+            changed_mmap = 1;
+            for (i = 0; i < b - 1; i++) {
+                *(psInstance->m_pfF[i]) = params[i];
+            }
+            for (i = 0; i < b; i++) {
+                *(psInstance->m_pfGain[i]) = params[b - 1 + i];
+            }
+        }
+    } else if (wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForLr4Crossover(psInstance);
+    }
+    // recalculate coeffs and gain factors only if their inputs changed
+    memset(changed, 0, sizeof(changed));
+    memset(changedSplit, 0, sizeof(changedSplit));
+    for (i = 0; i < b - 1; i++) {
+        changedF[i] = updateBiquadParams(&psInstance->m_params[i],
+                                         *(psInstance->m_pfF[i]),
+                                         0,
+                                         0.7071067811865476,
+                                         psInstance->m_fSampleRate);
+        if (changedF[i]) {
+            for (k = 0; k < 3; k++) {
+                designs[designCount + k].f = *(psInstance->m_pfF[i]);
+                designs[designCount + k].g = 0;
+                designs[designCount + k].q = 0.7071067811865476;
+            }
+            designs[designCount++].type = DESIGN_LR4_LOWPASS;
+            designs[designCount++].type = DESIGN_LR4_HIGHPASS;
+            designs[designCount++].type = DESIGN_LR4_ALLPASS;
+        }
+    }
+    // low-, high- and allpass of all moved splits in one go
+    if (designCount > 0) {
+        designBiquadSections(designs, designCount, psInstance->m_fSampleRate, designed);
+        designCount = 0;
+    }
+    for (i = 0; i < b - 1; i++) {
+        if (changedF[i]) {
+            lp = designed[designCount++];
+            hp = designed[designCount++];
+            ap = designed[designCount++];
+            // lowpass of band i
+            psInstance->m_band[i].target[0] = lp;
+            psInstance->m_band[i].target[1] = lp;
+            changed[i] = 1;
+            // highpass feeding the next split or the last band
+            if (i == b - 2) {
+                psHighpass = &psInstance->m_band[b - 1];
+                changed[b - 1] = 1;
+            } else {
+                psHighpass = &psInstance->m_split[i];
+                changedSplit[i] = 1;
+            }
+            psHighpass->target[0] = hp;
+            psHighpass->target[1] = hp;
+            // allpass of all bands below
+            for (k = 0; k < i; k++) {
+                psInstance->m_band[k].target[LR4_SECTIONS + i - k - 1] = ap;
+                changed[k] = 1;
+            }
+        }
+    }
+    for (i = 0; i < b; i++) {
+        if (*(psInstance->m_pfGain[i]) != psInstance->m_fGain[i]) {
+            psInstance->m_fGain[i] = *(psInstance->m_pfGain[i]);
+            psInstance->m_band[i].targetGainFactor = dbToGainFactor(psInstance->m_fGain[i]);
+            changed[i] = 1;
+        }
+    }
+    // apply new coeffs at once or ramp towards them
+    lRampSamples = msToSamples(*(psInstance->m_pfSmoothing), psInstance->m_fSampleRate);
+    for (i = 0; i < b; i++) {
+        if (changed[i]) {
+            changed_coeffs = 1;
+            startBiquadCascadeRamp(&psInstance->m_band[i], bandSections(b, i), lRampSamples);
+        }
+    }
+    for (i = 0; i < b - 2; i++) {
+        if (changedSplit[i]) {
+            startBiquadCascadeRamp(&psInstance->m_split[i], LR4_SECTIONS, lRampSamples);
+        }
+    }
+    // FILTER PROCESSING, the whole splitting tree per block ///////////////////
+    // The input is copied first, so outputs may share the input buffer.
+    fpuMode = disableDenormals();
+    for (lOffset = 0; lOffset < SampleCount; lOffset += lBlockSize) {
+        lBlockSize = SampleCount - lOffset;
+        if (lBlockSize > CROSSOVER_BLOCKSIZE) {
+            lBlockSize = CROSSOVER_BLOCKSIZE;
+        }
+        memcpy(afRest, psInstance->m_pfInput + lOffset, lBlockSize * sizeof(LADSPA_Data));
+        for (i = 0; i < b - 1; i++) {
+            runCrossoverCascade(&psInstance->m_band[i],
+                                bandSections(b, i),
+                                afRest,
+                                psInstance->m_ppfOutput[i] + lOffset,
+                                lBlockSize,
+                                Adding,
+                                psInstance->m_fRunAddingGain);
+            if (i < b - 2) {
+                runBiquadCascade(&psInstance->m_split[i],
+                                 LR4_SECTIONS,
+                                 afRest,
+                                 afRest,
+                                 lBlockSize);
+            }
+        }
+        runBiquadCascadeMode(&psInstance->m_band[b - 1],
+                             LR4_SECTIONS,
+                             afRest,
+                             psInstance->m_ppfOutput[b - 1] + lOffset,
+                             lBlockSize,
+                             Adding,
+                             psInstance->m_fRunAddingGain);
+    }
+    restoreDenormals(fpuMode);
+    updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runLr4Crossover(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runLr4CrossoverMode(Instance, SampleCount, 0);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   bands to the output buffers. */
+void runAddingLr4Crossover(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runLr4CrossoverMode(Instance, SampleCount, 1);
+}
+
+/* Set the output gain of run_adding(). */
+void setRunAddingGainLr4Crossover(LADSPA_Handle Instance, LADSPA_Data Gain) {
+    ((Lr4Crossover *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/* Throw away a Lr4Crossover instance. */
+void cleanupLr4Crossover(LADSPA_Handle Instance) {
+    Lr4Crossover * psInstance;
+    psInstance = (Lr4Crossover *)Instance;
+    if (psInstance->m_mmapArea != NULL) {
+        cleanupMmapFile(psInstance->m_slot,
+                        "Lr4Crossover",
+                        *(psInstance->m_pfMmapFname),
+                        psInstance->m_created_s,
+                        psInstance->m_created_ns);
+    }
+    releaseMmapSlot(psInstance->m_slot);
+    free(Instance);
+}
+
+/*****************************************************************************/
+
+#define OUTPUT_BAND_NAME(i)   "Output Band " #i
+#define FREQUENCY_NAME(i)     "Crossover Frequency " #i " [Hz]"
+#define GAIN_BAND_NAME(i)     "Gain Band " #i " [dB]"
+#define GAIN_BAND_HINT(i)     HINT_G
+
+// crossover frequencies span the audible range, D is the default hint
+#define HINT_CROSSOVER_F(D)   { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                                | LADSPA_HINT_LOGARITHMIC | (D), 20, 20000 }
+
+/* Ports of the B band variant with F = B - 1 crossover frequencies, the
+   remaining arguments are the range hints of the crossover frequencies. */
+#define LR4_CROSSOVER_PORTS(B, F, ...)                                                   \
+static const LADSPA_PortDescriptor g_piLr4CrossoverPortDescriptors##B[PORTCOUNT(B)] = { \
+    [SF_INPUT] = PORT_AUDIO_INPUT,                                                       \
+    [SF_OUTPUT(B, 0) ... SF_OUTPUT(B, B - 1)] = PORT_AUDIO_OUTPUT,                       \
+    [SF_F(B, 0) ... SF_SMOOTHING(B)] = PORT_CONTROL_INPUT                                \
+};                                                                                       \
+static const char * const g_pcLr4CrossoverPortNames##B[PORTCOUNT(B)] = {               \
+    [SF_INPUT] = "Input",                                                                \
+    [SF_OUTPUT(B, 0)] = SEQ_##B(OUTPUT_BAND_NAME),                                       \
+    [SF_F(B, 0)] = SEQ_##F(FREQUENCY_NAME),                                              \
+    [SF_GAIN(B, 0)] = SEQ_##B(GAIN_BAND_NAME),                                           \
+    [SF_MMAPFNAME(B)] = "MMAP-Filename-Part",                                            \
+    [SF_SMOOTHING(B)] = "Smoothing Time [ms]"                                            \
+};                                                                                       \
+static const LADSPA_PortRangeHint g_psLr4CrossoverPortRangeHints##B[PORTCOUNT(B)] = {  \
+    [SF_F(B, 0)] = __VA_ARGS__,                                                          \
+    [SF_GAIN(B, 0)] = SEQ_##B(GAIN_BAND_HINT),                                           \
+    [SF_MMAPFNAME(B)] = HINT_MMAPFNAME,                                                  \
+    [SF_SMOOTHING(B)] = HINT_SMOOTHING                                                   \
+};
+
+/* default crossover frequencies for each band count, in Hz: 632 | 112, 3557 |
+   112, 632, 3557 | 100, 440, 632, 3557 */
+LR4_CROSSOVER_PORTS(2, 1,
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_MIDDLE))
+LR4_CROSSOVER_PORTS(3, 2,
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_LOW),
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_HIGH))
+LR4_CROSSOVER_PORTS(4, 3,
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_LOW),
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_MIDDLE),
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_HIGH))
+LR4_CROSSOVER_PORTS(5, 4,
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_100),
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_440),
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_MIDDLE),
+                    HINT_CROSSOVER_F(LADSPA_HINT_DEFAULT_HIGH))
+
+/* Descriptor of the B band variant. */
+#define LR4_CROSSOVER_DESCRIPTOR(ID, LABEL, NAME, B) {                                  \
+    .UniqueID = ID,                                                                      \
+    .Label = LABEL,                                                                      \
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,                                       \
+    .Name = NAME,                                                                        \
+    .Maker = T5_MAKER,                                                                   \
+    .Copyright = T5_COPYRIGHT,                                                           \
+    .PortCount = PORTCOUNT(B),                                                           \
+    .PortDescriptors = g_piLr4CrossoverPortDescriptors##B,                               \
+    .PortNames = g_pcLr4CrossoverPortNames##B,                                           \
+    .PortRangeHints = g_psLr4CrossoverPortRangeHints##B,                                 \
+    .ImplementationData = (void *)B,                                                     \
+    .instantiate = instantiateLr4Crossover,                                              \
+    .connect_port = connectPortToLr4Crossover,                                           \
+    .activate = activateLr4Crossover,                                                    \
+    .run = runLr4Crossover,                                                              \
+    .run_adding = runAddingLr4Crossover,                                                 \
+    .set_run_adding_gain = setRunAddingGainLr4Crossover,                                 \
+    .deactivate = NULL,                                                                  \
+    .cleanup = cleanupLr4Crossover                                                       \
+}
+
+static const LADSPA_Descriptor g_asLr4CrossoverDescriptors[CROSSOVER_MAX_BANDS - 1] = {
+    LR4_CROSSOVER_DESCRIPTOR(5553, "lr4_crossover_2way", "T5's LR-4 Crossover, 2-Way", 2),
+    LR4_CROSSOVER_DESCRIPTOR(5554, "lr4_crossover_3way", "T5's LR-4 Crossover, 3-Way", 3),
+    LR4_CROSSOVER_DESCRIPTOR(5555, "lr4_crossover_4way", "T5's LR-4 Crossover, 4-Way", 4),
+    LR4_CROSSOVER_DESCRIPTOR(5556, "lr4_crossover_5way", "T5's LR-4 Crossover, 5-Way", 5)
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+    /* Return the requested descriptor or null if the index is out of range. */
+    if (Index < CROSSOVER_MAX_BANDS - 1) {
+        return &g_asLr4CrossoverDescriptors[Index];
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,130 @@
+/* t5_lr4_highpass_multichannel.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides Linkwitz-Riley 24dB/octave high pass filters
+   for 2, 4 and 8 channels in one instance. Every channel runs in its own
+   SIMD lane, so 4 channels cost about as much as a single one.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "design.h"
+#include "coeffs.h"
+#include "cascade.h"
+#include "descriptors.h"
+#include "lr4_multichannel.h"
+
+/* Helpers... ****************************************************************/
+
+void setupMmapFileForLr4HighpassMultiChannel(Lr4LowHighPassMultiChannel * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    ret = setupMmapFile(&psInstance->m_slot, "Lr4HighpassMultiChannel",
+                        *(psInstance->m_pfMmapFname),
+                        MMAP_PARAMCOUNT(psInstance->m_iChannels));
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runLr4HighpassMultiChannel(LADSPA_Handle Instance, unsigned long SampleCount) {
+    Lr4LowHighPassMultiChannel * psInstance;
+    psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+    if (psInstance->m_mmapArea == NULL && wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForLr4HighpassMultiChannel(psInstance);
+    }
+    runLr4LowHighPassMultiChannel(Instance, SampleCount, DESIGN_LR4_HIGHPASS, 0);
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   results to the output buffers. */
+void runAddingLr4HighpassMultiChannel(LADSPA_Handle Instance, unsigned long SampleCount) {
+    Lr4LowHighPassMultiChannel * psInstance;
+    psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+    if (psInstance->m_mmapArea == NULL && wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForLr4HighpassMultiChannel(psInstance);
+    }
+    runLr4LowHighPassMultiChannel(Instance, SampleCount, DESIGN_LR4_HIGHPASS, 1);
+}
+
+/*****************************************************************************/
+
+/* Throw away a Lr4LowHighPassMultiChannel instance. */
+void cleanupLr4HighpassMultiChannel(LADSPA_Handle Instance) {
+  Lr4LowHighPassMultiChannel * psInstance;
+  psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+  if (psInstance->m_mmapArea != NULL) {
+    cleanupMmapFile(psInstance->m_slot,
+                    "Lr4HighpassMultiChannel",
+                    *(psInstance->m_pfMmapFname),
+                    psInstance->m_created_s,
+                    psInstance->m_created_ns);
+  }
+  releaseMmapSlot(psInstance->m_slot);
+  free(Instance);
+}
+
+/*****************************************************************************/
+
+static const LADSPA_Descriptor g_asLr4HighpassMultiChannelDescriptors[] = {
+  LR4_MULTICHANNEL_DESCRIPTOR(5547,
+                              "lr4_highpass_2ch",
+                              "T5's LR-4 High Pass, 2 Channels",
+                              2,
+                              runLr4HighpassMultiChannel,
+                              runAddingLr4HighpassMultiChannel,
+                              cleanupLr4HighpassMultiChannel),
+  LR4_MULTICHANNEL_DESCRIPTOR(5548,
+                              "lr4_highpass_4ch",
+                              "T5's LR-4 High Pass, 4 Channels",
+                              4,
+                              runLr4HighpassMultiChannel,
+                              runAddingLr4HighpassMultiChannel,
+                              cleanupLr4HighpassMultiChannel),
+  LR4_MULTICHANNEL_DESCRIPTOR(5549,
+                              "lr4_highpass_8ch",
+                              "T5's LR-4 High Pass, 8 Channels",
+                              8,
+                              runLr4HighpassMultiChannel,
+                              runAddingLr4HighpassMultiChannel,
+                              cleanupLr4HighpassMultiChannel)
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+  /* Return the requested descriptor or null if the index is out of range. */
+  if (Index < sizeof(g_asLr4HighpassMultiChannelDescriptors) / sizeof(LADSPA_Descriptor)) {
+    return &g_asLr4HighpassMultiChannelDescriptors[Index];
+  }
+  return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
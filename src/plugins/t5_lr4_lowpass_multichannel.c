@@ -0,0 +1,130 @@
+/* t5_lr4_lowpass_multichannel.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides Linkwitz-Riley 24dB/octave low pass filters
+   for 2, 4 and 8 channels in one instance. Every channel runs in its own
+   SIMD lane, so 4 channels cost about as much as a single one.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "design.h"
+#include "coeffs.h"
+#include "cascade.h"
+#include "descriptors.h"
+#include "lr4_multichannel.h"
+
+/* Helpers... ****************************************************************/
+
+void setupMmapFileForLr4LowpassMultiChannel(Lr4LowHighPassMultiChannel * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    ret = setupMmapFile(&psInstance->m_slot, "Lr4LowpassMultiChannel",
+                        *(psInstance->m_pfMmapFname),
+                        MMAP_PARAMCOUNT(psInstance->m_iChannels));
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runLr4LowpassMultiChannel(LADSPA_Handle Instance, unsigned long SampleCount) {
+    Lr4LowHighPassMultiChannel * psInstance;
+    psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+    if (psInstance->m_mmapArea == NULL && wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForLr4LowpassMultiChannel(psInstance);
+    }
+    runLr4LowHighPassMultiChannel(Instance, SampleCount, DESIGN_LR4_LOWPASS, 0);
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   results to the output buffers. */
+void runAddingLr4LowpassMultiChannel(LADSPA_Handle Instance, unsigned long SampleCount) {
+    Lr4LowHighPassMultiChannel * psInstance;
+    psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+    if (psInstance->m_mmapArea == NULL && wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForLr4LowpassMultiChannel(psInstance);
+    }
+    runLr4LowHighPassMultiChannel(Instance, SampleCount, DESIGN_LR4_LOWPASS, 1);
+}
+
+/*****************************************************************************/
+
+/* Throw away a Lr4LowHighPassMultiChannel instance. */
+void cleanupLr4LowpassMultiChannel(LADSPA_Handle Instance) {
+  Lr4LowHighPassMultiChannel * psInstance;
+  psInstance = (Lr4LowHighPassMultiChannel *)Instance;
+  if (psInstance->m_mmapArea != NULL) {
+    cleanupMmapFile(psInstance->m_slot,
+                    "Lr4LowpassMultiChannel",
+                    *(psInstance->m_pfMmapFname),
+                    psInstance->m_created_s,
+                    psInstance->m_created_ns);
+  }
+  releaseMmapSlot(psInstance->m_slot);
+  free(Instance);
+}
+
+/*****************************************************************************/
+
+static const LADSPA_Descriptor g_asLr4LowpassMultiChannelDescriptors[] = {
+  LR4_MULTICHANNEL_DESCRIPTOR(5544,
+                              "lr4_lowpass_2ch",
+                              "T5's LR-4 Low Pass, 2 Channels",
+                              2,
+                              runLr4LowpassMultiChannel,
+                              runAddingLr4LowpassMultiChannel,
+                              cleanupLr4LowpassMultiChannel),
+  LR4_MULTICHANNEL_DESCRIPTOR(5545,
+                              "lr4_lowpass_4ch",
+                              "T5's LR-4 Low Pass, 4 Channels",
+                              4,
+                              runLr4LowpassMultiChannel,
+                              runAddingLr4LowpassMultiChannel,
+                              cleanupLr4LowpassMultiChannel),
+  LR4_MULTICHANNEL_DESCRIPTOR(5546,
+                              "lr4_lowpass_8ch",
+                              "T5's LR-4 Low Pass, 8 Channels",
+                              8,
+                              runLr4LowpassMultiChannel,
+                              runAddingLr4LowpassMultiChannel,
+                              cleanupLr4LowpassMultiChannel)
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+  /* Return the requested descriptor or null if the index is out of range. */
+  if (Index < sizeof(g_asLr4LowpassMultiChannelDescriptors) / sizeof(LADSPA_Descriptor)) {
+    return &g_asLr4LowpassMultiChannelDescriptors[Index];
+  }
+  return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
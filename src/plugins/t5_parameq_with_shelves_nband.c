@@ -0,0 +1,471 @@
+/* t5_parameq_with_shelves_nband.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides parametric equalizers with 5, 10 or 20
+   peaking bands between a low and a high shelving filter, for room
+   correction profiles that need more bands than the 3 band version.
+
+   All variants share one implementation. The band count is a compile time
+   constant inside runParamEqWithShelvesNBand(), which is instantiated once
+   per variant, so every variant gets its own fully unrolled coefficient
+   update and filter loop.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "design.h"
+#include "coeffs.h"
+#include "cascade.h"
+#include "presets.h"
+#include "descriptors.h"
+
+/*****************************************************************************/
+
+/* Port layout for n peaking bands, section s is the low shelf (s = 0), the
+   peaking EQ s (1 <= s <= n) or the high shelf (s = n + 1):
+
+   0                  audio input
+   1                  audio output
+   2 + 3s             frequency of section s
+   3 + 3s             gain of section s
+   4 + 3s             Q of section s
+   3n + 8             overall gain
+   3n + 9             mmap filename part
+   3n + 10            smoothing time
+
+   The parameters in the mmap area are frequency, gain and Q of all
+   sections followed by the overall gain, just like in the 3 band EQ. */
+
+#define SF_INPUT             0
+#define SF_OUTPUT            1
+#define SF_F(s)              (2 + 3 * (s))
+#define SF_G(s)              (3 + 3 * (s))
+#define SF_Q(s)              (4 + 3 * (s))
+#define SF_GAIN(n)           (3 * (n) + 8)
+#define SF_MMAPFNAME(n)      (3 * (n) + 9)
+#define SF_SMOOTHING(n)      (3 * (n) + 10)
+#define PORTCOUNT(n)         (3 * (n) + 11)
+
+#define SECTIONCOUNT(n)      ((n) + 2)
+#define MMAP_PARAMCOUNT(n)   (3 * SECTIONCOUNT(n) + 1)
+
+#define NBAND_MAX_BANDS      20
+#define NBAND_MAX_SECTIONS   SECTIONCOUNT(NBAND_MAX_BANDS)
+
+/*****************************************************************************/
+
+/* Instance data for the ParamEqWithShelvesNBand filter */
+typedef struct {
+
+    long m_created_ns;
+    time_t m_created_s;
+
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
+    LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+    MmapMeterBlock * m_meterBlock;
+    MeterAccumulator m_meter;
+    // precomputed coefficients of presets recalled through the mmap area
+    PresetBank m_bank;
+
+    LADSPA_Data m_fSampleRate;
+    int m_iBands;
+    // coefficients and previous samples of all biquad filters
+    BiquadCascade m_cascade;
+    // parameters the coefficients and gain factor were calculated for
+    BiquadParams m_params[NBAND_MAX_SECTIONS];
+    LADSPA_Data m_fGain;
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
+    // port pointers
+    LADSPA_Data * m_pfInput;
+    LADSPA_Data * m_pfOutput;
+    LADSPA_Data * m_pfF[NBAND_MAX_SECTIONS];
+    LADSPA_Data * m_pfG[NBAND_MAX_SECTIONS];
+    LADSPA_Data * m_pfQ[NBAND_MAX_SECTIONS];
+    LADSPA_Data * m_pfGain;
+    LADSPA_Data * m_pfMmapFname;
+    LADSPA_Data * m_pfSmoothing;
+
+} ParamEqWithShelvesNBand;
+
+/* Helpers... ****************************************************************/
+
+/* Name of the mmap file of a variant, e.g. "10BandParamEqWithShelves". */
+void mmapNameForParamEqWithShelvesNBand(ParamEqWithShelvesNBand * psInstance, char * pcName) {
+    sprintf(pcName, "%dBandParamEqWithShelves", psInstance->m_iBands);
+}
+
+void setupMmapFileForParamEqWithShelvesNBand(ParamEqWithShelvesNBand * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    char acName[32];
+    mmapNameForParamEqWithShelvesNBand(psInstance, acName);
+    ret = setupMmapFile(&psInstance->m_slot, acName,
+                        *(psInstance->m_pfMmapFname),
+                        MMAP_PARAMCOUNT(psInstance->m_iBands));
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    // meter input and output levels in the filter loop
+    psInstance->m_meterBlock = ret.meter;
+    if (ret.meter != NULL) {
+        resetMeterAccumulator(&psInstance->m_meter);
+        psInstance->m_cascade.meter = &psInstance->m_meter;
+    }
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/*****************************************************************************/
+
+/* Construct a new plugin instance. The band count is stored in the
+   descriptor's ImplementationData. */
+LADSPA_Handle instantiateParamEqWithShelvesNBand(const LADSPA_Descriptor * Descriptor,
+                                                 unsigned long SampleRate) {
+    ParamEqWithShelvesNBand * psInstance;
+    char acName[32];
+    psInstance = (ParamEqWithShelvesNBand *)malloc(sizeof(ParamEqWithShelvesNBand));
+    if (psInstance) {
+        psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_iBands = (int)(long)Descriptor->ImplementationData;
+        psInstance->m_slot = NULL;
+        psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_meterBlock = NULL;
+        mmapNameForParamEqWithShelvesNBand(psInstance, acName);
+        initPresetBank(&psInstance->m_bank,
+                       acName,
+                       MMAP_PARAMCOUNT(psInstance->m_iBands),
+                       SECTIONCOUNT(psInstance->m_iBands),
+                       psInstance->m_fSampleRate);
+        initBiquadCascade(&psInstance->m_cascade);
+        psInstance->m_fRunAddingGain = 1.0;
+    }
+    return psInstance;
+}
+
+/*****************************************************************************/
+
+/* Initialise and activate a plugin instance. */
+void activateParamEqWithShelvesNBand(LADSPA_Handle Instance) {
+    ParamEqWithShelvesNBand * psInstance;
+    int iSection;
+    psInstance = (ParamEqWithShelvesNBand *)Instance;
+    resetBiquadCascade(&psInstance->m_cascade, SECTIONCOUNT(psInstance->m_iBands));
+    for (iSection = 0; iSection < SECTIONCOUNT(psInstance->m_iBands); iSection++) {
+        invalidateBiquadParams(&psInstance->m_params[iSection]);
+    }
+    psInstance->m_fGain = NAN;
+}
+
+/*****************************************************************************/
+
+/* Connect a port to a data location.  */
+void connectPortToParamEqWithShelvesNBand(LADSPA_Handle Instance,
+                                          unsigned long Port,
+                                          LADSPA_Data * DataLocation) {
+    ParamEqWithShelvesNBand * psInstance;
+    int n;
+    psInstance = (ParamEqWithShelvesNBand *)Instance;
+    n = psInstance->m_iBands;
+    if (Port == SF_INPUT) {
+        psInstance->m_pfInput = DataLocation;
+    } else if (Port == SF_OUTPUT) {
+        psInstance->m_pfOutput = DataLocation;
+    } else if (Port < SF_GAIN(n)) {
+        switch ((Port - SF_F(0)) % 3) {
+        case 0:
+            psInstance->m_pfF[(Port - SF_F(0)) / 3] = DataLocation;
+            break;
+        case 1:
+            psInstance->m_pfG[(Port - SF_F(0)) / 3] = DataLocation;
+            break;
+        case 2:
+            psInstance->m_pfQ[(Port - SF_F(0)) / 3] = DataLocation;
+            break;
+        }
+    } else if (Port == SF_GAIN(n)) {
+        psInstance->m_pfGain = DataLocation;
+    } else if (Port == SF_MMAPFNAME(n)) {
+        psInstance->m_pfMmapFname = DataLocation;
+    } else if (Port == SF_SMOOTHING(n)) {
+        psInstance->m_pfSmoothing = DataLocation;
+    }
+}
+
+/*****************************************************************************/
+
+/* Run Bands peaking bands and both shelves for a block of SampleCount
+   samples. Bands is a compile time constant at every call site, so all
+   section loops below are unrolled and the section type of every
+   coefficient update is known at compile time. With Adding the result is
+   added to the output buffer (run_adding). */
+static inline void runParamEqWithShelvesNBand(ParamEqWithShelvesNBand * psInstance,
+                                              unsigned long SampleCount,
+                                              const int Bands,
+                                              const int Adding) {
+    BiquadCoeffs * coeffs;
+    BiquadParams * params;
+    BiquadDesign designs[SECTIONCOUNT(NBAND_MAX_BANDS)];
+    BiquadCoeffs designed[SECTIONCOUNT(NBAND_MAX_BANDS)];
+    int designedSection[SECTIONCOUNT(NBAND_MAX_BANDS)];
+    int designCount = 0;
+    LADSPA_Data mmapParams[MMAP_PARAMCOUNT(NBAND_MAX_BANDS)];
+    LADSPA_Data f, g, q;
+    int changed_coeffs = 0;
+    int changed_mmap = 0;
+    int changed_preset = 0;
+    unsigned long fpuMode;
+    uint64_t startCycles;
+    int iSection, iDesign;
+    startCycles = startMmapTelemetry(psInstance->m_telemetry);
+    coeffs = psInstance->m_cascade.target;
+    params = psInstance->m_params;
+    // copy parameters over from mmapped area, a scene or a recalled preset
+    // with precomputed coefficients
+    if (psInstance->m_mmapArea != NULL) {
+        changed_preset = readPresetBank(&psInstance->m_bank,
+                                        psInstance->m_mmapParams,
+                                        mmapParams,
+                                        coeffs,
+                                        &psInstance->m_cascade.targetGainFactor);
+        if (changed_preset ||
+            readMmapScene(psInstance->m_slot,
+                          mmapParams,
+                          MMAP_PARAMCOUNT(Bands),
+                          SampleCount,
+                          psInstance->m_fSampleRate) ||
+            readMmapParams(psInstance->m_mmapArea,
+                           psInstance->m_mmapParams,
+                           &psInstance->m_mmapSequence,
+                           mmapParams,
+                           MMAP_PARAMCOUNT(Bands))) {
+            changed_mmap = 1;
+            for (iSection = 0; iSection < SECTIONCOUNT(Bands); iSection++) {
+                *(psInstance->m_pfF[iSection]) = mmapParams[3 * iSection];
+                *(psInstance->m_pfG[iSection]) = mmapParams[3 * iSection + 1];
+                *(psInstance->m_pfQ[iSection]) = mmapParams[3 * iSection + 2];
+            }
+            *(psInstance->m_pfGain) = mmapParams[3 * SECTIONCOUNT(Bands)];
+        }
+        if (changed_preset) {
+            // the recalled coefficients belong to these parameters
+            primeParamEqBiquadParams(params, SECTIONCOUNT(Bands), mmapParams, psInstance->m_fSampleRate);
+            psInstance->m_fGain = mmapParams[3 * SECTIONCOUNT(Bands)];
+            changed_coeffs = 1;
+        }
+    } else if (wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForParamEqWithShelvesNBand(psInstance);
+    }
+    // calculate coeffs and gain factor, but only if their inputs changed
+    for (iSection = 0; iSection < SECTIONCOUNT(Bands); iSection++) {
+        f = *(psInstance->m_pfF[iSection]);
+        g = *(psInstance->m_pfG[iSection]);
+        q = *(psInstance->m_pfQ[iSection]);
+        if (updateBiquadParams(&params[iSection], f, g, q, psInstance->m_fSampleRate)) {
+            designs[designCount].type = designTypeParamEqWithShelves(iSection, SECTIONCOUNT(Bands));
+            designs[designCount].f = f;
+            designs[designCount].g = g;
+            designs[designCount].q = q;
+            designedSection[designCount++] = iSection;
+        }
+    }
+    // all changed sections in one go, a profile switch changes many of them
+    if (designCount > 0) {
+        designBiquadSections(designs, designCount, psInstance->m_fSampleRate, designed);
+        for (iDesign = 0; iDesign < designCount; iDesign++) {
+            coeffs[designedSection[iDesign]] = designed[iDesign];
+        }
+        changed_coeffs = 1;
+    }
+    if (*(psInstance->m_pfGain) != psInstance->m_fGain) {
+        psInstance->m_fGain = *(psInstance->m_pfGain);
+        psInstance->m_cascade.targetGainFactor = dbToGainFactor(psInstance->m_fGain);
+        changed_coeffs = 1;
+    }
+    // apply new coeffs at once or ramp towards them
+    if (changed_coeffs) {
+        startBiquadCascadeRamp(&psInstance->m_cascade,
+                               SECTIONCOUNT(Bands),
+                               msToSamples(*(psInstance->m_pfSmoothing),
+                                           psInstance->m_fSampleRate));
+    }
+    // FILTER PROCESSING, all sections in one pass /////////////////////////////
+    fpuMode = disableDenormals();
+    runBiquadCascadeMode(&psInstance->m_cascade,
+                         SECTIONCOUNT(Bands),
+                         psInstance->m_pfInput,
+                         psInstance->m_pfOutput,
+                         SampleCount,
+                         Adding,
+                         psInstance->m_fRunAddingGain);
+    restoreDenormals(fpuMode);
+    publishMmapMeter(psInstance->m_meterBlock,
+                     &psInstance->m_meter,
+                     msToSamples(MMAP_METER_WINDOW_MS, psInstance->m_fSampleRate));
+    updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples. Every band
+   count gets its own specialized copy of the kernel. */
+static inline void runParamEqWithShelvesMode(LADSPA_Handle Instance,
+                                             unsigned long SampleCount,
+                                             const int Adding) {
+    ParamEqWithShelvesNBand * psInstance;
+    psInstance = (ParamEqWithShelvesNBand *)Instance;
+    switch (psInstance->m_iBands) {
+    case 5:
+        runParamEqWithShelvesNBand(psInstance, SampleCount, 5, Adding);
+        break;
+    case 10:
+        runParamEqWithShelvesNBand(psInstance, SampleCount, 10, Adding);
+        break;
+    case 20:
+        runParamEqWithShelvesNBand(psInstance, SampleCount, 20, Adding);
+        break;
+    }
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runParamEqWithShelves(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runParamEqWithShelvesMode(Instance, SampleCount, 0);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   result to the output buffer. */
+void runAddingParamEqWithShelves(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runParamEqWithShelvesMode(Instance, SampleCount, 1);
+}
+
+/* Set the output gain of run_adding(). */
+void setRunAddingGainParamEqWithShelves(LADSPA_Handle Instance, LADSPA_Data Gain) {
+    ((ParamEqWithShelvesNBand *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/* Throw away a ParamEqWithShelvesNBand instance. */
+void cleanupParamEqWithShelvesNBand(LADSPA_Handle Instance) {
+    ParamEqWithShelvesNBand * psInstance;
+    char acName[32];
+    psInstance = (ParamEqWithShelvesNBand *)Instance;
+    if (psInstance->m_mmapArea != NULL) {
+        mmapNameForParamEqWithShelvesNBand(psInstance, acName);
+        cleanupMmapFile(psInstance->m_slot,
+                        acName,
+                        *(psInstance->m_pfMmapFname),
+                        psInstance->m_created_s,
+                        psInstance->m_created_ns);
+    }
+    closePresetBank(&psInstance->m_bank);
+    releaseMmapSlot(psInstance->m_slot);
+    free(Instance);
+}
+
+/*****************************************************************************/
+
+#define SECTION_NAMES(s)     s " Frequency [Hz]", s " Gain [dB]", s " Q"
+#define PEAKING_NAMES(i)     SECTION_NAMES("Peaking EQ " #i)
+#define SECTION_HINTS(i)     HINT_F, HINT_G, HINT_Q
+
+/* Ports of the N band variant. */
+#define NBAND_PORTS(N)                                                                   \
+static const LADSPA_PortDescriptor g_piParamEqWithShelvesPortDescriptors##N[PORTCOUNT(N)] = { \
+    [SF_INPUT] = PORT_AUDIO_INPUT,                                                       \
+    [SF_OUTPUT] = PORT_AUDIO_OUTPUT,                                                     \
+    [SF_F(0) ... SF_SMOOTHING(N)] = PORT_CONTROL_INPUT                                   \
+};                                                                                       \
+static const char * const g_pcParamEqWithShelvesPortNames##N[PORTCOUNT(N)] = {        \
+    [SF_INPUT] = "Input",                                                                \
+    [SF_OUTPUT] = "Output",                                                              \
+    [SF_F(0)] = SECTION_NAMES("Low Shelf"),                                              \
+    [SF_F(1)] = SEQ_##N(PEAKING_NAMES),                                                  \
+    [SF_F(N + 1)] = SECTION_NAMES("High Shelf"),                                         \
+    [SF_GAIN(N)] = "Overall Gain [dB]",                                                  \
+    [SF_MMAPFNAME(N)] = "MMAP-Filename-Part",                                            \
+    [SF_SMOOTHING(N)] = "Smoothing Time [ms]"                                            \
+};                                                                                       \
+static const LADSPA_PortRangeHint g_psParamEqWithShelvesPortRangeHints##N[PORTCOUNT(N)] = { \
+    [SF_F(0)] = SECTION_HINTS(0),                                                        \
+    [SF_F(1)] = SEQ_##N(SECTION_HINTS),                                                  \
+    [SF_F(N + 1)] = SECTION_HINTS(N + 1),                                                \
+    [SF_GAIN(N)] = HINT_G,                                                               \
+    [SF_MMAPFNAME(N)] = HINT_MMAPFNAME,                                                  \
+    [SF_SMOOTHING(N)] = HINT_SMOOTHING                                                   \
+};
+
+NBAND_PORTS(5)
+NBAND_PORTS(10)
+NBAND_PORTS(20)
+
+/* Descriptor of the N band variant. */
+#define NBAND_DESCRIPTOR(ID, LABEL, NAME, N) {                                          \
+    .UniqueID = ID,                                                                      \
+    .Label = LABEL,                                                                      \
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,                                       \
+    .Name = NAME,                                                                        \
+    .Maker = T5_MAKER,                                                                   \
+    .Copyright = T5_COPYRIGHT,                                                           \
+    .PortCount = PORTCOUNT(N),                                                           \
+    .PortDescriptors = g_piParamEqWithShelvesPortDescriptors##N,                         \
+    .PortNames = g_pcParamEqWithShelvesPortNames##N,                                     \
+    .PortRangeHints = g_psParamEqWithShelvesPortRangeHints##N,                           \
+    .ImplementationData = (void *)N,                                                     \
+    .instantiate = instantiateParamEqWithShelvesNBand,                                   \
+    .connect_port = connectPortToParamEqWithShelvesNBand,                                \
+    .activate = activateParamEqWithShelvesNBand,                                         \
+    .run = runParamEqWithShelves,                                                        \
+    .run_adding = runAddingParamEqWithShelves,                                           \
+    .set_run_adding_gain = setRunAddingGainParamEqWithShelves,                           \
+    .deactivate = NULL,                                                                  \
+    .cleanup = cleanupParamEqWithShelvesNBand                                            \
+}
+
+static const LADSPA_Descriptor g_asParamEqWithShelvesNBandDescriptors[] = {
+    NBAND_DESCRIPTOR(5557, "5band_parameq_with_shelves", "T5's 5-Band Parametric with Shelves", 5),
+    NBAND_DESCRIPTOR(5558, "10band_parameq_with_shelves", "T5's 10-Band Parametric with Shelves", 10),
+    NBAND_DESCRIPTOR(5559, "20band_parameq_with_shelves", "T5's 20-Band Parametric with Shelves", 20)
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+    /* Return the requested descriptor or null if the index is out of range. */
+    if (Index < sizeof(g_asParamEqWithShelvesNBandDescriptors) / sizeof(LADSPA_Descriptor)) {
+        return &g_asParamEqWithShelvesNBandDescriptors[Index];
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,538 @@
+/* t5_sub_multirate.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides the signal path of a subwoofer: a low shelf
+   and 5 or 10 peaking bands followed by an LR-4 lowpass and an overall
+   gain: 5band_parameq_with_shelves and lr4_lowpass in one plugin, without
+   the high shelf, which would sit above the lowpass.
+
+   The whole cascade runs at the reduced rate of multirate.h, 11.025kHz or
+   12kHz at the common sample rates. Everything it passes is below 300Hz,
+   so a sample at 96kHz costs an eighth of a pass through the cascade plus
+   the half-band filters, and the low bands get their coefficients far
+   away from z = 1. The price is the latency of the half-band filters,
+   reported in the output port "latency" (82 samples at 48kHz, 182 at
+   96kHz). Other channels need a delay by this amount to stay aligned,
+   e.g. with the delay plugin.
+
+   Frequencies are limited to the ranges of the port hints, so the
+   lowpass always keeps what the cascade passes band limited for the
+   interpolation.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "design.h"
+#include "cascade.h"
+#include "multirate.h"
+#include "descriptors.h"
+
+/*****************************************************************************/
+
+/* Port layout for n peaking bands, section s is the low shelf (s = 0) or
+   the peaking EQ s (1 <= s <= n):
+
+   0                  audio input
+   1                  audio output
+   2 + 3s             frequency of section s
+   3 + 3s             gain of section s
+   4 + 3s             Q of section s
+   3n + 5             lowpass cutoff frequency
+   3n + 6             overall gain
+   3n + 7             mmap filename part
+   3n + 8             smoothing time
+   3n + 9             latency (output)
+
+   The parameters in the mmap area are frequency, gain and Q of all
+   sections followed by the cutoff frequency and the overall gain. */
+
+#define SF_INPUT             0
+#define SF_OUTPUT            1
+#define SF_F(s)              (2 + 3 * (s))
+#define SF_G(s)              (3 + 3 * (s))
+#define SF_Q(s)              (4 + 3 * (s))
+#define SF_CUTOFF(n)         (3 * (n) + 5)
+#define SF_GAIN(n)           (3 * (n) + 6)
+#define SF_MMAPFNAME(n)      (3 * (n) + 7)
+#define SF_SMOOTHING(n)      (3 * (n) + 8)
+#define SF_LATENCY(n)        (3 * (n) + 9)
+#define PORTCOUNT(n)         (3 * (n) + 10)
+
+// the EQ sections, then the two sections of the lowpass
+#define EQCOUNT(n)           ((n) + 1)
+#define SECTIONCOUNT(n)      ((n) + 3)
+#define MMAP_PARAMCOUNT(n)   (3 * EQCOUNT(n) + 2)
+
+#define SUB_MAX_BANDS        10
+#define SUB_MAX_SECTIONS     SECTIONCOUNT(SUB_MAX_BANDS)
+
+// ranges of the EQ and the lowpass, far below a quarter of the reduced
+// rate
+#define SUB_MIN_F            10
+#define SUB_MAX_F            500
+#define SUB_MIN_CUTOFF       20
+#define SUB_MAX_CUTOFF       300
+
+#define HINT_SUB_F         { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                             | LADSPA_HINT_LOGARITHMIC | LADSPA_HINT_DEFAULT_MIDDLE, \
+                             SUB_MIN_F, SUB_MAX_F }
+#define HINT_SUB_CUTOFF    { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_BOUNDED_ABOVE \
+                             | LADSPA_HINT_LOGARITHMIC | LADSPA_HINT_DEFAULT_MIDDLE, \
+                             SUB_MIN_CUTOFF, SUB_MAX_CUTOFF }
+#define HINT_LATENCY       { LADSPA_HINT_BOUNDED_BELOW | LADSPA_HINT_INTEGER, 0, 0 }
+
+/*****************************************************************************/
+
+/* Instance data for the SubLowpassMultirate filter */
+typedef struct {
+
+    long m_created_ns;
+    time_t m_created_s;
+
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
+    LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+    MmapMeterBlock * m_meterBlock;
+    MeterAccumulator m_meter;
+
+    LADSPA_Data m_fSampleRate;
+    int m_iBands;
+    // decimation to the reduced rate the cascade runs at and back
+    Multirate m_multirate;
+    // coefficients and previous samples of all biquad filters, the
+    // cascade doesn't meter, its samples are at the reduced rate
+    BiquadCascade m_cascade;
+    // parameters the coefficients and gain factor were calculated for,
+    // the cutoff in the ones of the first lowpass section
+    BiquadParams m_params[SUB_MAX_SECTIONS];
+    LADSPA_Data m_fGain;
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
+    // port pointers
+    LADSPA_Data * m_pfInput;
+    LADSPA_Data * m_pfOutput;
+    LADSPA_Data * m_pfF[EQCOUNT(SUB_MAX_BANDS)];
+    LADSPA_Data * m_pfG[EQCOUNT(SUB_MAX_BANDS)];
+    LADSPA_Data * m_pfQ[EQCOUNT(SUB_MAX_BANDS)];
+    LADSPA_Data * m_pfCutoff;
+    LADSPA_Data * m_pfGain;
+    LADSPA_Data * m_pfMmapFname;
+    LADSPA_Data * m_pfSmoothing;
+    LADSPA_Data * m_pfLatency;
+
+} SubLowpassMultirate;
+
+/* Helpers... ****************************************************************/
+
+/* Name of the mmap file of a variant, e.g. "10BandSubLowpassMultirate". */
+void mmapNameForSubLowpassMultirate(SubLowpassMultirate * psInstance, char * pcName) {
+    sprintf(pcName, "%dBandSubLowpassMultirate", psInstance->m_iBands);
+}
+
+void setupMmapFileForSubLowpassMultirate(SubLowpassMultirate * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    char acName[32];
+    mmapNameForSubLowpassMultirate(psInstance, acName);
+    ret = setupMmapFile(&psInstance->m_slot, acName,
+                        *(psInstance->m_pfMmapFname),
+                        MMAP_PARAMCOUNT(psInstance->m_iBands));
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    // meter input and output levels at the full rate in run()
+    psInstance->m_meterBlock = ret.meter;
+    if (ret.meter != NULL) {
+        resetMeterAccumulator(&psInstance->m_meter);
+    }
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/* Limit f to [Min, Max], NaN to Min. */
+static inline float clampSubFrequency(float f, float Min, float Max) {
+    return f > Max ? Max : (f >= Min ? f : Min);
+}
+
+/*****************************************************************************/
+
+/* Construct a new plugin instance. The band count is stored in the
+   descriptor's ImplementationData. */
+LADSPA_Handle instantiateSubLowpassMultirate(const LADSPA_Descriptor * Descriptor,
+                                             unsigned long SampleRate) {
+    SubLowpassMultirate * psInstance;
+    psInstance = (SubLowpassMultirate *)malloc(sizeof(SubLowpassMultirate));
+    if (psInstance) {
+        psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_iBands = (int)(long)Descriptor->ImplementationData;
+        psInstance->m_slot = NULL;
+        psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_meterBlock = NULL;
+        psInstance->m_pfLatency = NULL;
+        initMultirate(&psInstance->m_multirate, psInstance->m_fSampleRate);
+        initBiquadCascade(&psInstance->m_cascade);
+        psInstance->m_fRunAddingGain = 1.0;
+    }
+    return psInstance;
+}
+
+/*****************************************************************************/
+
+/* Initialise and activate a plugin instance. */
+void activateSubLowpassMultirate(LADSPA_Handle Instance) {
+    SubLowpassMultirate * psInstance;
+    int iSection;
+    psInstance = (SubLowpassMultirate *)Instance;
+    resetMultirate(&psInstance->m_multirate);
+    resetBiquadCascade(&psInstance->m_cascade, SECTIONCOUNT(psInstance->m_iBands));
+    for (iSection = 0; iSection < SECTIONCOUNT(psInstance->m_iBands); iSection++) {
+        invalidateBiquadParams(&psInstance->m_params[iSection]);
+    }
+    psInstance->m_fGain = NAN;
+    if (psInstance->m_pfLatency != NULL) {
+        *(psInstance->m_pfLatency) = multirateLatency(&psInstance->m_multirate);
+    }
+}
+
+/*****************************************************************************/
+
+/* Connect a port to a data location.  */
+void connectPortToSubLowpassMultirate(LADSPA_Handle Instance,
+                                      unsigned long Port,
+                                      LADSPA_Data * DataLocation) {
+    SubLowpassMultirate * psInstance;
+    int n;
+    psInstance = (SubLowpassMultirate *)Instance;
+    n = psInstance->m_iBands;
+    if (Port == SF_INPUT) {
+        psInstance->m_pfInput = DataLocation;
+    } else if (Port == SF_OUTPUT) {
+        psInstance->m_pfOutput = DataLocation;
+    } else if (Port < SF_CUTOFF(n)) {
+        switch ((Port - SF_F(0)) % 3) {
+        case 0:
+            psInstance->m_pfF[(Port - SF_F(0)) / 3] = DataLocation;
+            break;
+        case 1:
+            psInstance->m_pfG[(Port - SF_F(0)) / 3] = DataLocation;
+            break;
+        case 2:
+            psInstance->m_pfQ[(Port - SF_F(0)) / 3] = DataLocation;
+            break;
+        }
+    } else if (Port == SF_CUTOFF(n)) {
+        psInstance->m_pfCutoff = DataLocation;
+    } else if (Port == SF_GAIN(n)) {
+        psInstance->m_pfGain = DataLocation;
+    } else if (Port == SF_MMAPFNAME(n)) {
+        psInstance->m_pfMmapFname = DataLocation;
+    } else if (Port == SF_SMOOTHING(n)) {
+        psInstance->m_pfSmoothing = DataLocation;
+    } else if (Port == SF_LATENCY(n)) {
+        psInstance->m_pfLatency = DataLocation;
+    }
+}
+
+/*****************************************************************************/
+
+/* Run Bands peaking bands, the low shelf and the lowpass for a block of
+   SampleCount samples. Bands is a compile time constant at every call
+   site, like in runParamEqWithShelvesNBand(). The cascade runs on every
+   chunk of the multirate buffers, in place at the reduced rate. With
+   Adding the result is added to the output buffer (run_adding). */
+static inline void runSubLowpassMultirateNBand(SubLowpassMultirate * psInstance,
+                                               unsigned long SampleCount,
+                                               const int Bands,
+                                               const int Adding) {
+    Multirate * psMultirate = &psInstance->m_multirate;
+    float fReducedRate = psMultirate->reducedRate;
+    BiquadCoeffs * coeffs;
+    BiquadParams * params;
+    BiquadDesign designs[SECTIONCOUNT(SUB_MAX_BANDS)];
+    BiquadCoeffs designed[SECTIONCOUNT(SUB_MAX_BANDS)];
+    int designedSection[SECTIONCOUNT(SUB_MAX_BANDS)];
+    int designCount = 0;
+    LADSPA_Data mmapParams[MMAP_PARAMCOUNT(SUB_MAX_BANDS)];
+    LADSPA_Data f, g, q;
+    const LADSPA_Data * pfInput;
+    const float * pfChunk;
+    LADSPA_Data * pfOutput;
+    unsigned long lOffset, lChunk, lReduced, lSampleIndex;
+    int changed_coeffs = 0;
+    int changed_mmap = 0;
+    unsigned long fpuMode;
+    uint64_t startCycles;
+    int iSection, iDesign;
+    startCycles = startMmapTelemetry(psInstance->m_telemetry);
+    coeffs = psInstance->m_cascade.target;
+    params = psInstance->m_params;
+    // copy parameters over from mmapped area or a scene
+    if (psInstance->m_mmapArea != NULL) {
+        if (readMmapScene(psInstance->m_slot,
+                          mmapParams,
+                          MMAP_PARAMCOUNT(Bands),
+                          SampleCount,
+                          psInstance->m_fSampleRate) ||
+            readMmapParams(psInstance->m_mmapArea,
+                           psInstance->m_mmapParams,
+                           &psInstance->m_mmapSequence,
+                           mmapParams,
+                           MMAP_PARAMCOUNT(Bands))) {
+            changed_mmap = 1;
+            for (iSection = 0; iSection < EQCOUNT(Bands); iSection++) {
+                *(psInstance->m_pfF[iSection]) = mmapParams[3 * iSection];
+                *(psInstance->m_pfG[iSection]) = mmapParams[3 * iSection + 1];
+                *(psInstance->m_pfQ[iSection]) = mmapParams[3 * iSection + 2];
+            }
+            *(psInstance->m_pfCutoff) = mmapParams[3 * EQCOUNT(Bands)];
+            *(psInstance->m_pfGain) = mmapParams[3 * EQCOUNT(Bands) + 1];
+        }
+    } else if (wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForSubLowpassMultirate(psInstance);
+    }
+    // calculate coeffs and gain factor at the reduced rate, but only if
+    // their inputs changed
+    for (iSection = 0; iSection < EQCOUNT(Bands); iSection++) {
+        f = clampSubFrequency(*(psInstance->m_pfF[iSection]), SUB_MIN_F, SUB_MAX_F);
+        g = *(psInstance->m_pfG[iSection]);
+        q = *(psInstance->m_pfQ[iSection]);
+        if (updateBiquadParams(&params[iSection], f, g, q, fReducedRate)) {
+            designs[designCount].type = iSection == 0 ? DESIGN_LOW_SHELF : DESIGN_PEAKING;
+            designs[designCount].f = f;
+            designs[designCount].g = g;
+            designs[designCount].q = q;
+            designedSection[designCount++] = iSection;
+        }
+    }
+    f = clampSubFrequency(*(psInstance->m_pfCutoff), SUB_MIN_CUTOFF, SUB_MAX_CUTOFF);
+    if (updateBiquadParams(&params[EQCOUNT(Bands)], f, 0, 0, fReducedRate)) {
+        for (iSection = EQCOUNT(Bands); iSection < SECTIONCOUNT(Bands); iSection++) {
+            designs[designCount].type = DESIGN_LR4_LOWPASS;
+            designs[designCount].f = f;
+            designs[designCount].g = 0;
+            designs[designCount].q = 0.7071067811865476;
+            designedSection[designCount++] = iSection;
+        }
+    }
+    // all changed sections in one go
+    if (designCount > 0) {
+        designBiquadSections(designs, designCount, fReducedRate, designed);
+        for (iDesign = 0; iDesign < designCount; iDesign++) {
+            coeffs[designedSection[iDesign]] = designed[iDesign];
+        }
+        changed_coeffs = 1;
+    }
+    if (*(psInstance->m_pfGain) != psInstance->m_fGain) {
+        psInstance->m_fGain = *(psInstance->m_pfGain);
+        psInstance->m_cascade.targetGainFactor = dbToGainFactor(psInstance->m_fGain);
+        changed_coeffs = 1;
+    }
+    // apply new coeffs at once or ramp towards them, in samples at the
+    // reduced rate
+    if (changed_coeffs) {
+        startBiquadCascadeRamp(&psInstance->m_cascade,
+                               SECTIONCOUNT(Bands),
+                               msToSamples(*(psInstance->m_pfSmoothing), fReducedRate));
+    }
+    if (psInstance->m_pfLatency != NULL) {
+        *(psInstance->m_pfLatency) = multirateLatency(psMultirate);
+    }
+    // FILTER PROCESSING, chunk by chunk at the reduced rate ///////////////////
+    fpuMode = disableDenormals();
+    for (lOffset = 0; lOffset < SampleCount; lOffset += lChunk) {
+        lChunk = SampleCount - lOffset < MULTIRATE_BLOCKSIZE ? SampleCount - lOffset
+                                                             : MULTIRATE_BLOCKSIZE;
+        // the input is read before the output is written, they may share
+        // a buffer
+        pfInput = psInstance->m_pfInput + lOffset;
+        pfOutput = psInstance->m_pfOutput + lOffset;
+        if (psInstance->m_meterBlock != NULL) {
+            meterSamples(&psInstance->m_meter, pfInput, lChunk, 0);
+        }
+        lReduced = decimateMultirate(psMultirate, pfInput, lChunk);
+        runBiquadCascadeMode(&psInstance->m_cascade,
+                             SECTIONCOUNT(Bands),
+                             psMultirate->buffer[0],
+                             psMultirate->buffer[0],
+                             lReduced,
+                             0,
+                             1.0);
+        pfChunk = interpolateMultirate(psMultirate);
+        if (psInstance->m_meterBlock != NULL) {
+            meterSamples(&psInstance->m_meter, pfChunk, lChunk, 1);
+        }
+        if (Adding) {
+            for (lSampleIndex = 0; lSampleIndex < lChunk; lSampleIndex++) {
+                pfOutput[lSampleIndex] += psInstance->m_fRunAddingGain * pfChunk[lSampleIndex];
+            }
+        } else {
+            memcpy(pfOutput, pfChunk, lChunk * sizeof(LADSPA_Data));
+        }
+    }
+    restoreDenormals(fpuMode);
+    publishMmapMeter(psInstance->m_meterBlock,
+                     &psInstance->m_meter,
+                     msToSamples(MMAP_METER_WINDOW_MS, psInstance->m_fSampleRate));
+    updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples. Every band
+   count gets its own specialized copy of the kernel. */
+static inline void runSubLowpassMultirateMode(LADSPA_Handle Instance,
+                                              unsigned long SampleCount,
+                                              const int Adding) {
+    SubLowpassMultirate * psInstance;
+    psInstance = (SubLowpassMultirate *)Instance;
+    switch (psInstance->m_iBands) {
+    case 5:
+        runSubLowpassMultirateNBand(psInstance, SampleCount, 5, Adding);
+        break;
+    case 10:
+        runSubLowpassMultirateNBand(psInstance, SampleCount, 10, Adding);
+        break;
+    }
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runSubLowpassMultirate(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runSubLowpassMultirateMode(Instance, SampleCount, 0);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   result to the output buffer. */
+void runAddingSubLowpassMultirate(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runSubLowpassMultirateMode(Instance, SampleCount, 1);
+}
+
+/* Set the output gain of run_adding(). */
+void setRunAddingGainSubLowpassMultirate(LADSPA_Handle Instance, LADSPA_Data Gain) {
+    ((SubLowpassMultirate *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/* Throw away a SubLowpassMultirate instance. */
+void cleanupSubLowpassMultirate(LADSPA_Handle Instance) {
+    SubLowpassMultirate * psInstance;
+    char acName[32];
+    psInstance = (SubLowpassMultirate *)Instance;
+    if (psInstance->m_mmapArea != NULL) {
+        mmapNameForSubLowpassMultirate(psInstance, acName);
+        cleanupMmapFile(psInstance->m_slot,
+                        acName,
+                        *(psInstance->m_pfMmapFname),
+                        psInstance->m_created_s,
+                        psInstance->m_created_ns);
+    }
+    releaseMmapSlot(psInstance->m_slot);
+    free(Instance);
+}
+
+/*****************************************************************************/
+
+#define SECTION_NAMES(s)     s " Frequency [Hz]", s " Gain [dB]", s " Q"
+#define PEAKING_NAMES(i)     SECTION_NAMES("Peaking EQ " #i)
+#define SECTION_HINTS(i)     HINT_SUB_F, HINT_G, HINT_Q
+
+/* Ports of the N band variant. */
+#define SUB_PORTS(N)                                                                     \
+static const LADSPA_PortDescriptor g_piSubLowpassMultiratePortDescriptors##N[PORTCOUNT(N)] = { \
+    [SF_INPUT] = PORT_AUDIO_INPUT,                                                       \
+    [SF_OUTPUT] = PORT_AUDIO_OUTPUT,                                                     \
+    [SF_F(0) ... SF_SMOOTHING(N)] = PORT_CONTROL_INPUT,                                  \
+    [SF_LATENCY(N)] = PORT_CONTROL_OUTPUT                                                \
+};                                                                                       \
+static const char * const g_pcSubLowpassMultiratePortNames##N[PORTCOUNT(N)] = {      \
+    [SF_INPUT] = "Input",                                                                \
+    [SF_OUTPUT] = "Output",                                                              \
+    [SF_F(0)] = SECTION_NAMES("Low Shelf"),                                              \
+    [SF_F(1)] = SEQ_##N(PEAKING_NAMES),                                                  \
+    [SF_CUTOFF(N)] = "Cutoff Frequency [Hz]",                                            \
+    [SF_GAIN(N)] = "Overall Gain [dB]",                                                  \
+    [SF_MMAPFNAME(N)] = "MMAP-Filename-Part",                                            \
+    [SF_SMOOTHING(N)] = "Smoothing Time [ms]",                                           \
+    [SF_LATENCY(N)] = "latency"                                                          \
+};                                                                                       \
+static const LADSPA_PortRangeHint g_psSubLowpassMultiratePortRangeHints##N[PORTCOUNT(N)] = { \
+    [SF_F(0)] = SECTION_HINTS(0),                                                        \
+    [SF_F(1)] = SEQ_##N(SECTION_HINTS),                                                  \
+    [SF_CUTOFF(N)] = HINT_SUB_CUTOFF,                                                    \
+    [SF_GAIN(N)] = HINT_G,                                                               \
+    [SF_MMAPFNAME(N)] = HINT_MMAPFNAME,                                                  \
+    [SF_SMOOTHING(N)] = HINT_SMOOTHING,                                                  \
+    [SF_LATENCY(N)] = HINT_LATENCY                                                       \
+};
+
+SUB_PORTS(5)
+SUB_PORTS(10)
+
+/* Descriptor of the N band variant. */
+#define SUB_DESCRIPTOR(ID, LABEL, NAME, N) {                                            \
+    .UniqueID = ID,                                                                      \
+    .Label = LABEL,                                                                      \
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,                                       \
+    .Name = NAME,                                                                        \
+    .Maker = T5_MAKER,                                                                   \
+    .Copyright = T5_COPYRIGHT,                                                           \
+    .PortCount = PORTCOUNT(N),                                                           \
+    .PortDescriptors = g_piSubLowpassMultiratePortDescriptors##N,                        \
+    .PortNames = g_pcSubLowpassMultiratePortNames##N,                                    \
+    .PortRangeHints = g_psSubLowpassMultiratePortRangeHints##N,                          \
+    .ImplementationData = (void *)N,                                                     \
+    .instantiate = instantiateSubLowpassMultirate,                                       \
+    .connect_port = connectPortToSubLowpassMultirate,                                    \
+    .activate = activateSubLowpassMultirate,                                             \
+    .run = runSubLowpassMultirate,                                                       \
+    .run_adding = runAddingSubLowpassMultirate,                                          \
+    .set_run_adding_gain = setRunAddingGainSubLowpassMultirate,                          \
+    .deactivate = NULL,                                                                  \
+    .cleanup = cleanupSubLowpassMultirate                                                \
+}
+
+static const LADSPA_Descriptor g_asSubLowpassMultirateDescriptors[] = {
+    SUB_DESCRIPTOR(5570, "sub_lowpass_5band_multirate", "T5's Sub Lowpass with 5-Band EQ (Multirate)", 5),
+    SUB_DESCRIPTOR(5571, "sub_lowpass_10band_multirate", "T5's Sub Lowpass with 10-Band EQ (Multirate)", 10)
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+    /* Return the requested descriptor or null if the index is out of range. */
+    if (Index < sizeof(g_asSubLowpassMultirateDescriptors) / sizeof(LADSPA_Descriptor)) {
+        return &g_asSubLowpassMultirateDescriptors[Index];
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,369 @@
+/* t5_svf.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   This LADSPA plugin provides 12dB/octave low- and highpass filters, a
+   peaking EQ and low and high shelving filters built on the state variable
+   filter of svf.h. Their responses equal the biquad versions, but the
+   Smoothing Time glides the filter sample by sample instead of in steps,
+   and changes of any speed, e.g. from automation through the mmap area,
+   keep the filter stable and free of clicks.
+
+   All variants share one implementation, the filter type is stored in the
+   descriptor's ImplementationData.
+
+   This file has poor memory protection. Failures during malloc() will
+   not recover nicely. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "cascade.h"
+#include "svf.h"
+#include "descriptors.h"
+
+/*****************************************************************************/
+
+#define SF_INPUT       0
+#define SF_OUTPUT      1
+#define SF_F           2
+#define SF_GAIN        3
+#define SF_Q           4
+#define SF_MMAPFNAME   5
+#define SF_SMOOTHING   6
+#define PORTCOUNT      7
+
+// parameters in the mmap area: F, GAIN, Q
+#define MMAP_PARAMCOUNT 3
+
+/*****************************************************************************/
+
+/* Instance data for the Svf filters */
+typedef struct {
+
+    long m_created_ns;
+    time_t m_created_s;
+
+    // slot in the control segment, null if the instance has none (yet)
+    MmapSlot * m_slot;
+    LADSPA_Data * m_mmapArea;
+    // MMAPFNAME setting up the mmap areas failed for, 0 if none
+    LADSPA_Data m_fMmapFailed;
+    MmapParamBlock * m_mmapParams;
+    uint32_t m_mmapSequence;
+    MmapTelemetryBlock * m_telemetry;
+    MmapMeterBlock * m_meterBlock;
+    MeterAccumulator m_meter;
+
+    LADSPA_Data m_fSampleRate;
+    // one of SVF_LOWPASS .. SVF_HIGH_SHELF
+    int m_iType;
+    // coefficients and integrator states
+    SvfFilter m_filter;
+    // parameters the coefficients were calculated for
+    BiquadParams m_params;
+    // output gain of run_adding()
+    LADSPA_Data m_fRunAddingGain;
+    // port pointers
+    LADSPA_Data * m_pfInput;
+    LADSPA_Data * m_pfOutput;
+    LADSPA_Data * m_pfF;
+    LADSPA_Data * m_pfGain;
+    LADSPA_Data * m_pfQ;
+    LADSPA_Data * m_pfMmapFname;
+    LADSPA_Data * m_pfSmoothing;
+
+} Svf;
+
+/* names of the mmap areas of the filter types */
+static char * const g_apcSvfNames[] = {
+    [SVF_LOWPASS] = "SvfLowpass",
+    [SVF_HIGHPASS] = "SvfHighpass",
+    [SVF_PEAKING] = "SvfPeaking",
+    [SVF_LOW_SHELF] = "SvfLowShelf",
+    [SVF_HIGH_SHELF] = "SvfHighShelf"
+};
+
+/* Helpers... ****************************************************************/
+
+void setupMmapFileForSvf(Svf * psInstance) {
+    // setup shared memory area to enable parametrization at runtime from external processes
+    TimeMmapStruct ret;
+    ret = setupMmapFile(&psInstance->m_slot, g_apcSvfNames[psInstance->m_iType],
+                        *(psInstance->m_pfMmapFname), MMAP_PARAMCOUNT);
+    psInstance->m_mmapArea = ret.mmap;
+    psInstance->m_fMmapFailed = ret.mmap == NULL ? *(psInstance->m_pfMmapFname) : 0;
+    psInstance->m_mmapParams = ret.params;
+    psInstance->m_telemetry = ret.telemetry;
+    // meter input and output levels in the filter loop
+    psInstance->m_meterBlock = ret.meter;
+    if (ret.meter != NULL) {
+        resetMeterAccumulator(&psInstance->m_meter);
+        psInstance->m_filter.meter = &psInstance->m_meter;
+    }
+    psInstance->m_created_s = ret.s;
+    psInstance->m_created_ns = ret.ns;
+}
+
+/*****************************************************************************/
+
+/* Construct a new plugin instance. The filter type is stored in the
+   descriptor's ImplementationData. */
+LADSPA_Handle instantiateSvf(const LADSPA_Descriptor * Descriptor,
+                             unsigned long SampleRate) {
+    Svf * psInstance;
+    psInstance = (Svf *)malloc(sizeof(Svf));
+    if (psInstance) {
+        psInstance->m_fSampleRate = (LADSPA_Data)SampleRate;
+        psInstance->m_iType = (int)(long)Descriptor->ImplementationData;
+        psInstance->m_slot = NULL;
+        psInstance->m_mmapArea = NULL;
+        psInstance->m_fMmapFailed = 0;
+        psInstance->m_mmapParams = NULL;
+        psInstance->m_mmapSequence = 0;
+        psInstance->m_telemetry = NULL;
+        psInstance->m_meterBlock = NULL;
+        psInstance->m_fRunAddingGain = 1.0;
+        initSvfFilter(&psInstance->m_filter);
+    }
+    return psInstance;
+}
+
+/*****************************************************************************/
+
+/* Initialise and activate a plugin instance. */
+void activateSvf(LADSPA_Handle Instance) {
+    Svf * psInstance;
+    psInstance = (Svf *)Instance;
+    resetSvfFilter(&psInstance->m_filter);
+    invalidateBiquadParams(&psInstance->m_params);
+}
+
+/*****************************************************************************/
+
+/* Connect a port to a data location.  */
+void connectPortToSvf(LADSPA_Handle Instance,
+                      unsigned long Port,
+                      LADSPA_Data * DataLocation) {
+    Svf * psInstance;
+    psInstance = (Svf *)Instance;
+    switch (Port) {
+    case SF_INPUT:
+        psInstance->m_pfInput = DataLocation;
+        break;
+    case SF_OUTPUT:
+        psInstance->m_pfOutput = DataLocation;
+        break;
+    case SF_F:
+        psInstance->m_pfF = DataLocation;
+        break;
+    case SF_GAIN:
+        psInstance->m_pfGain = DataLocation;
+        break;
+    case SF_Q:
+        psInstance->m_pfQ = DataLocation;
+        break;
+    case SF_MMAPFNAME:
+        psInstance->m_pfMmapFname = DataLocation;
+        break;
+    case SF_SMOOTHING:
+        psInstance->m_pfSmoothing = DataLocation;
+        break;
+    }
+}
+
+/*****************************************************************************/
+
+/* Run the filter algorithm for a block of SampleCount samples. With Adding
+   the result is added to the output buffer (run_adding). */
+static inline void runSvfFilter(LADSPA_Handle Instance,
+                                unsigned long SampleCount,
+                                const int Adding) {
+    Svf * psInstance;
+    LADSPA_Data params[MMAP_PARAMCOUNT];
+    float fGainFactor;
+    int changed_coeffs = 0;
+    int changed_mmap = 0;
+    unsigned long fpuMode;
+    uint64_t startCycles;
+    // get Svf Instance
+    psInstance = (Svf *)Instance;
+    startCycles = startMmapTelemetry(psInstance->m_telemetry);
+    // copy parameters over from mmapped area or a scene
+    if (psInstance->m_mmapArea != NULL) {
+        if (readMmapScene(psInstance->m_slot,
+                          params,
+                          MMAP_PARAMCOUNT,
+                          SampleCount,
+                          psInstance->m_fSampleRate) ||
+            readMmapParams(psInstance->m_mmapArea,
+                           psInstance->m_mmapParams,
+                           &psInstance->m_mmapSequence,
+                           params,
+                           MMAP_PARAMCOUNT)) {
+            changed_mmap = 1;
+            *(psInstance->m_pfF) = params[0];
+            *(psInstance->m_pfGain) = params[1];
+            *(psInstance->m_pfQ) = params[2];
+        }
+    } else if (wantMmapSetup(*(psInstance->m_pfMmapFname), psInstance->m_fMmapFailed)) {
+        setupMmapFileForSvf(psInstance);
+    }
+    // recalculate coeffs only if their inputs changed, low- and highpass
+    // take the gain as overall gain, the others as their own gain
+    if (updateBiquadParams(&psInstance->m_params,
+                           *(psInstance->m_pfF),
+                           *(psInstance->m_pfGain),
+                           *(psInstance->m_pfQ),
+                           psInstance->m_fSampleRate)) {
+        fGainFactor = 1.0;
+        if (psInstance->m_iType == SVF_LOWPASS || psInstance->m_iType == SVF_HIGHPASS) {
+            fGainFactor = dbToGainFactor(*(psInstance->m_pfGain));
+        }
+        psInstance->m_filter.target = calcSvfCoeffs(psInstance->m_iType,
+                                                    *(psInstance->m_pfF),
+                                                    *(psInstance->m_pfGain),
+                                                    *(psInstance->m_pfQ),
+                                                    fGainFactor,
+                                                    psInstance->m_fSampleRate);
+        // apply new coeffs at once or glide towards them
+        startSvfRamp(&psInstance->m_filter,
+                     msToSamples(*(psInstance->m_pfSmoothing), psInstance->m_fSampleRate));
+        changed_coeffs = 1;
+    }
+    // FILTER PROCESSING ////////////////////////////////////////////////////////
+    fpuMode = disableDenormals();
+    runSvfMode(&psInstance->m_filter,
+               psInstance->m_pfInput,
+               psInstance->m_pfOutput,
+               SampleCount,
+               Adding,
+               psInstance->m_fRunAddingGain);
+    restoreDenormals(fpuMode);
+    publishMmapMeter(psInstance->m_meterBlock,
+                     &psInstance->m_meter,
+                     msToSamples(MMAP_METER_WINDOW_MS, psInstance->m_fSampleRate));
+    updateMmapTelemetry(psInstance->m_telemetry, startCycles, SampleCount, changed_coeffs, changed_mmap);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples. */
+void runSvf(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runSvfFilter(Instance, SampleCount, 0);
+}
+
+/* Run the filter algorithm for a block of SampleCount samples and add the
+   result to the output buffer. */
+void runAddingSvf(LADSPA_Handle Instance, unsigned long SampleCount) {
+    runSvfFilter(Instance, SampleCount, 1);
+}
+
+/* Set the output gain of run_adding(). */
+void setRunAddingGainSvf(LADSPA_Handle Instance, LADSPA_Data Gain) {
+    ((Svf *)Instance)->m_fRunAddingGain = Gain;
+}
+
+/*****************************************************************************/
+
+/* Throw away a Svf instance. */
+void cleanupSvf(LADSPA_Handle Instance) {
+    Svf * psInstance;
+    psInstance = (Svf *)Instance;
+    if (psInstance->m_mmapArea != NULL) {
+        cleanupMmapFile(psInstance->m_slot,
+                        g_apcSvfNames[psInstance->m_iType],
+                        *(psInstance->m_pfMmapFname),
+                        psInstance->m_created_s,
+                        psInstance->m_created_ns);
+    }
+    releaseMmapSlot(psInstance->m_slot);
+    free(Instance);
+}
+
+/*****************************************************************************/
+
+/* Ports of the low- and highpass filters (P = Pass) and of the peaking EQ
+   and shelves (P = Eq). Both have the same layout, the gain is the
+   overall gain of the passes and the boost or cut of the others. */
+#define SVF_PORTS(P, FNAME, GNAME)                                                      \
+static const LADSPA_PortDescriptor g_piSvf##P##PortDescriptors[PORTCOUNT] = {           \
+    [SF_INPUT] = PORT_AUDIO_INPUT,                                                       \
+    [SF_OUTPUT] = PORT_AUDIO_OUTPUT,                                                     \
+    [SF_F ... SF_SMOOTHING] = PORT_CONTROL_INPUT                                         \
+};                                                                                       \
+static const char * const g_pcSvf##P##PortNames[PORTCOUNT] = {                          \
+    [SF_INPUT] = "Input",                                                                \
+    [SF_OUTPUT] = "Output",                                                              \
+    [SF_F] = FNAME,                                                                      \
+    [SF_GAIN] = GNAME,                                                                   \
+    [SF_Q] = "Q",                                                                        \
+    [SF_MMAPFNAME] = "MMAP-Filename-Part",                                               \
+    [SF_SMOOTHING] = "Smoothing Time [ms]"                                               \
+};                                                                                       \
+static const LADSPA_PortRangeHint g_psSvf##P##PortRangeHints[PORTCOUNT] = {             \
+    [SF_F] = HINT_F,                                                                     \
+    [SF_GAIN] = HINT_G,                                                                  \
+    [SF_Q] = HINT_Q,                                                                     \
+    [SF_MMAPFNAME] = HINT_MMAPFNAME,                                                     \
+    [SF_SMOOTHING] = HINT_SMOOTHING                                                      \
+};
+
+SVF_PORTS(Pass, "Cutoff Frequency [Hz]", "Overall Gain [dB]")
+SVF_PORTS(Eq, "Frequency [Hz]", "Gain [dB]")
+
+/* Descriptor of the filter type T with the ports of P. */
+#define SVF_DESCRIPTOR(ID, LABEL, NAME, P, T) {                                         \
+    .UniqueID = ID,                                                                      \
+    .Label = LABEL,                                                                      \
+    .Properties = LADSPA_PROPERTY_HARD_RT_CAPABLE,                                       \
+    .Name = NAME,                                                                        \
+    .Maker = T5_MAKER,                                                                   \
+    .Copyright = T5_COPYRIGHT,                                                           \
+    .PortCount = PORTCOUNT,                                                              \
+    .PortDescriptors = g_piSvf##P##PortDescriptors,                                      \
+    .PortNames = g_pcSvf##P##PortNames,                                                  \
+    .PortRangeHints = g_psSvf##P##PortRangeHints,                                        \
+    .ImplementationData = (void *)T,                                                     \
+    .instantiate = instantiateSvf,                                                       \
+    .connect_port = connectPortToSvf,                                                    \
+    .activate = activateSvf,                                                             \
+    .run = runSvf,                                                                       \
+    .run_adding = runAddingSvf,                                                          \
+    .set_run_adding_gain = setRunAddingGainSvf,                                          \
+    .deactivate = NULL,                                                                  \
+    .cleanup = cleanupSvf                                                                \
+}
+
+static const LADSPA_Descriptor g_asSvfDescriptors[] = {
+    SVF_DESCRIPTOR(5560, "svf_lowpass", "T5's SVF Low Pass", Pass, SVF_LOWPASS),
+    SVF_DESCRIPTOR(5561, "svf_highpass", "T5's SVF High Pass", Pass, SVF_HIGHPASS),
+    SVF_DESCRIPTOR(5562, "svf_peaking", "T5's SVF Peaking EQ", Eq, SVF_PEAKING),
+    SVF_DESCRIPTOR(5563, "svf_low_shelf", "T5's SVF Low Shelf", Eq, SVF_LOW_SHELF),
+    SVF_DESCRIPTOR(5564, "svf_high_shelf", "T5's SVF High Shelf", Eq, SVF_HIGH_SHELF)
+};
+
+/*****************************************************************************/
+
+/* Return a descriptor of the requested plugin types. */
+const LADSPA_Descriptor * ladspa_descriptor(unsigned long Index) {
+    /* Return the requested descriptor or null if the index is out of range. */
+    if (Index < sizeof(g_asSvfDescriptors) / sizeof(LADSPA_Descriptor)) {
+        return &g_asSvfDescriptors[Index];
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+
+/* EOF */
@@ -0,0 +1,246 @@
+/* t5_presetbank.c
+
+   Free software by Juergen Herrmann, t-5@t-5.eu. Do with it, whatever you
+   want. No warranty. None, whatsoever. Also see license.txt .
+
+   Writes a preset bank (see plugins/presets.h) for one plugin type. The
+   presets are read from stdin, one per line, with their parameters
+   separated by blanks in the order of the mmap area, e.g. frequency and
+   gain for the LR-4 filters. Empty lines and lines starting with # are
+   skipped. The coefficients of every preset are calculated for all given
+   sample rates with the same functions the plugins use, all sections of
+   an EQ preset at once.
+
+   The bank is written to a temporary file first and then renamed, so
+   instances that are running keep the bank they mapped.
+
+   Usage: t5_presetbank [-r samplerates] [-o file] name < presets
+
+   name is the name of the plugin's mmap area: Lr4Lowpass, Lr4Highpass,
+   3BandParamEqWithShelves, 5BandParamEqWithShelves,
+   10BandParamEqWithShelves or 20BandParamEqWithShelves. The sample rates
+   are a comma separated list, by default 44100,48000,96000. file defaults
+   to the bank the plugins map, PRESET_BANK_DIR/t5_bank_<name>. */
+
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <ladspa.h>
+#include "helpers.h"
+#include "design.h"
+#include "coeffs.h"
+#include "presets.h"
+
+/*****************************************************************************/
+
+#define PRESETBANK_MAX_PRESETS  1024
+#define PRESETBANK_LINE_SIZE    4096
+// sections of the 20 band EQ
+#define PRESETBANK_MAX_SECTIONS 22
+
+/* plugin type a bank is written for */
+typedef struct {
+
+    char name[32];
+    int paramCount;
+    int sectionCount;
+    // -1 for the EQs, the design type of the LR-4 passes otherwise
+    int lr4Type;
+
+} PresetBankType;
+
+/* Helpers... ****************************************************************/
+
+/* Parse a comma separated list of sample rates, returns their number. */
+static int parseRates(const char * pcList, float * pfRates) {
+    int iCount = 0;
+    char * pcEnd;
+    while (*pcList && iCount < PRESET_BANK_MAX_RATES) {
+        pfRates[iCount++] = strtod(pcList, &pcEnd);
+        pcList = *pcEnd == ',' ? pcEnd + 1 : pcEnd;
+        if (pcEnd == pcList && *pcEnd) {
+            break;
+        }
+    }
+    return iCount;
+}
+
+/* Look up the plugin type of a bank name, returns 0 for unknown names. */
+static int findBankType(const char * pcName, PresetBankType * psType) {
+    int iBands;
+    char acRest[32];
+    snprintf(psType->name, sizeof(psType->name), "%s", pcName);
+    psType->lr4Type = -1;
+    if (strcmp(pcName, "Lr4Lowpass") == 0 || strcmp(pcName, "Lr4Highpass") == 0) {
+        psType->paramCount = 2;
+        psType->sectionCount = 2;
+        psType->lr4Type = strcmp(pcName, "Lr4Lowpass") == 0 ? DESIGN_LR4_LOWPASS
+                                                            : DESIGN_LR4_HIGHPASS;
+        return 1;
+    }
+    if (sscanf(pcName, "%dBand%31s", &iBands, acRest) == 2 &&
+        strcmp(acRest, "ParamEqWithShelves") == 0 &&
+        (iBands == 3 || iBands == 5 || iBands == 10 || iBands == 20)) {
+        // low shelf, peaking EQs and high shelf, then the overall gain
+        psType->sectionCount = iBands + 2;
+        psType->paramCount = 3 * psType->sectionCount + 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* Calculate the gain factor and coefficients of a preset at samplerate. */
+static void calcPresetCoeffs(const PresetBankType * psType,
+                             const LADSPA_Data * pfParams,
+                             float samplerate,
+                             double * pfGainFactor,
+                             BiquadCoeffs * psCoeffs) {
+    BiquadDesign asDesigns[PRESETBANK_MAX_SECTIONS];
+    int iSection;
+    if (psType->lr4Type >= 0) {
+        // both passes use the same coefficients
+        psCoeffs[0] = designBiquad(psType->lr4Type, pfParams[0], 0, 0.7071067811865476, samplerate);
+        psCoeffs[1] = psCoeffs[0];
+        *pfGainFactor = dbToGainFactor(pfParams[1]);
+        return;
+    }
+    for (iSection = 0; iSection < psType->sectionCount; iSection++) {
+        asDesigns[iSection].type = designTypeParamEqWithShelves(iSection, psType->sectionCount);
+        asDesigns[iSection].f = pfParams[3 * iSection];
+        asDesigns[iSection].g = pfParams[3 * iSection + 1];
+        asDesigns[iSection].q = pfParams[3 * iSection + 2];
+    }
+    designBiquadSections(asDesigns, psType->sectionCount, samplerate, psCoeffs);
+    *pfGainFactor = dbToGainFactor(pfParams[3 * psType->sectionCount]);
+}
+
+/* Read the presets from stdin into pfParams, returns their number or -1
+   on errors. */
+static int readPresets(const PresetBankType * psType, LADSPA_Data * pfParams) {
+    char acLine[PRESETBANK_LINE_SIZE];
+    char * pcPos;
+    char * pcEnd;
+    int iLine = 0, iPresets = 0, iParam;
+    while (fgets(acLine, sizeof(acLine), stdin) != NULL) {
+        iLine++;
+        pcPos = acLine + strspn(acLine, " \t");
+        if (*pcPos == '#' || *pcPos == '\n' || *pcPos == '\0') {
+            continue;
+        }
+        if (iPresets == PRESETBANK_MAX_PRESETS) {
+            fprintf(stderr, "ERROR: more than %d presets\n", PRESETBANK_MAX_PRESETS);
+            return -1;
+        }
+        for (iParam = 0; iParam < psType->paramCount; iParam++) {
+            pfParams[iPresets * psType->paramCount + iParam] = strtof(pcPos, &pcEnd);
+            if (pcEnd == pcPos) {
+                break;
+            }
+            pcPos = pcEnd;
+        }
+        if (iParam < psType->paramCount || strspn(pcPos, " \t\r\n") != strlen(pcPos)) {
+            fprintf(stderr, "ERROR: line %d needs %d parameters\n", iLine, psType->paramCount);
+            return -1;
+        }
+        iPresets++;
+    }
+    return iPresets;
+}
+
+/*****************************************************************************/
+
+int main(int argc, char ** argv) {
+    float afRates[PRESET_BANK_MAX_RATES] = { 44100, 48000, 96000 };
+    int iRates = 3;
+    const char * pcOutput = NULL;
+    char acBank[255], acTemp[270];
+    PresetBankType sType;
+    PresetBankHeader sHeader;
+    LADSPA_Data * pfParams;
+    BiquadCoeffs asCoeffs[PRESETBANK_MAX_SECTIONS];
+    double fGainFactor;
+    char acPadding[8] = { 0 };
+    size_t lParams;
+    FILE * psFile;
+    int iOpt, iPresets, p, r;
+
+    while ((iOpt = getopt(argc, argv, "r:o:")) != -1) {
+        switch (iOpt) {
+        case 'r':
+            iRates = parseRates(optarg, afRates);
+            break;
+        case 'o':
+            pcOutput = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-r samplerates] [-o file] name < presets\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind != argc - 1 || !findBankType(argv[optind], &sType)) {
+        fprintf(stderr, "%s: no or unknown bank name given\n", argv[0]);
+        return 2;
+    }
+    if (iRates == 0) {
+        fprintf(stderr, "%s: no sample rates given\n", argv[0]);
+        return 2;
+    }
+    pfParams = malloc(PRESETBANK_MAX_PRESETS * sType.paramCount * sizeof(LADSPA_Data));
+    iPresets = readPresets(&sType, pfParams);
+    if (iPresets < 0) {
+        return 1;
+    }
+
+    memset(&sHeader, 0, sizeof(sHeader));
+    sHeader.magic = PRESET_BANK_MAGIC;
+    sHeader.version = PRESET_BANK_VERSION;
+    sHeader.paramCount = sType.paramCount;
+    sHeader.sectionCount = sType.sectionCount;
+    sHeader.presetCount = iPresets;
+    sHeader.rateCount = iRates;
+    memcpy(sHeader.sampleRates, afRates, iRates * sizeof(float));
+
+    if (pcOutput == NULL) {
+        presetBankName(sType.name, acBank);
+        pcOutput = acBank;
+    }
+    snprintf(acTemp, sizeof(acTemp), "%s.tmp", pcOutput);
+    psFile = fopen(acTemp, "wb");
+    if (psFile == NULL) {
+        fprintf(stderr, "ERROR: could not open %s\n", acTemp);
+        return 1;
+    }
+    fwrite(&sHeader, sizeof(sHeader), 1, psFile);
+    lParams = sType.paramCount * sizeof(LADSPA_Data);
+    for (p = 0; p < iPresets; p++) {
+        fwrite(pfParams + p * sType.paramCount, lParams, 1, psFile);
+        fwrite(acPadding, presetBankParamsSize(sType.paramCount) - lParams, 1, psFile);
+        for (r = 0; r < iRates; r++) {
+            calcPresetCoeffs(&sType, pfParams + p * sType.paramCount, afRates[r],
+                             &fGainFactor, asCoeffs);
+            fwrite(&fGainFactor, sizeof(double), 1, psFile);
+            fwrite(asCoeffs, sizeof(BiquadCoeffs), sType.sectionCount, psFile);
+        }
+    }
+    if (fclose(psFile) != 0 || rename(acTemp, pcOutput) != 0) {
+        fprintf(stderr, "ERROR: could not write %s\n", pcOutput);
+        remove(acTemp);
+        return 1;
+    }
+    printf("%s: %d presets at %d sample rates\n", pcOutput, iPresets, iRates);
+    free(pfParams);
+    return 0;
+}
+
+/*****************************************************************************/
+
+/* EOF */